@@ -0,0 +1,118 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Benchmark.h"
+#include "../src/Engine/Logger.h"
+#include "../src/Engine/Options.h"
+#include "../src/Engine/CrossPlatform.h"
+
+using namespace OpenXcom;
+
+/**
+ * Checks if a workload was requested on the command line.
+ * @param only Workload filter, empty for all of them.
+ * @param name Workload name.
+ * @return True if the workload should be run.
+ */
+static bool wanted(const std::string &only, const std::string &name)
+{
+	return only.empty() || name.compare(0, only.size(), only) == 0;
+}
+
+// Runs the performance workloads and prints the timings as JSON.
+// The globe workloads only run when given the game data, and the replay
+// workloads when given a save, which also need the game data.
+// Usage: openxcom-bench [-seed N] [-queries N] [-threads N] [-only name]
+//                       [-data PATH] [-save FILE.sav] [-turns N]
+//                       [-frames N] [-golden PATH]
+int main(int argc, char** args)
+{
+	unsigned int seed = 1;
+	int queries = 5000;
+	int threads = 0;
+	int turns = 10;
+	int frames = 200;
+	std::string only, data, save, golden;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(args[i], "-seed") == 0)
+			seed = strtoul(args[i + 1], 0, 10);
+		else if (strcmp(args[i], "-queries") == 0)
+			queries = atoi(args[i + 1]);
+		else if (strcmp(args[i], "-threads") == 0)
+			threads = atoi(args[i + 1]);
+		else if (strcmp(args[i], "-only") == 0)
+			only = args[i + 1];
+		else if (strcmp(args[i], "-data") == 0)
+			data = args[i + 1];
+		else if (strcmp(args[i], "-save") == 0)
+			save = args[i + 1];
+		else if (strcmp(args[i], "-turns") == 0)
+			turns = atoi(args[i + 1]);
+		else if (strcmp(args[i], "-frames") == 0)
+			frames = atoi(args[i + 1]);
+		else if (strcmp(args[i], "-golden") == 0)
+			golden = args[i + 1];
+		else
+		{
+			std::cerr << "Unknown argument: " << args[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	Logger::reportingLevel() = LOG_WARNING;
+	Options::createDefault();
+	if (!data.empty())
+		Options::setDataFolder(CrossPlatform::endPath(data));
+
+	std::vector<Benchmark::Result> results;
+	if (wanted(only, "pathfinding"))
+		Benchmark::pathfinding(&results, queries, seed);
+	if (wanted(only, "tiles"))
+		Benchmark::tiles(&results, 200, seed);
+	if (wanted(only, "shade"))
+		Benchmark::shading(&results, 2000000, seed);
+	if (wanted(only, "hqx"))
+		Benchmark::hqx(&results, 50, seed);
+	if (wanted(only, "zoom"))
+		Benchmark::zoom(&results, 50, threads, seed);
+	if (!data.empty() && wanted(only, "globe"))
+		Benchmark::globe(&results, 1000, 100000, seed);
+	if (!save.empty() && wanted(only, "replay"))
+		Benchmark::replay(&results, save, 10000, turns, seed);
+	if (!save.empty() && wanted(only, "render"))
+		Benchmark::render(&results, save, frames, golden);
+
+	Benchmark::writeJson(std::cout, results, seed);
+	for (std::vector<Benchmark::Result>::const_iterator i = results.begin(); i != results.end(); ++i)
+	{
+		for (std::vector<std::pair<std::string, double> >::const_iterator j = i->values.begin(); j != i->values.end(); ++j)
+		{
+			if (j->first == "mismatches" && j->second != 0)
+			{
+				std::cerr << i->name << " does not match the reference output" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	return EXIT_SUCCESS;
+}
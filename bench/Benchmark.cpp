@@ -0,0 +1,200 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <sstream>
+#include <cstdlib>
+#include <new>
+#include "../src/Ruleset/MapData.h"
+#include "../src/Ruleset/MapDataSet.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+// Every allocation in the harness goes through these, so the workloads
+// can report how many they made. Not thread-safe, so the count is only
+// exact for workloads that stay on one thread.
+static size_t allocationCount = 0;
+
+void *operator new(size_t size)
+{
+	++allocationCount;
+	void *p = malloc(size ? size : 1);
+	if (p == 0)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p)
+{
+	free(p);
+}
+
+void operator delete[](void *p)
+{
+	free(p);
+}
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+/**
+ * Gets the current wall-clock time with the best
+ * resolution the platform has to offer.
+ * @return Time in seconds since an arbitrary point.
+ */
+double now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+/**
+ * Gets how many memory allocations were made so far.
+ * @return Number of allocations.
+ */
+size_t allocations()
+{
+	return allocationCount;
+}
+
+/**
+ * Creates a new timer, already running.
+ */
+Timer::Timer() : _start(now())
+{
+}
+
+/**
+ * Restarts the timer from zero.
+ */
+void Timer::start()
+{
+	_start = now();
+}
+
+/**
+ * Gets the time passed since the timer was last started.
+ * @return Time in seconds.
+ */
+double Timer::elapsed() const
+{
+	return now() - _start;
+}
+
+/**
+ * Creates a map part with every field set to something sane,
+ * since map data usually comes straight out of the MCD files.
+ * @param set Map data set the part belongs to.
+ * @param tuCost Cost to walk through the part, 255 for impassable.
+ * @return New map data.
+ */
+MapData *createPart(MapDataSet *set, int tuCost)
+{
+	MapData *data = new MapData(set);
+	data->setFlags(false, tuCost == 255, false, 0, false, false, false, false);
+	data->setTUCosts(tuCost, tuCost, tuCost);
+	data->setBlockValue(0, 0, 0, 0, 0, 0);
+	data->setTerrainLevel(0);
+	data->setSpecialType(0, 0);
+	data->setYOffset(0);
+	data->setFootstepSound(0);
+	data->setAltMCD(0);
+	data->setDieMCD(0);
+	data->setLightSource(0);
+	data->setArmor(255);
+	data->setFlammable(255);
+	data->setFuel(0);
+	data->setExplosive(0);
+	for (int i = 0; i < 12; ++i)
+		data->setLoftID(0, i);
+	for (int i = 0; i < 8; ++i)
+		data->setSprite(i, 0);
+	data->setMiniMapIndex(0);
+	set->getObjects()->push_back(data);
+	return data;
+}
+
+/**
+ * Escapes a string for use in JSON.
+ * @param s Original string.
+ * @return Quoted string.
+ */
+static std::string quote(const std::string &s)
+{
+	std::ostringstream ss;
+	ss << '"';
+	for (std::string::const_iterator i = s.begin(); i != s.end(); ++i)
+	{
+		if (*i == '"' || *i == '\\')
+			ss << '\\';
+		ss << *i;
+	}
+	ss << '"';
+	return ss.str();
+}
+
+/**
+ * Writes the results of all the workloads as a JSON
+ * document, so runs can be compared by scripts.
+ * @param out Output stream.
+ * @param results Workload results.
+ * @param seed Random seed the workloads were run with.
+ */
+void writeJson(std::ostream &out, const std::vector<Result> &results, unsigned int seed)
+{
+	out << "{\n\t\"seed\": " << seed << ",\n\t\"results\": [";
+	for (std::vector<Result>::const_iterator i = results.begin(); i != results.end(); ++i)
+	{
+		out << (i == results.begin() ? "\n" : ",\n");
+		out << "\t\t{\n";
+		out << "\t\t\t\"name\": " << quote(i->name) << ",\n";
+		out << "\t\t\t\"iterations\": " << i->iterations << ",\n";
+		out << "\t\t\t\"seconds\": " << i->seconds << ",\n";
+		out << "\t\t\t\"usPerIteration\": " << (i->iterations ? i->seconds * 1000000.0 / i->iterations : 0.0);
+		for (std::vector<std::pair<std::string, double> >::const_iterator j = i->values.begin(); j != i->values.end(); ++j)
+		{
+			out << ",\n\t\t\t" << quote(j->first) << ": " << j->second;
+		}
+		out << "\n\t\t}";
+	}
+	out << "\n\t]\n}\n";
+}
+
+}
+
+}
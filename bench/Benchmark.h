@@ -0,0 +1,95 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BENCHMARK_H
+#define OPENXCOM_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+namespace OpenXcom
+{
+
+class MapData;
+class MapDataSet;
+
+/**
+ * Performance harness for the engine, run outside the game
+ * so the numbers aren't skewed by rendering or input.
+ */
+namespace Benchmark
+{
+	/**
+	 * Outcome of a single workload, along with any
+	 * workload-specific counters worth reporting.
+	 */
+	struct Result
+	{
+		std::string name;
+		int iterations;
+		double seconds;
+		std::vector<std::pair<std::string, double> > values;
+	};
+
+	/**
+	 * High resolution wall-clock timer.
+	 */
+	class Timer
+	{
+	private:
+		double _start;
+	public:
+		/// Creates a new timer and starts it.
+		Timer();
+		/// Restarts the timer.
+		void start();
+		/// Gets the time since the timer was started.
+		double elapsed() const;
+	};
+
+	/// Gets the current time in seconds.
+	double now();
+	/// Gets the number of memory allocations so far.
+	size_t allocations();
+	/// Writes the results as JSON.
+	void writeJson(std::ostream &out, const std::vector<Result> &results, unsigned int seed);
+	/// Creates a map part for generated maps.
+	MapData *createPart(MapDataSet *set, int tuCost);
+	/// Runs random A* queries and reachability searches on a generated map.
+	void pathfinding(std::vector<Result> *results, int queries, unsigned int seed);
+	/// Sweeps over all the tiles of a generated map in several layouts.
+	void tiles(std::vector<Result> *results, int sweeps, unsigned int seed);
+	/// Checks and times the shading kernels.
+	void shading(std::vector<Result> *results, int rows, unsigned int seed);
+	/// Checks and times the HQX scalers.
+	void hqx(std::vector<Result> *results, int frames, unsigned int seed);
+	/// Checks and times zooming the screen on several threads.
+	void zoom(std::vector<Result> *results, int frames, int threads, unsigned int seed);
+	/// Checks the geoscape globe shortcuts against the plain formulas.
+	void globe(std::vector<Result> *results, int views, int points, unsigned int seed);
+	/// Replays battlescape and geoscape workloads on a saved game.
+	void replay(std::vector<Result> *results, const std::string &filename, int queries, int turns, unsigned int seed);
+	/// Draws and checks battlescape frames from a saved game.
+	void render(std::vector<Result> *results, const std::string &filename, int frames, const std::string &golden);
+}
+
+}
+
+#endif
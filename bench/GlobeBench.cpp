@@ -0,0 +1,268 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <cmath>
+#include <algorithm>
+#include <SDL.h>
+#include "../src/Engine/Game.h"
+#include "../src/Engine/Options.h"
+#include "../src/Engine/RNG.h"
+#include "../src/Resource/XcomResourcePack.h"
+#include "../src/Ruleset/Ruleset.h"
+#include "../src/Savegame/SavedGame.h"
+#include "../src/Geoscape/Globe.h"
+#include "../src/Geoscape/Polygon.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+namespace
+{
+
+/**
+ * Gets a random point on the horizon of the current view,
+ * where pointBack() is on the fence.
+ * @param cenLon Longitude of the center of the view.
+ * @param cenLat Latitude of the center of the view.
+ * @param lon Receives the longitude of the point.
+ * @param lat Receives the latitude of the point.
+ */
+void horizonPoint(double cenLon, double cenLat, double *lon, double *lat)
+{
+	// a mix of the directions east and north of the center
+	double t = RNG::generate(0.0, 2 * M_PI);
+	double x = -cos(t) * sin(cenLon) - sin(t) * sin(cenLat) * cos(cenLon);
+	double y = cos(t) * cos(cenLon) - sin(t) * sin(cenLat) * sin(cenLon);
+	double z = sin(t) * cos(cenLat);
+	*lon = atan2(y, x);
+	*lat = asin(std::max(-1.0, std::min(1.0, z)));
+}
+
+/**
+ * Checks projecting whole sets of points against polarToCart() and
+ * pointBack(), one point at a time, from random views. Besides
+ * random points, a quarter of them are right on a pixel (as
+ * picked by the player) and a quarter are on the horizon, where
+ * rounding is most likely to tip them the other way.
+ * @param results List to add the results to.
+ * @param globe Pointer to the globe.
+ * @param views Number of views.
+ */
+void project(std::vector<Result> *results, Globe *globe, int views)
+{
+	const int count = 2000;
+	int mismatches = 0;
+	double reference = 0, seconds = 0, total = 0;
+	std::vector<double> lons(count), lats(count);
+	Timer timer;
+	for (int v = 0; v < views; ++v)
+	{
+		double cenLon = RNG::generate(0.0, 2 * M_PI), cenLat = RNG::generate(-M_PI / 2, M_PI / 2);
+		globe->center(cenLon, cenLat);
+		globe->zoomMin();
+		for (int zoom = RNG::generate(0, 5); zoom > 0; --zoom)
+		{
+			globe->zoomIn();
+		}
+
+		GlobePoints points;
+		for (int i = 0; i < count; ++i)
+		{
+			double lon = RNG::generate(0.0, 2 * M_PI), lat = asin(RNG::generate(-1.0, 1.0));
+			if (i % 4 == 1)
+			{
+				double pixelLon, pixelLat;
+				globe->cartToPolar(RNG::generate(0, globe->getWidth() - 1), RNG::generate(0, globe->getHeight() - 1), &pixelLon, &pixelLat);
+				// pixels off the globe don't have a point
+				if (pixelLat == pixelLat && pixelLon == pixelLon)
+				{
+					lon = pixelLon;
+					lat = pixelLat;
+				}
+			}
+			else if (i % 4 == 3)
+			{
+				horizonPoint(cenLon, cenLat, &lon, &lat);
+			}
+			lons[i] = lon;
+			lats[i] = lat;
+			points.add(lon, lat);
+		}
+
+		timer.start();
+		globe->projectPoints(&points);
+		seconds += timer.elapsed();
+
+		timer.start();
+		int wrong = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			Sint16 x, y;
+			globe->polarToCart(lons[i], lats[i], &x, &y);
+			bool front = !globe->pointBack(lons[i], lats[i]);
+			if (x != points.screenX[i] || y != points.screenY[i] || front != (points.front[i] != 0))
+			{
+				++wrong;
+			}
+		}
+		reference += timer.elapsed();
+		mismatches += wrong;
+		total += points.screenX[v % count] + points.screenY[v % count];
+	}
+	Result result;
+	result.name = "globe.project";
+	result.seconds = seconds;
+	result.iterations = views;
+	result.values.push_back(std::make_pair(std::string("points"), (double)count));
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	result.values.push_back(std::make_pair(std::string("referenceSeconds"), reference));
+	result.values.push_back(std::make_pair(std::string("checksum"), total));
+	results->push_back(result);
+}
+
+/**
+ * Gets a random point on an edge of a land polygon, nudged off it
+ * by a tiny bit, where the margins of the grid matter the most.
+ * @param polygons List of land polygons.
+ * @param lon Receives the longitude of the point.
+ * @param lat Receives the latitude of the point.
+ */
+void edgePoint(const std::vector<Polygon*> &polygons, double *lon, double *lat)
+{
+	Polygon *poly = polygons[RNG::generate(0, polygons.size() - 1)];
+	int i = RNG::generate(0, poly->getPoints() - 1), j = (i + 1) % poly->getPoints();
+	double t = RNG::generate(0.0, 1.0);
+	double x = (1 - t) * cos(poly->getLatitude(i)) * cos(poly->getLongitude(i)) + t * cos(poly->getLatitude(j)) * cos(poly->getLongitude(j));
+	double y = (1 - t) * cos(poly->getLatitude(i)) * sin(poly->getLongitude(i)) + t * cos(poly->getLatitude(j)) * sin(poly->getLongitude(j));
+	double z = (1 - t) * sin(poly->getLatitude(i)) + t * sin(poly->getLatitude(j));
+	*lon = atan2(y, x) + RNG::generate(-1e-4, 1e-4);
+	*lat = atan2(z, sqrt(x * x + y * y)) + RNG::generate(-1e-4, 1e-4);
+	if (*lon < 0)
+		*lon += 2 * M_PI;
+}
+
+/**
+ * Checks finding the land polygon under a point through the grid
+ * against checking every polygon, over random points. Besides points
+ * all over the globe, a sixth of them are near the poles, a sixth are
+ * along longitude 0 on either side, a sixth are right on the poles or
+ * on longitude 0 and a sixth are right next to the edges of polygons.
+ * @param results List to add the results to.
+ * @param globe Pointer to the globe.
+ * @param polygons List of land polygons.
+ * @param count Number of points.
+ */
+void land(std::vector<Result> *results, Globe *globe, const std::vector<Polygon*> &polygons, int count)
+{
+	std::vector<double> lons(count), lats(count);
+	for (int i = 0; i < count; ++i)
+	{
+		double lon = RNG::generate(0.0, 2 * M_PI), lat = asin(RNG::generate(-1.0, 1.0));
+		switch (i % 6)
+		{
+		case 1:
+			lat = (RNG::generate(0, 1) ? 1 : -1) * (M_PI / 2 - RNG::generate(0.0, 6 * M_PI / 180));
+			break;
+		case 2:
+			lon = RNG::generate(-M_PI / 180, M_PI / 180);
+			if (lon < 0)
+				lon += 2 * M_PI;
+			break;
+		case 3:
+			if (RNG::generate(0, 1))
+				lat = (RNG::generate(0, 1) ? 1 : -1) * M_PI / 2;
+			else
+				lon = 0;
+			break;
+		case 4:
+			if (!polygons.empty())
+				edgePoint(polygons, &lon, &lat);
+			break;
+		}
+		lons[i] = lon;
+		lats[i] = lat;
+	}
+
+	std::vector<Polygon*> found(count);
+	Timer timer;
+	for (int i = 0; i < count; ++i)
+	{
+		found[i] = globe->locatePolygon(lons[i], lats[i]);
+	}
+	double seconds = timer.elapsed();
+
+	timer.start();
+	int mismatches = 0, inside = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		Polygon *expected = globe->scanPolygons(lons[i], lats[i]);
+		if (found[i] != expected)
+			++mismatches;
+		if (expected != 0)
+			++inside;
+	}
+	double reference = timer.elapsed();
+
+	Result result;
+	result.name = "globe.land";
+	result.seconds = seconds;
+	result.iterations = count;
+	result.values.push_back(std::make_pair(std::string("polygons"), (double)polygons.size()));
+	result.values.push_back(std::make_pair(std::string("inside"), (double)inside));
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	result.values.push_back(std::make_pair(std::string("referenceSeconds"), reference));
+	results->push_back(result);
+}
+
+}
+
+/**
+ * Sets up a geoscape globe on a new game, without any display,
+ * and checks its shortcuts against the plain formulas.
+ * @param results List to add the results to.
+ * @param views Number of views of the globe to check.
+ * @param points Number of points to look up on the land.
+ * @param seed Random seed.
+ */
+void globe(std::vector<Result> *results, int views, int points, unsigned int seed)
+{
+	SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+	Options::setBool("mute", true);
+	Options::setBool("fpsCounter", false);
+	Options::setBool("profiler", false);
+	Game game("openxcom-bench");
+	game.setResourcePack(new XcomResourcePack());
+	game.loadLanguage("English");
+	game.loadRuleset();
+	game.setSavedGame(game.getRuleset()->newSave());
+	Globe globe(&game, 128, 100, 256, 200);
+
+	std::vector<Polygon*> polygons(game.getResourcePack()->getPolygons()->begin(), game.getResourcePack()->getPolygons()->end());
+
+	RNG::init(0, seed);
+	project(results, &globe, views);
+	land(results, &globe, polygons, points);
+}
+
+}
+
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include "../src/Engine/RNG.h"
+#include "../src/Ruleset/MapData.h"
+#include "../src/Ruleset/MapDataSet.h"
+#include "../src/Ruleset/Armor.h"
+#include "../src/Ruleset/Unit.h"
+#include "../src/Savegame/SavedBattleGame.h"
+#include "../src/Savegame/BattleUnit.h"
+#include "../src/Savegame/Tile.h"
+#include "../src/Battlescape/Pathfinding.h"
+#include "../src/Battlescape/Position.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+/**
+ * Runs random A* queries and reachability searches for a single walking
+ * unit on a generated map, scattered with walls and obstacles so the
+ * searches have to work around them. The map and queries only depend
+ * on the seed, so runs are comparable between builds.
+ * @param results List to add the results to.
+ * @param queries Number of path queries.
+ * @param seed Random seed.
+ */
+void pathfinding(std::vector<Result> *results, int queries, unsigned int seed)
+{
+	const int sizeX = 60, sizeY = 60, sizeZ = 4;
+	RNG::init(0, seed);
+
+	MapDataSet set("BENCH");
+	MapData *floor = createPart(&set, 4);
+	MapData *wall = createPart(&set, 255);
+	MapData *block = createPart(&set, 255);
+	MapData *rough = createPart(&set, 6);
+
+	SavedBattleGame save;
+	save.initMap(sizeX, sizeY, sizeZ);
+	std::vector<Position> floorTiles;
+	for (int x = 0; x < sizeX; ++x)
+	{
+		for (int y = 0; y < sizeY; ++y)
+		{
+			Tile *tile = save.getTile(Position(x, y, 0));
+			tile->setMapData(floor, 0, 0, MapData::O_FLOOR);
+			int roll = RNG::generate(0, 99);
+			if (roll < 6)
+			{
+				tile->setMapData(wall, 1, 0, MapData::O_WESTWALL);
+			}
+			else if (roll < 12)
+			{
+				tile->setMapData(wall, 1, 0, MapData::O_NORTHWALL);
+			}
+			if (roll >= 90)
+			{
+				tile->setMapData(block, 2, 0, MapData::O_OBJECT);
+			}
+			else
+			{
+				if (roll >= 80)
+				{
+					tile->setMapData(rough, 3, 0, MapData::O_OBJECT);
+				}
+				floorTiles.push_back(Position(x, y, 0));
+			}
+		}
+	}
+
+	Unit rules("BENCH_UNIT", "STR_HUMAN", "STR_RANK_NONE");
+	Armor armor("BENCH_ARMOR", "XCOM_0.PCK", 0, MT_WALK, 1);
+	BattleUnit *unit = new BattleUnit(&rules, FACTION_PLAYER, 0, &armor);
+	unit->setTimeUnits(100);
+	save.getUnits()->push_back(unit);
+	Pathfinding pf(&save);
+
+	std::vector<std::pair<Position, Position> > pairs;
+	for (int i = 0; i < queries; ++i)
+	{
+		Position start = floorTiles[RNG::generate(0, floorTiles.size() - 1)];
+		Position end = floorTiles[RNG::generate(0, floorTiles.size() - 1)];
+		pairs.push_back(std::make_pair(start, end));
+	}
+
+	int found = 0, steps = 0;
+	Timer timer;
+	for (std::vector<std::pair<Position, Position> >::const_iterator i = pairs.begin(); i != pairs.end(); ++i)
+	{
+		unit->setPosition(i->first);
+		pf.calculate(unit, i->second);
+		if (pf.getStartDirection() != -1)
+			++found;
+		while (pf.dequeuePath() != -1)
+			++steps;
+	}
+	Result astar;
+	astar.name = "pathfinding.astar";
+	astar.seconds = timer.elapsed();
+	astar.iterations = queries;
+	astar.values.push_back(std::make_pair(std::string("found"), (double)found));
+	astar.values.push_back(std::make_pair(std::string("steps"), (double)steps));
+	results->push_back(astar);
+
+	int searches = queries / 10 + 1, tiles = 0;
+	timer.start();
+	for (int i = 0; i < searches; ++i)
+	{
+		unit->setPosition(pairs[i % pairs.size()].first);
+		tiles += pf.findReachable(unit, 100).size();
+	}
+	Result reachable;
+	reachable.name = "pathfinding.reachable";
+	reachable.seconds = timer.elapsed();
+	reachable.iterations = searches;
+	reachable.values.push_back(std::make_pair(std::string("tiles"), (double)tiles));
+	results->push_back(reachable);
+
+	for (std::vector<MapData*>::iterator i = set.getObjects()->begin(); i != set.getObjects()->end(); ++i)
+	{
+		delete *i;
+	}
+}
+
+}
+
+}
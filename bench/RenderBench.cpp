@@ -0,0 +1,217 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <SDL.h>
+#include "../src/lodepng.h"
+#include "../src/Engine/Game.h"
+#include "../src/Engine/Screen.h"
+#include "../src/Engine/Surface.h"
+#include "../src/Engine/Options.h"
+#include "../src/Engine/CrossPlatform.h"
+#include "../src/Resource/XcomResourcePack.h"
+#include "../src/Savegame/SavedGame.h"
+#include "../src/Savegame/SavedBattleGame.h"
+#include "../src/Battlescape/BattlescapeState.h"
+#include "../src/Battlescape/Map.h"
+#include "../src/Battlescape/Camera.h"
+#include "../src/Battlescape/Position.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+namespace
+{
+
+/**
+ * Fills in the timings of one stage of drawing a frame.
+ * @param name Stage name.
+ * @param times Time each frame spent in the stage, in seconds.
+ * @return New result.
+ */
+Result stage(const std::string &name, const std::vector<double> &times)
+{
+	Result result;
+	result.name = name;
+	result.iterations = times.size();
+	result.seconds = 0;
+	double slowest = 0;
+	for (std::vector<double>::const_iterator i = times.begin(); i != times.end(); ++i)
+	{
+		result.seconds += *i;
+		slowest = std::max(slowest, *i);
+	}
+	result.values.push_back(std::make_pair(std::string("slowestMs"), slowest * 1000.0));
+	return result;
+}
+
+/**
+ * Reads the display surface back as RGB, whatever format it's in.
+ * @param surface Display surface.
+ * @param rgb Receives the pixels, three bytes each.
+ */
+void readPixels(SDL_Surface *surface, std::vector<unsigned char> *rgb)
+{
+	rgb->resize(surface->w * surface->h * 3);
+	SDL_LockSurface(surface);
+	int bpp = surface->format->BytesPerPixel;
+	for (int y = 0; y < surface->h; ++y)
+	{
+		Uint8 *row = (Uint8*)surface->pixels + y * surface->pitch;
+		for (int x = 0; x < surface->w; ++x)
+		{
+			Uint32 pixel = 0;
+			memcpy(&pixel, row + x * bpp, bpp);
+			Uint8 *out = &(*rgb)[(y * surface->w + x) * 3];
+			SDL_GetRGB(pixel, surface->format, out, out + 1, out + 2);
+		}
+	}
+	SDL_UnlockSurface(surface);
+}
+
+}
+
+/**
+ * Draws battlescape frames from a saved game without a display, through
+ * SDL's dummy video driver: the camera follows a fixed path over the
+ * map, and every frame goes through caching the units, drawing the
+ * terrain, blitting the map and interface and zooming the screen, each
+ * timed separately. The frames are hashed, and if a folder of golden
+ * images is given, compared against the images in it, or written
+ * there if they don't exist yet.
+ * @param results List to add the results to.
+ * @param filename Path of the .sav file.
+ * @param frames Number of frames.
+ * @param golden Folder of the golden images, empty for none.
+ */
+void render(std::vector<Result> *results, const std::string &filename, int frames, const std::string &golden)
+{
+	std::string name = filename;
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sav") == 0)
+	{
+		name = name.substr(0, name.size() - 4);
+	}
+
+	SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+	Options::setBool("mute", true);
+	Options::setBool("fpsCounter", false);
+	Options::setBool("profiler", false);
+	Game game("openxcom-bench");
+	game.setResourcePack(new XcomResourcePack());
+	game.loadLanguage("English");
+	game.loadRuleset();
+	SavedGame *save = new SavedGame();
+	game.setSavedGame(save);
+	save->load(name, game.getRuleset());
+	SavedBattleGame *battle = save->getBattleGame();
+	if (battle == 0)
+	{
+		std::cerr << filename << " is not a battlescape save, skipping the render benchmark" << std::endl;
+		return;
+	}
+	battle->loadMapResources(&game);
+	BattlescapeState *state = new BattlescapeState(&game);
+	game.setState(state);
+	battle->setBattleState(state);
+	state->init();
+
+	Screen *screen = game.getScreen();
+	Map *map = state->getMap();
+	std::vector<double> units, terrain, hud, flip;
+	std::vector<unsigned char> rgb, expected;
+	Uint32 hash = 2166136261u;
+	int mismatches = 0, written = 0;
+	Timer timer;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		// sweep back and forth over the whole map, a level at a time
+		double t = frame * 0.05;
+		Position pos((int)((battle->getMapSizeX() - 1) * (0.5 + 0.5 * sin(t * 1.3))),
+					(int)((battle->getMapSizeY() - 1) * (0.5 + 0.5 * cos(t))),
+					(frame * battle->getMapSizeZ() / frames));
+		map->getCamera()->centerOnPosition(pos, false);
+
+		timer.start();
+		map->cacheUnits();
+		units.push_back(timer.elapsed());
+
+		timer.start();
+		map->draw();
+		terrain.push_back(timer.elapsed());
+
+		timer.start();
+		screen->clear();
+		state->blit();
+		hud.push_back(timer.elapsed());
+
+		timer.start();
+		screen->flip();
+		flip.push_back(timer.elapsed());
+
+		readPixels(SDL_GetVideoSurface(), &rgb);
+		for (std::vector<unsigned char>::const_iterator i = rgb.begin(); i != rgb.end(); ++i)
+		{
+			hash = (hash ^ *i) * 16777619u;
+		}
+		if (!golden.empty())
+		{
+			std::stringstream ss;
+			ss << CrossPlatform::endPath(golden) << "frame" << std::setfill('0') << std::setw(3) << frame << ".png";
+			unsigned w, h;
+			if (CrossPlatform::fileExists(ss.str()))
+			{
+				if (lodepng::decode(expected, w, h, ss.str(), LCT_RGB) != 0 || (int)w != screen->getWidth() || (int)h != screen->getHeight() || expected != rgb)
+					++mismatches;
+			}
+			else if (lodepng::encode(ss.str(), rgb, screen->getWidth(), screen->getHeight(), LCT_RGB) == 0)
+			{
+				++written;
+			}
+		}
+	}
+
+	results->push_back(stage("render.units", units));
+	results->push_back(stage("render.terrain", terrain));
+	results->push_back(stage("render.interface", hud));
+	results->push_back(stage("render.flip", flip));
+	Result result;
+	result.name = "render.frames";
+	result.iterations = frames;
+	result.seconds = 0;
+	for (int i = 0; i < frames; ++i)
+	{
+		result.seconds += units[i] + terrain[i] + hud[i] + flip[i];
+	}
+	result.values.push_back(std::make_pair(std::string("hash"), (double)hash));
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	result.values.push_back(std::make_pair(std::string("written"), (double)written));
+	results->push_back(result);
+}
+
+}
+
+}
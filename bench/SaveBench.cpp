@@ -0,0 +1,479 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <cstdio>
+#include <map>
+#include "../src/Engine/RNG.h"
+#include "../src/Engine/Options.h"
+#include "../src/Engine/CrossPlatform.h"
+#include "../src/Resource/ResourcePack.h"
+#include "../src/Ruleset/Ruleset.h"
+#include "../src/Ruleset/MapData.h"
+#include "../src/Ruleset/MapDataSet.h"
+#include "../src/Ruleset/Armor.h"
+#include "../src/Savegame/SavedGame.h"
+#include "../src/Savegame/SavedBattleGame.h"
+#include "../src/Savegame/BattleUnit.h"
+#include "../src/Savegame/Tile.h"
+#include "../src/Savegame/GameTime.h"
+#include "../src/Savegame/Base.h"
+#include "../src/Savegame/Craft.h"
+#include "../src/Savegame/Ufo.h"
+#include "../src/Battlescape/TileEngine.h"
+#include "../src/Battlescape/Pathfinding.h"
+#include "../src/Battlescape/PatrolBAIState.h"
+#include "../src/Battlescape/BattlescapeGame.h"
+#include "../src/Battlescape/Position.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+namespace
+{
+
+/**
+ * Fills in the result of a workload.
+ * @param name Workload name.
+ * @param iterations Number of iterations.
+ * @param timer Timer started at the beginning of the workload.
+ * @param allocated Allocation count at the beginning of the workload.
+ * @return New result.
+ */
+Result finish(const std::string &name, int iterations, const Timer &timer, size_t allocated)
+{
+	Result result;
+	result.name = name;
+	result.seconds = timer.elapsed();
+	result.iterations = iterations;
+	result.values.push_back(std::make_pair(std::string("allocations"), (double)(allocations() - allocated)));
+	return result;
+}
+
+/**
+ * Loads a saved game, with the map resources of the battle in it if any.
+ * @param filename Path of the save, without the extension.
+ * @param rules Ruleset for the save.
+ * @param res Resource pack with the voxel data.
+ * @return New saved game.
+ */
+SavedGame *loadSave(const std::string &filename, Ruleset *rules, ResourcePack *res)
+{
+	SavedGame *save = new SavedGame();
+	save->load(filename, rules);
+	if (save->getBattleGame() != 0)
+	{
+		save->getBattleGame()->loadMapResources(res, rules);
+	}
+	return save;
+}
+
+/**
+ * Gets all the units still in the battle that take up a single tile.
+ * @param battle Pointer to the battle.
+ * @param faction Only get units of this faction, or all of them for -1.
+ * @return List of units.
+ */
+std::vector<BattleUnit*> getUnits(SavedBattleGame *battle, int faction)
+{
+	std::vector<BattleUnit*> units;
+	for (std::vector<BattleUnit*>::iterator i = battle->getUnits()->begin(); i != battle->getUnits()->end(); ++i)
+	{
+		if (!(*i)->isOut() && (*i)->getArmor()->getSize() == 1 && (faction == -1 || (*i)->getFaction() == faction))
+		{
+			units.push_back(*i);
+		}
+	}
+	return units;
+}
+
+/**
+ * Recalculates the field of view of every unit from scratch.
+ * @param results List to add the results to.
+ * @param battle Pointer to the battle.
+ * @param repeats Number of times to recalculate everything.
+ */
+void fov(std::vector<Result> *results, SavedBattleGame *battle, int repeats)
+{
+	int visible = 0;
+	size_t allocated = allocations();
+	Timer timer;
+	for (int i = 0; i < repeats; ++i)
+	{
+		battle->getTileEngine()->invalidateFOV();
+		for (std::vector<BattleUnit*>::iterator j = battle->getUnits()->begin(); j != battle->getUnits()->end(); ++j)
+		{
+			if (!(*j)->isOut())
+			{
+				battle->getTileEngine()->calculateFOV(*j);
+				visible += (*j)->getVisibleUnits()->size();
+			}
+		}
+	}
+	Result result = finish("replay.fov", repeats, timer, allocated);
+	result.values.push_back(std::make_pair(std::string("visible"), (double)visible));
+	results->push_back(result);
+}
+
+/**
+ * Runs path queries from random units in the battle to random floor tiles.
+ * @param results List to add the results to.
+ * @param battle Pointer to the battle.
+ * @param queries Number of path queries.
+ */
+void paths(std::vector<Result> *results, SavedBattleGame *battle, int queries)
+{
+	std::vector<BattleUnit*> units = getUnits(battle, -1);
+	std::vector<Position> floors;
+	for (int i = 0; i < battle->getMapSizeXYZ(); ++i)
+	{
+		Tile *tile = battle->getTile(i);
+		if (tile->getMapData(MapData::O_FLOOR) != 0 && tile->getMapData(MapData::O_OBJECT) == 0)
+		{
+			floors.push_back(tile->getPosition());
+		}
+	}
+	if (units.empty() || floors.empty())
+		return;
+
+	std::vector<std::pair<BattleUnit*, Position> > pairs;
+	for (int i = 0; i < queries; ++i)
+	{
+		BattleUnit *unit = units[RNG::generate(0, units.size() - 1)];
+		pairs.push_back(std::make_pair(unit, floors[RNG::generate(0, floors.size() - 1)]));
+	}
+
+	Pathfinding *pf = battle->getPathfinding();
+	int found = 0, steps = 0;
+	size_t allocated = allocations();
+	Timer timer;
+	for (std::vector<std::pair<BattleUnit*, Position> >::const_iterator i = pairs.begin(); i != pairs.end(); ++i)
+	{
+		pf->calculate(i->first, i->second);
+		if (pf->getStartDirection() != -1)
+			++found;
+		while (pf->dequeuePath() != -1)
+			++steps;
+	}
+	Result result = finish("replay.pathfinding", queries, timer, allocated);
+	result.values.push_back(std::make_pair(std::string("found"), (double)found));
+	result.values.push_back(std::make_pair(std::string("steps"), (double)steps));
+	results->push_back(result);
+}
+
+/**
+ * Plays a number of alien turns: every alien gets its time units back,
+ * picks a patrol node to go to, walks there as far as its time units
+ * allow and looks around. The aggressive AI needs the battlescape
+ * itself, so this only exercises the patrolling behaviour.
+ * @param results List to add the results to.
+ * @param battle Pointer to the battle.
+ * @param turns Number of turns.
+ */
+void ai(std::vector<Result> *results, SavedBattleGame *battle, int turns)
+{
+	std::vector<BattleUnit*> aliens = getUnits(battle, FACTION_HOSTILE);
+	std::map<BattleUnit*, PatrolBAIState*> states;
+	for (std::vector<BattleUnit*>::iterator i = aliens.begin(); i != aliens.end(); ++i)
+	{
+		states[*i] = new PatrolBAIState(battle, *i, 0);
+	}
+
+	TileEngine *te = battle->getTileEngine();
+	Pathfinding *pf = battle->getPathfinding();
+	int moves = 0, steps = 0;
+	size_t allocated = allocations();
+	Timer timer;
+	for (int turn = 0; turn < turns; ++turn)
+	{
+		for (std::vector<BattleUnit*>::iterator i = aliens.begin(); i != aliens.end(); ++i)
+		{
+			BattleUnit *unit = *i;
+			unit->setTimeUnits(unit->getStats()->tu);
+			te->calculateFOV(unit);
+
+			BattleAction action;
+			action.number = 1;
+			states[unit]->think(&action);
+			if (action.type != BA_WALK)
+				continue;
+
+			pf->calculate(unit, action.target);
+			if (pf->getStartDirection() != -1)
+				++moves;
+			int dir;
+			while ((dir = pf->dequeuePath()) != -1)
+			{
+				Position dest;
+				int cost = pf->getTUCost(unit->getPosition(), dir, &dest, unit, 0, false);
+				if (cost >= 255 || cost > unit->getTimeUnits())
+					break;
+				unit->setTimeUnits(unit->getTimeUnits() - cost);
+				battle->getTile(unit->getPosition())->setUnit(0);
+				unit->setPosition(dest);
+				battle->getTile(dest)->setUnit(unit, battle->getTile(dest + Position(0, 0, -1)));
+				++steps;
+			}
+			pf->abortPath();
+			te->calculateFOV(unit);
+		}
+	}
+	Result result = finish("replay.ai", turns, timer, allocated);
+	result.values.push_back(std::make_pair(std::string("aliens"), (double)aliens.size()));
+	result.values.push_back(std::make_pair(std::string("moves"), (double)moves));
+	result.values.push_back(std::make_pair(std::string("steps"), (double)steps));
+	results->push_back(result);
+
+	for (std::map<BattleUnit*, PatrolBAIState*>::iterator i = states.begin(); i != states.end(); ++i)
+	{
+		delete i->second;
+	}
+}
+
+/**
+ * Sets every tile with a flammable object on its last turn of fire and
+ * starts a new turn, so the objects burn away. Then checks the cached
+ * step costs around those tiles and the voxels in them against a fresh
+ * pathfinding and tile engine that have nothing cached yet.
+ * @param results List to add the results to.
+ * @param battle Pointer to the battle.
+ * @param res Resource pack with the voxel data.
+ */
+void burn(std::vector<Result> *results, SavedBattleGame *battle, ResourcePack *res)
+{
+	std::vector<BattleUnit*> units = getUnits(battle, -1);
+	std::vector<Position> burning;
+	for (int i = 0; i < battle->getMapSizeXYZ(); ++i)
+	{
+		Tile *tile = battle->getTile(i);
+		MapData *object = tile->getMapData(MapData::O_OBJECT);
+		if (object != 0 && object->getFlammable() < 255 && object->getSpecialType() != MUST_DESTROY)
+		{
+			burning.push_back(tile->getPosition());
+		}
+	}
+	if (units.empty() || burning.empty())
+		return;
+
+	// steps from the burning tiles and their neighbours, cached before the fire
+	BattleUnit *unit = units.front();
+	Pathfinding *pf = battle->getPathfinding();
+	pf->calculate(unit, unit->getPosition());
+	std::vector<std::pair<Position, int> > steps;
+	std::vector<int> before;
+	for (std::vector<Position>::iterator i = burning.begin(); i != burning.end(); ++i)
+	{
+		for (int x = -1; x <= 1; ++x)
+		{
+			for (int y = -1; y <= 1; ++y)
+			{
+				Position start = *i + Position(x, y, 0);
+				if (battle->getTile(start) == 0)
+					continue;
+				for (int dir = 0; dir < 10; ++dir)
+				{
+					Position end;
+					steps.push_back(std::make_pair(start, dir));
+					before.push_back(pf->getTUCost(start, dir, &end, unit, 0, false));
+				}
+			}
+		}
+		battle->getTile(*i)->setFire(1);
+	}
+	// builds the voxel planes of the tiles before the fire
+	battle->getTileEngine()->voxelCheck(Position(0, 0, 0), 0, true);
+
+	size_t allocated = allocations();
+	Timer timer;
+	battle->prepareNewTurn();
+	Result result = finish("replay.burn", 1, timer, allocated);
+
+	Pathfinding fresh(battle);
+	fresh.calculate(unit, unit->getPosition());
+	int changed = 0, mismatches = 0;
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		Position end, freshEnd;
+		int cost = pf->getTUCost(steps[i].first, steps[i].second, &end, unit, 0, false);
+		int freshCost = fresh.getTUCost(steps[i].first, steps[i].second, &freshEnd, unit, 0, false);
+		if (cost != before[i])
+			++changed;
+		if (cost != freshCost || (cost < 255 && end != freshEnd))
+			++mismatches;
+	}
+
+	TileEngine freshEngine(battle, res->getVoxelData());
+	for (std::vector<Position>::iterator i = burning.begin(); i != burning.end(); ++i)
+	{
+		for (int z = 0; z < 24; ++z)
+		{
+			for (int y = 0; y < 16; ++y)
+			{
+				for (int x = 0; x < 16; ++x)
+				{
+					Position voxel = Position(i->x * 16 + x, i->y * 16 + y, i->z * 24 + z);
+					if (battle->getTileEngine()->voxelCheck(voxel, 0, true) != freshEngine.voxelCheck(voxel, 0, true))
+						++mismatches;
+				}
+			}
+		}
+	}
+	result.values.push_back(std::make_pair(std::string("tiles"), (double)burning.size()));
+	result.values.push_back(std::make_pair(std::string("changed"), (double)changed));
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	results->push_back(result);
+}
+
+/**
+ * Saves the game and loads it back a number of times.
+ * @param results List to add the results to.
+ * @param save Pointer to the saved game.
+ * @param filename Path of the original save, without the extension.
+ * @param rules Ruleset for the save.
+ * @param res Resource pack with the voxel data.
+ * @param repeats Number of round-trips.
+ */
+void roundTrip(std::vector<Result> *results, SavedGame *save, const std::string &filename, Ruleset *rules, ResourcePack *res, int repeats)
+{
+	std::string copy = filename + "_bench";
+	size_t allocated = allocations();
+	Timer timer;
+	for (int i = 0; i < repeats; ++i)
+	{
+		save->save(copy);
+		delete loadSave(copy, rules, res);
+	}
+	results->push_back(finish("replay.roundtrip", repeats, timer, allocated));
+	remove((Options::getUserFolder() + copy + ".sav").c_str());
+}
+
+/**
+ * Runs thirty days of five-second geoscape ticks: moving every UFO
+ * and craft, and looking up the region and country of every UFO
+ * every half hour. The rest of the geoscape logic needs the geoscape
+ * itself, so UFOs just stop where they arrive.
+ * @param results List to add the results to.
+ * @param save Pointer to the saved game.
+ */
+void geoscape(std::vector<Result> *results, SavedGame *save)
+{
+	const int ticks = 30 * 24 * 720;
+	int arrivals = 0, lookups = 0;
+	size_t allocated = allocations();
+	Timer timer;
+	for (int tick = 0; tick < ticks; ++tick)
+	{
+		TimeTrigger trigger = save->getTime()->advance();
+		for (std::vector<Ufo*>::iterator i = save->getUfos()->begin(); i != save->getUfos()->end(); ++i)
+		{
+			Ufo *ufo = *i;
+			if (ufo->getStatus() == Ufo::FLYING && !ufo->reachedDestination())
+			{
+				ufo->think();
+				if (ufo->reachedDestination())
+					++arrivals;
+			}
+			else if (ufo->getStatus() == Ufo::LANDED && ufo->getSecondsRemaining() >= 5)
+			{
+				ufo->think();
+			}
+		}
+		for (std::vector<Base*>::iterator i = save->getBases()->begin(); i != save->getBases()->end(); ++i)
+		{
+			for (std::vector<Craft*>::iterator j = (*i)->getCrafts()->begin(); j != (*i)->getCrafts()->end(); ++j)
+			{
+				if ((*j)->getStatus() == "STR_OUT")
+					(*j)->think();
+			}
+		}
+		if (trigger >= TIME_30MIN)
+		{
+			for (std::vector<Ufo*>::iterator i = save->getUfos()->begin(); i != save->getUfos()->end(); ++i)
+			{
+				if (save->locateRegion(**i))
+					++lookups;
+				if (save->locateCountry(**i))
+					++lookups;
+			}
+		}
+	}
+	Result result = finish("replay.geoscape", ticks, timer, allocated);
+	result.values.push_back(std::make_pair(std::string("ufos"), (double)save->getUfos()->size()));
+	result.values.push_back(std::make_pair(std::string("arrivals"), (double)arrivals));
+	result.values.push_back(std::make_pair(std::string("lookups"), (double)lookups));
+	results->push_back(result);
+}
+
+}
+
+/**
+ * Loads a saved game along with the rulesets, without any display,
+ * and replays workloads on it: field of view, path queries, alien
+ * turns and burning terrain on the battle in it (if any), saving and
+ * loading, and a month of geoscape ticks.
+ * @param results List to add the results to.
+ * @param filename Path of the .sav file.
+ * @param queries Number of path queries.
+ * @param turns Number of alien turns.
+ * @param seed Random seed.
+ */
+void replay(std::vector<Result> *results, const std::string &filename, int queries, int turns, unsigned int seed)
+{
+	std::string name = filename;
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sav") == 0)
+	{
+		name = name.substr(0, name.size() - 4);
+	}
+
+	Ruleset rules;
+	std::vector<std::string> rulesets = Options::getRulesets();
+	for (std::vector<std::string>::iterator i = rulesets.begin(); i != rulesets.end(); ++i)
+	{
+		rules.load(*i);
+	}
+	ResourcePack res;
+	MapDataSet::loadLOFTEMPS(CrossPlatform::getDataFile("GEODATA/LOFTEMPS.DAT"), res.getVoxelData());
+
+	size_t allocated = allocations();
+	Timer timer;
+	SavedGame *save = loadSave(name, &rules, &res);
+	results->push_back(finish("replay.load", 1, timer, allocated));
+
+	RNG::init(0, seed);
+	SavedBattleGame *battle = save->getBattleGame();
+	if (battle != 0)
+	{
+		fov(results, battle, 10);
+		paths(results, battle, queries);
+		ai(results, battle, turns);
+		burn(results, battle, &res);
+	}
+	delete save;
+
+	save = loadSave(name, &rules, &res);
+	roundTrip(results, save, name, &rules, &res, 5);
+	geoscape(results, save);
+	delete save;
+}
+
+}
+
+}
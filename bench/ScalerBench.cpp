@@ -0,0 +1,244 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include "Benchmark.h"
+#include "../src/Engine/RNG.h"
+#include "../src/Engine/Options.h"
+#include "../src/Engine/ThreadPool.h"
+#include "../src/Engine/Zoom.h"
+#include "../src/Engine/Scalers/hqx.h"
+#include "../src/Engine/Scalers/common.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+/**
+ * Gets how much memory the process currently has resident.
+ * @return Resident memory in KiB, or 0 if unknown.
+ */
+static double residentMemory()
+{
+	double kb = 0;
+#ifdef __linux__
+	FILE *file = fopen("/proc/self/status", "r");
+	if (file)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), file))
+		{
+			if (strncmp(line, "VmRSS:", 6) == 0)
+			{
+				kb = atof(line + 6);
+				break;
+			}
+		}
+		fclose(file);
+	}
+#endif
+	return kb;
+}
+
+/**
+ * Checks the RGB to YUV conversion of the HQX scalers against the
+ * floating point formula over every color, then times the hq2x, hq3x
+ * and hq4x scalers on a generated screen with a 256 color palette.
+ * @param results List to add the results to.
+ * @param frames Number of frames to scale with each scaler.
+ * @param seed Random seed.
+ */
+void hqx(std::vector<Result> *results, int frames, unsigned int seed)
+{
+	const int width = 320, height = 200;
+	RNG::init(0, seed);
+	double before = residentMemory();
+
+	Timer timer;
+	hqxInit();
+	Result init;
+	init.name = "hqx.init";
+	init.seconds = timer.elapsed();
+	init.iterations = 1;
+
+	int mismatches = 0;
+	for (uint32_t c = 0; c <= MASK_RGB; ++c)
+	{
+		uint32_t r = (c & 0xFF0000) >> 16, g = (c & 0x00FF00) >> 8, b = c & 0x0000FF;
+		uint32_t y = (uint32_t)(0.299*r + 0.587*g + 0.114*b);
+		uint32_t u = (uint32_t)((int)(-0.169*r - 0.331*g + 0.5*b) + 128);
+		uint32_t v = (uint32_t)((int)(0.5*r - 0.419*g - 0.081*b) + 128);
+		if (rgb_to_yuv(c | MASK_ALPHA) != (y << 16) + (u << 8) + v)
+			++mismatches;
+	}
+	hqxInit();
+	init.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	results->push_back(init);
+
+	std::vector<uint32_t> palette(256), screen(width * height), scaled(width * height * 16);
+	for (size_t i = 0; i < palette.size(); ++i)
+	{
+		palette[i] = RNG::generate(0, MASK_RGB);
+	}
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			// blocky shapes with some noise, like terrain and interface graphics
+			int color = (x / 4) ^ (y / 6);
+			if (RNG::generate(0, 3) == 0)
+				color = RNG::generate(0, 255);
+			screen[y * width + x] = palette[color & 255];
+		}
+	}
+
+	for (int factor = 2; factor <= 4; ++factor)
+	{
+		timer.start();
+		for (int i = 0; i < frames; ++i)
+		{
+			uint32_t *src = &screen[0], *dest = &scaled[0];
+			if (factor == 2)
+				hq2x_32_rb(src, width * 4, dest, width * 2 * 4, width, height);
+			else if (factor == 3)
+				hq3x_32_rb(src, width * 4, dest, width * 3 * 4, width, height);
+			else
+				hq4x_32_rb(src, width * 4, dest, width * 4 * 4, width, height);
+		}
+		double total = 0;
+		for (size_t i = 0; i < scaled.size(); ++i)
+		{
+			total += scaled[i] & MASK_RGB;
+		}
+		Result result;
+		result.name = factor == 2 ? "hqx.hq2x" : factor == 3 ? "hqx.hq3x" : "hqx.hq4x";
+		result.seconds = timer.elapsed();
+		result.iterations = frames;
+		result.values.push_back(std::make_pair(std::string("ms_per_frame"), result.seconds * 1000 / frames));
+		result.values.push_back(std::make_pair(std::string("checksum"), total));
+		results->push_back(result);
+	}
+
+	results->back().values.push_back(std::make_pair(std::string("resident_kb_added"), residentMemory() - before));
+}
+
+/**
+ * Zooms a generated screen with every filter and factor, once on a single
+ * thread and once split in bands over a thread pool, checking that both
+ * give exactly the same picture. HQX works on 32 bit pixels, so the single
+ * thread run converts the 8 bit screen first, like the game used to, while
+ * the banded run expands the palette as it goes.
+ * @param results List to add the results to.
+ * @param frames Number of frames to zoom each way.
+ * @param threads Number of threads in the pool, 0 for one per processor core.
+ * @param seed Random seed.
+ */
+void zoom(std::vector<Result> *results, int frames, int threads, unsigned int seed)
+{
+	const int width = 320, height = 200;
+	const char *filters[] = { "nearest", "scale", "hqx" };
+	RNG::init(0, seed);
+	ThreadPool pool(threads);
+
+	for (int filter = 0; filter < 3; ++filter)
+	{
+		int bpp = filter == 2 ? 32 : 8;
+		Options::setBool("useScaleFilter", filter == 1);
+		Options::setBool("useHQXFilter", filter == 2);
+		SDL_Surface *src = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 8, 0, 0, 0, 0);
+		SDL_Color colors[256];
+		for (int i = 0; i < 256; ++i)
+		{
+			colors[i].r = RNG::generate(0, 255);
+			colors[i].g = RNG::generate(0, 255);
+			colors[i].b = RNG::generate(0, 255);
+		}
+		SDL_SetColors(src, colors, 0, 256);
+		SDL_Surface *wide = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, bpp, 0, 0, 0, 0);
+		for (int y = 0; y < height; ++y)
+		{
+			Uint8 *row = (Uint8*)src->pixels + y * src->pitch;
+			for (int x = 0; x < width; ++x)
+			{
+				row[x] = RNG::generate(0, 3) == 0 ? RNG::generate(0, 255) : ((x / 5) ^ (y / 7)) & 0xF;
+			}
+		}
+
+		for (int factor = 2; factor <= 4; ++factor)
+		{
+			SDL_Surface *single = SDL_CreateRGBSurface(SDL_SWSURFACE, width * factor, height * factor, bpp, 0, 0, 0, 0);
+			SDL_Surface *banded = SDL_CreateRGBSurface(SDL_SWSURFACE, width * factor, height * factor, bpp, 0, 0, 0, 0);
+
+			Timer timer;
+			for (int i = 0; i < frames; ++i)
+			{
+				if (bpp == 8)
+				{
+					Zoom::_zoomSurfaceY(src, single, 0, 0);
+				}
+				else
+				{
+					SDL_BlitSurface(src, 0, wide, 0);
+					Zoom::_zoomSurfaceY(wide, single, 0, 0);
+				}
+			}
+			double singleTime = timer.elapsed();
+			timer.start();
+			for (int i = 0; i < frames; ++i)
+			{
+				Zoom::_zoomSurfaceY(src, banded, 0, 0, &pool);
+			}
+			double bandedTime = timer.elapsed();
+
+			int mismatches = 0;
+			for (int y = 0; y < single->h; ++y)
+			{
+				if (memcmp((Uint8*)single->pixels + y * single->pitch, (Uint8*)banded->pixels + y * banded->pitch, single->w * bpp / 8) != 0)
+					++mismatches;
+			}
+
+			Result result;
+			std::ostringstream name;
+			name << "zoom." << filters[filter] << factor << "x";
+			result.name = name.str();
+			result.seconds = bandedTime;
+			result.iterations = frames;
+			result.values.push_back(std::make_pair(std::string("threads"), (double)pool.getThreads()));
+			result.values.push_back(std::make_pair(std::string("single_ms_per_frame"), singleTime * 1000 / frames));
+			result.values.push_back(std::make_pair(std::string("banded_ms_per_frame"), bandedTime * 1000 / frames));
+			result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+			results->push_back(result);
+
+			SDL_FreeSurface(banded);
+			SDL_FreeSurface(single);
+		}
+		SDL_FreeSurface(wide);
+		SDL_FreeSurface(src);
+	}
+	Options::setBool("useScaleFilter", false);
+	Options::setBool("useHQXFilter", false);
+}
+
+}
+
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <algorithm>
+#include "../src/Engine/RNG.h"
+#include "../src/Engine/ShadeBlit.h"
+#include "../src/Engine/Palette.h"
+#include "../src/Geoscape/Globe.h"
+#include "../src/Geoscape/Cord.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+/**
+ * Checks a shading kernel against the scalar one on random rows and
+ * then times it on sprite-sized rows, like the battlescape draws them.
+ * @param results List to add the results to.
+ * @param name Name of the kernel.
+ * @param kernel Kernel to test.
+ * @param rows Number of rows to time.
+ * @param seed Random seed.
+ */
+static void shadeKernel(std::vector<Result> *results, const std::string &name, ShadeBlit::Kernel kernel, int rows, unsigned int seed)
+{
+	const int width = 320, sprite = 32;
+	std::vector<Uint8> src(width), dest(width), expected(width);
+	RNG::init(0, seed);
+
+	int mismatches = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			src[x] = RNG::generate(0, 3) == 0 ? 0 : RNG::generate(1, 255);
+			dest[x] = expected[x] = RNG::generate(0, 255);
+		}
+		int left = RNG::generate(0, width - 1);
+		int length = RNG::generate(0, width - left);
+		int shade = RNG::generate(0, 300);
+		int color = RNG::generate(0, 2) == 0 ? RNG::generate(0, 15) << 4 : -1;
+		ShadeBlit::shadeScalar(&expected[left], &src[left], length, shade, color);
+		kernel(&dest[left], &src[left], length, shade, color);
+		if (dest != expected)
+			++mismatches;
+	}
+
+	double total = 0;
+	Timer timer;
+	for (int i = 0; i < rows; ++i)
+	{
+		int left = (i * sprite) % (width - sprite);
+		kernel(&dest[left], &src[left], sprite, i & 15, (i & 64) ? (i & 0xF0) : -1);
+		total += dest[left];
+	}
+	Result result;
+	result.name = "shade." + name;
+	result.seconds = timer.elapsed();
+	result.iterations = rows;
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	result.values.push_back(std::make_pair(std::string("checksum"), total));
+	results->push_back(result);
+}
+
+/**
+ * Gets a random point on the lit side of the globe.
+ * @return Normal of the point.
+ */
+static Cord randomNormal()
+{
+	Cord normal;
+	do
+	{
+		normal = Cord(RNG::generate(-1.0, 1.0), RNG::generate(-1.0, 1.0), RNG::generate(0.0, 1.0));
+	}
+	while (normal.z == 0 || normal.norm() > 1 || normal.norm() < 0.01);
+	normal *= 1. / normal.norm();
+	return normal;
+}
+
+/**
+ * Checks the cached globe shadow against shading every pixel directly,
+ * on random rows of ocean, land and empty pixels that cover both the
+ * SSE2 loop and the pixels left over after it, and then times applying
+ * the cache to globe-sized rows.
+ * @param results List to add the results to.
+ * @param rows Number of rows to time.
+ * @param seed Random seed.
+ */
+static void globeShadow(std::vector<Result> *results, int rows, unsigned int seed)
+{
+	const int width = 320;
+	std::vector<Uint8> dest(width), ocean(width), land(width), expected(width);
+	RNG::init(0, seed);
+
+	int mismatches = 0;
+	for (int i = 0; i < 20000; ++i)
+	{
+		Cord sun = randomNormal();
+		sun.z = RNG::generate(-1.0, 1.0);
+		sun *= 1. / sun.norm();
+		for (int x = 0; x < width; ++x)
+		{
+			int roll = RNG::generate(0, 7);
+			if (roll == 0)
+				dest[x] = 0;
+			else if (roll < 4)
+				dest[x] = RNG::generate(Palette::blockOffset(12), Palette::blockOffset(14) - 1);
+			else
+				dest[x] = RNG::generate(1, 255);
+			Cord normal = randomNormal();
+			Sint16 noise = RNG::generate(0, 3);
+			expected[x] = Globe::getShadowPixel(dest[x], normal, sun, noise);
+			Globe::cacheShadowPixel(normal, sun, noise, &ocean[x], &land[x]);
+		}
+		int left = RNG::generate(0, width - 1);
+		// every other row is shorter than a single SSE2 step
+		int length = (i % 2) ? RNG::generate(0, std::min(15, width - left)) : RNG::generate(0, width - left);
+		Globe::shadeShadowRow(&dest[left], &ocean[left], &land[left], length);
+		for (int x = left; x < left + length; ++x)
+		{
+			if (dest[x] != expected[x])
+			{
+				++mismatches;
+				break;
+			}
+		}
+	}
+
+	std::vector<Uint8> row(width);
+	double total = 0;
+	Timer timer;
+	for (int i = 0; i < rows; ++i)
+	{
+		std::copy(expected.begin(), expected.end(), row.begin());
+		Globe::shadeShadowRow(&row[0], &ocean[0], &land[0], width);
+		total += row[i % width];
+	}
+	Result result;
+	result.name = "shade.globe";
+	result.seconds = timer.elapsed();
+	result.iterations = rows;
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)mismatches));
+	result.values.push_back(std::make_pair(std::string("checksum"), total));
+	results->push_back(result);
+}
+
+/**
+ * Runs all the shading kernels available on this processor,
+ * checking they are pixel-exact with the scalar one, and
+ * checks the cached globe shadow the same way.
+ * @param results List to add the results to.
+ * @param rows Number of rows to time for each kernel.
+ * @param seed Random seed.
+ */
+void shading(std::vector<Result> *results, int rows, unsigned int seed)
+{
+	shadeKernel(results, "scalar", &ShadeBlit::shadeScalar, rows, seed);
+	if (ShadeBlit::getSSE2())
+		shadeKernel(results, "sse2", ShadeBlit::getSSE2(), rows, seed);
+	if (ShadeBlit::getAVX2())
+		shadeKernel(results, "avx2", ShadeBlit::getAVX2(), rows, seed);
+	globeShadow(results, rows / 10, seed);
+}
+
+}
+
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include <algorithm>
+#include "../src/Engine/RNG.h"
+#include "../src/Ruleset/MapData.h"
+#include "../src/Ruleset/MapDataSet.h"
+#include "../src/Savegame/SavedBattleGame.h"
+#include "../src/Savegame/Tile.h"
+#include "../src/Battlescape/Position.h"
+
+namespace OpenXcom
+{
+
+namespace Benchmark
+{
+
+namespace
+{
+
+/**
+ * Fills in a tile of the generated map: floors, some blocking
+ * objects, a bit of fire and smoke, and random light.
+ * The same rolls always give the same tile.
+ * @param tile Pointer to the tile.
+ * @param floor Floor part.
+ * @param block Object part.
+ */
+void fillTile(Tile *tile, MapData *floor, MapData *block)
+{
+	int roll = RNG::generate(0, 99);
+	if (tile->getPosition().z == 0 || roll < 20)
+	{
+		tile->setMapData(floor, 0, 0, MapData::O_FLOOR);
+	}
+	if (roll >= 90)
+	{
+		tile->setMapData(block, 1, 0, MapData::O_OBJECT);
+	}
+	if (roll == 0)
+	{
+		tile->setFire(3);
+	}
+	else if (roll == 1)
+	{
+		tile->addSmoke(5);
+	}
+	tile->addLight(RNG::generate(0, 15), 0);
+}
+
+/**
+ * Sweeps over a list of tiles, reading what the turn
+ * handling and lighting read from every tile.
+ * @param tiles List of tiles.
+ * @param count Number of tiles.
+ * @return Checksum of everything read.
+ */
+double sweepTiles(Tile *const *tiles, int count)
+{
+	double total = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		Tile *tile = tiles[i];
+		total += tile->getShade() + tile->getFire() + tile->getSmoke();
+		if (tile->getUnit() || !tile->getInventory()->empty())
+			++total;
+		if (tile->getMapData(MapData::O_OBJECT))
+			++total;
+	}
+	return total;
+}
+
+/**
+ * The fields of every tile that the full map sweeps read, split off
+ * into parallel arrays. The rest of the tile stays where it was.
+ */
+struct HotTiles
+{
+	std::vector<MapData*> objects;
+	std::vector<Uint8> light, smoke, fire;
+	std::vector<BattleUnit*> units;
+
+	/**
+	 * Copies the hot fields out of a list of tiles.
+	 * @param tiles List of tiles.
+	 * @param count Number of tiles.
+	 */
+	HotTiles(Tile *const *tiles, int count) : objects(count * 4), light(count * 3), smoke(count), fire(count), units(count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			for (int part = 0; part < 4; ++part)
+			{
+				objects[i * 4 + part] = tiles[i]->getMapData(part);
+			}
+			// only the first layer is lit on the generated map
+			light[i * 3] = 15 - tiles[i]->getShade();
+			smoke[i] = tiles[i]->getSmoke();
+			fire[i] = tiles[i]->getFire();
+			units[i] = tiles[i]->getUnit();
+		}
+	}
+
+	/**
+	 * Sweeps over the split tiles, reading the same as sweepTiles().
+	 * The items are still looked up in the tiles themselves.
+	 * @param tiles List of tiles.
+	 * @param count Number of tiles.
+	 * @return Checksum of everything read.
+	 */
+	double sweep(Tile *const *tiles, int count) const
+	{
+		double total = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			int shade = 15 - std::max(light[i * 3], std::max(light[i * 3 + 1], light[i * 3 + 2]));
+			total += shade + fire[i] + smoke[i];
+			if (units[i] || !tiles[i]->getInventory()->empty())
+				++total;
+			if (objects[i * 4 + MapData::O_OBJECT])
+				++total;
+		}
+		return total;
+	}
+};
+
+/**
+ * Fills in the result of a sweep workload.
+ * @param results List to add the result to.
+ * @param name Workload name.
+ * @param sweeps Number of sweeps.
+ * @param timer Timer started before the first sweep.
+ * @param tiles Number of tiles.
+ * @param total Checksum of the sweeps.
+ * @param expected Checksum of the contiguous tiles.
+ */
+void addSweep(std::vector<Result> *results, const std::string &name, int sweeps, const Timer &timer, int tiles, double total, double expected)
+{
+	Result result;
+	result.name = name;
+	result.seconds = timer.elapsed();
+	result.iterations = sweeps;
+	result.values.push_back(std::make_pair(std::string("tiles"), (double)tiles));
+	result.values.push_back(std::make_pair(std::string("checksum"), total));
+	result.values.push_back(std::make_pair(std::string("mismatches"), (double)(total != expected)));
+	results->push_back(result);
+}
+
+}
+
+/**
+ * Sweeps over all the tiles of a generated large map the way the turn
+ * handling and lighting do: reading the terrain, light, smoke, fire,
+ * units and items of every tile by index. The same map is swept with
+ * the tiles in the single block of SavedBattleGame (tiles.sweep),
+ * allocated one by one like they used to be, on a fresh heap
+ * (tiles.heap) and on a heap that has been in use for a while
+ * (tiles.fragmented), and with the hot fields split off into
+ * parallel arrays (tiles.split).
+ * @param results List to add the results to.
+ * @param sweeps Number of sweeps over the map.
+ * @param seed Random seed.
+ */
+void tiles(std::vector<Result> *results, int sweeps, unsigned int seed)
+{
+	const int sizeX = 100, sizeY = 100, sizeZ = 4;
+
+	MapDataSet set("BENCH");
+	MapData *floor = createPart(&set, 4);
+	MapData *block = createPart(&set, 255);
+
+	SavedBattleGame save;
+	save.initMap(sizeX, sizeY, sizeZ);
+	const int count = save.getMapSizeXYZ();
+	RNG::init(0, seed);
+	for (int i = 0; i < count; ++i)
+	{
+		fillTile(save.getTile(i), floor, block);
+	}
+
+	double expected = 0;
+	Timer timer;
+	for (int sweep = 0; sweep < sweeps; ++sweep)
+	{
+		expected += sweepTiles(save.getTiles(), count);
+	}
+	addSweep(results, "tiles.sweep", sweeps, timer, count, expected, expected);
+
+	// one allocation per tile, in index order
+	std::vector<Tile*> heap(count);
+	RNG::init(0, seed);
+	for (int i = 0; i < count; ++i)
+	{
+		heap[i] = new Tile(save.getTile(i)->getPosition());
+		fillTile(heap[i], floor, block);
+	}
+	double total = 0;
+	timer.start();
+	for (int sweep = 0; sweep < sweeps; ++sweep)
+	{
+		total += sweepTiles(&heap[0], count);
+	}
+	addSweep(results, "tiles.heap", sweeps, timer, count, total, expected);
+	for (int i = 0; i < count; ++i)
+	{
+		delete heap[i];
+	}
+
+	// the same, after a mix of allocations of all sizes has come and gone
+	std::vector<char*> churn(count * 4);
+	for (size_t i = 0; i < churn.size(); ++i)
+	{
+		churn[i] = new char[RNG::generate(16, 512)];
+	}
+	for (size_t i = 0; i < churn.size(); ++i)
+	{
+		if (RNG::generate(0, 1))
+		{
+			delete[] churn[i];
+			churn[i] = 0;
+		}
+	}
+	RNG::init(0, seed);
+	for (int i = 0; i < count; ++i)
+	{
+		heap[i] = new Tile(save.getTile(i)->getPosition());
+		fillTile(heap[i], floor, block);
+	}
+	total = 0;
+	timer.start();
+	for (int sweep = 0; sweep < sweeps; ++sweep)
+	{
+		total += sweepTiles(&heap[0], count);
+	}
+	addSweep(results, "tiles.fragmented", sweeps, timer, count, total, expected);
+	for (int i = 0; i < count; ++i)
+	{
+		delete heap[i];
+	}
+	for (size_t i = 0; i < churn.size(); ++i)
+	{
+		delete[] churn[i];
+	}
+
+	HotTiles hot(save.getTiles(), count);
+	total = 0;
+	timer.start();
+	for (int sweep = 0; sweep < sweeps; ++sweep)
+	{
+		total += hot.sweep(save.getTiles(), count);
+	}
+	addSweep(results, "tiles.split", sweeps, timer, count, total, expected);
+
+	for (std::vector<MapData*>::iterator i = set.getObjects()->begin(); i != set.getObjects()->end(); ++i)
+	{
+		delete *i;
+	}
+}
+
+}
+
+}
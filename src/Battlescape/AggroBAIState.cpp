@@ -30,6 +30,7 @@
 #include "../Battlescape/BattlescapeState.h"
 #include "../Savegame/Tile.h"
 #include "../Battlescape/Pathfinding.h"
+#include "../Battlescape/ReachabilityCache.h"
 #include "../Engine/RNG.h"
 #include "../Engine/Options.h"
 #include "../Engine/Logger.h"
@@ -649,7 +650,26 @@ void AggroBAIState::takeCoverAction(BattleAction *action)
 		if (tu < 0) tu = 0;
 	}
 
-	std::vector<int> reachable = _game->getPathfinding()->findReachable(_unit, tu);
+	const ReachableTiles &reachable = _game->getPathfinding()->getReachable(_unit, tu);
+
+	// survey the tiles of the systematic search all at once, so the work can be spread over the processor cores
+	std::vector<Position> candidates;
+	Position searchCenter = _unit->getPosition() + runOffset;
+	if (!_game->getTile(searchCenter))
+	{
+		searchCenter = _unit->getPosition();
+	}
+	for (int i = (civ ? 9 : 0); i < 121; i += (civ ? 10 : 1)) // civilians skip most of the search, see below
+	{
+		Position candidate = searchCenter;
+		candidate.x += _randomTileSearch[i].x;
+		candidate.y += _randomTileSearch[i].y;
+		if (_game->getTile(candidate) && reachable.isReachable(_game->getTileIndex(candidate)))
+		{
+			candidates.push_back(candidate);
+		}
+	}
+	_game->getTileEngine()->surveyXComThreat(candidates, _unit);
 
 	while (tries < 150 && !coverFound)
 	{
@@ -725,37 +745,38 @@ void AggroBAIState::takeCoverAction(BattleAction *action)
 		}
 		else
 		{
-			if (std::find(reachable.begin(), reachable.end(), _game->getTileIndex(tile->getPosition()))  == reachable.end()) continue; // just ignore unreachable tiles
+			if (!reachable.isReachable(_game->getTileIndex(tile->getPosition()))) continue; // just ignore unreachable tiles
 
-			_game->getTileEngine()->surveyXComThreatToTile(tile, action->target, _unit);
+			_game->getTileEngine()->surveyXComThreatToTile(action->target, _unit);
+			const ThreatSurvey &survey = _game->getTileEngine()->getThreatSurvey(action->target);
 						
-			if (tile->soldiersVisible == Tile::NOT_CALCULATED) continue; // you can't go there.
+			if (survey.soldiersVisible == ThreatSurvey::NOT_CALCULATED) continue; // you can't go there.
 						
-			if (tile->soldiersVisible && tile->closestSoldierDSqr <= SOLDIER_PROXIMITY_BASE_PENALTY && tile->closestSoldierDSqr > 0) 
+			if (survey.soldiersVisible && survey.closestSoldierDSqr <= SOLDIER_PROXIMITY_BASE_PENALTY && survey.closestSoldierDSqr > 0) 
 			{
-				score -= (SOLDIER_PROXIMITY_BASE_PENALTY/tile->closestSoldierDSqr);
+				score -= (SOLDIER_PROXIMITY_BASE_PENALTY/survey.closestSoldierDSqr);
 			}
 						
-			if (tile->soldiersVisible && tile->meanSoldierDSqr <= (SOLDIER_PROXIMITY_BASE_PENALTY/2) && tile->meanSoldierDSqr > 0) 
+			if (survey.soldiersVisible && survey.meanSoldierDSqr <= (SOLDIER_PROXIMITY_BASE_PENALTY/2) && survey.meanSoldierDSqr > 0) 
 			{
-				score -= ((SOLDIER_PROXIMITY_BASE_PENALTY/2)/tile->meanSoldierDSqr); // less important than above
+				score -= ((SOLDIER_PROXIMITY_BASE_PENALTY/2)/survey.meanSoldierDSqr); // less important than above
 			}
 
 			//score += (dist-_game->getTileEngine()->distance(_aggroTarget->getPosition(), action->target)); // get away from aggrotarget, modest priority
 						
-			if (!tile->soldiersVisible)
+			if (!survey.soldiersVisible)
 			{
 				// yay.
 			} else
 			{						
 				// score -= tile->soldiersVisible * EXPOSURE_PENALTY;
 				score -= EXPOSURE_PENALTY; // that's for giving away our position
-				score -= tile->totalExposure / (100 / EXPOSURE_PENALTY); // this is for how easy it'd be to shoot at us
+				score -= survey.totalExposure / (100 / EXPOSURE_PENALTY); // this is for how easy it'd be to shoot at us
 			}
 						
 			// strength in numbers but not in "grenade us!" huddles:
-			if (tile->closestAlienDSqr < MAX_ALLY_DISTANCE && tile->closestAlienDSqr > MIN_ALLY_DISTANCE) score += ALLY_BONUS;
-			if (tile->closestAlienDSqr <= MIN_ALLY_DISTANCE) score -= ALLY_BONUS;
+			if (survey.closestAlienDSqr < MAX_ALLY_DISTANCE && survey.closestAlienDSqr > MIN_ALLY_DISTANCE) score += ALLY_BONUS;
+			if (survey.closestAlienDSqr <= MIN_ALLY_DISTANCE) score -= ALLY_BONUS;
 										
 			if (tile->getFire()) score -= FIRE_PENALTY; // maybe stop, drop, and roll?
 						
@@ -770,18 +791,16 @@ void AggroBAIState::takeCoverAction(BattleAction *action)
 
 		if (tile && score > bestTileScore)
 		{
-			// calculate TUs to tile; we could be getting this from findReachable() somehow but that would break something for sure...
-			_game->getPathfinding()->calculate(_unit, action->target);
-			int TUBonus = (_unit->getTimeUnits() - (_game->getPathfinding()->getTotalTUCost()+4));
+			// TUs to tile, we already know them from looking for the reachable tiles
+			int TUBonus = (_unit->getTimeUnits() - (reachable.getTUCost(_game->getTileIndex(action->target))+4));
 			TUBonus = TUBonus > (EXPOSURE_PENALTY - 1) ? (EXPOSURE_PENALTY - 1) : TUBonus;
-			if (tile->soldiersVisible == 0 && action->number > 2) score += TUBonus;
-			if (score > bestTileScore && _game->getPathfinding()->getStartDirection() != -1)
+			if (_game->getTileEngine()->getThreatSurvey(action->target).soldiersVisible == 0 && action->number > 2) score += TUBonus;
+			if (score > bestTileScore && action->target != _unit->getPosition())
 			{
 				bestTileScore = score;
 				bestTile = action->target;
 				if (_traceAI) { tile->setMarkerColor(score < 0 ? 7 : (score < FAST_PASS_THRESHOLD/2 ? 10 : (score < FAST_PASS_THRESHOLD ? 4 : 5))); }
 			}
-			_game->getPathfinding()->abortPath();
 			if (bestTileScore > FAST_PASS_THRESHOLD) coverFound = true; // good enough, gogogo
 		}
 	}
@@ -789,7 +808,7 @@ void AggroBAIState::takeCoverAction(BattleAction *action)
 	_unit->lastCover = bestTile;
 	if (_traceAI)
 	{
-		Log(LOG_INFO) << _unit->getId() << " Taking cover with score " << bestTileScore << " after " << tries << " tries, with total exposure " << ((tile=_game->getTile(bestTile)) ? tile->totalExposure : -9999) << ", " << _game->getTileEngine()->distance(_unit->getPosition(), bestTile) << " squares or so away. Time: " << (SDL_GetTicks() - start) << " Action #" << action->number;
+		Log(LOG_INFO) << _unit->getId() << " Taking cover with score " << bestTileScore << " after " << tries << " tries, with total exposure " << (_game->getTile(bestTile) ? _game->getTileEngine()->getThreatSurvey(bestTile).totalExposure : -9999) << ", " << _game->getTileEngine()->distance(_unit->getPosition(), bestTile) << " squares or so away. Time: " << (SDL_GetTicks() - start) << " Action #" << action->number;
 		// Log(LOG_INFO) << "Walking " << _game->getTileEngine()->distance(_unit->getPosition(), bestTile) << " squares or so.";
 		_game->getTile(action->target)->setMarkerColor(13);
 	}
@@ -928,6 +947,7 @@ bool AggroBAIState::selectPointNearTarget(BattleAction *action, BattleUnit *targ
 	int size = action->actor->getArmor()->getSize();
 	int targetsize = target->getArmor()->getSize();
 	bool returnValue = false;
+	const ReachableTiles &reachable = _game->getPathfinding()->getReachable(action->actor, maxTUs);
 	for (int x = -size; x <= targetsize; ++x)
 	{
 		for (int y = -size; y <= targetsize; ++y)
@@ -938,15 +958,10 @@ bool AggroBAIState::selectPointNearTarget(BattleAction *action, BattleUnit *targ
 				bool valid = _game->getTileEngine()->validMeleeRange(checkPath, -1, action->actor->getArmor()->getSize(), target);
 				bool fitHere = _game->setUnitPosition(action->actor, checkPath, true);
 								
-				if (valid && fitHere)
+				if (valid && fitHere && checkPath != action->actor->getPosition() && reachable.isReachable(_game->getTileIndex(checkPath)))
 				{
-					_game->getPathfinding()->calculate(action->actor, checkPath, 0, maxTUs);
-					if (_game->getPathfinding()->getStartDirection() != -1)
-					{
-						action->target = checkPath;
-						returnValue = true;
-					}
-					_game->getPathfinding()->abortPath();
+					action->target = checkPath;
+					returnValue = true;
 				}
 			}
 		}
@@ -283,9 +283,9 @@ void BattlescapeGame::handleAI(BattleUnit *unit)
 
         if (unit->_hidingForTurn && _AIActionCounter > 2)
         {
-            if (_save->getTile(action.target) && _save->getTile(action.target)->soldiersVisible > 0)
+            if (_save->getTile(action.target) && _save->getTileEngine()->getThreatSurvey(action.target).soldiersVisible > 0)
             {
-                finalFacing = _save->getTile(action.target)->closestSoldierPos; // be ready for the nearest spotting unit for our destination
+                finalFacing = _save->getTileEngine()->getThreatSurvey(action.target).closestSoldierPos; // be ready for the nearest spotting unit for our destination
                 usePathfinding = false;
 				if (Options::getBool("traceAI")) { Log(LOG_INFO) << "setting final facing direction for closest soldier, " << finalFacing.x << "," << finalFacing.y << "," << finalFacing.z; }
             } else if (aggro != 0)
@@ -407,13 +407,13 @@ void BattlescapeGame::endTurn()
 	// check for hot grenades on the ground
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		for (std::vector<BattleItem*>::iterator it = _save->getTiles()[i]->getInventory()->begin(); it != _save->getTiles()[i]->getInventory()->end(); )
+		for (std::vector<BattleItem*>::iterator it = _save->getTile(i)->getInventory()->begin(); it != _save->getTile(i)->getInventory()->end(); )
 		{
 			if ((*it)->getRules()->getBattleType() == BT_GRENADE && (*it)->getExplodeTurn() > 0 && (*it)->getExplodeTurn() <= _save->getTurn())  // it's a grenade to explode now
 			{
-				p.x = _save->getTiles()[i]->getPosition().x*16 + 8;
-				p.y = _save->getTiles()[i]->getPosition().y*16 + 8;
-				p.z = _save->getTiles()[i]->getPosition().z*24 - _save->getTiles()[i]->getTerrainLevel();
+				p.x = _save->getTile(i)->getPosition().x*16 + 8;
+				p.y = _save->getTile(i)->getPosition().y*16 + 8;
+				p.z = _save->getTile(i)->getPosition().z*24 - _save->getTile(i)->getTerrainLevel();
 				statePushNext(new ExplosionBState(this, p, (*it), (*it)->getPreviousOwner()));
 				_save->removeItem((*it));
 				statePushBack(0);
@@ -1624,14 +1624,10 @@ void BattlescapeGame::resetSituationForAI()
 
 	if (Options::getBool("traceAI"))
 	{
-		for (int i = 0; i < w * l * h; ++i) if (tiles[i]->soldiersVisible != -1) { tiles[i]->setMarkerColor(0); } // clear old tile markers
+		for (int i = 0; i < w * l * h; ++i) if (_save->getTileEngine()->getThreatSurvey(tiles[i]->getPosition()).soldiersVisible != -1) { tiles[i]->setMarkerColor(0); } // clear old tile markers
 	}
 
-    for (int i = 0; i < w * l * h; ++i)
-    {
-		tiles[i]->soldiersVisible = Tile::NOT_CALCULATED;    // -1 for "not calculated"; actual calculations will take place as needed
-		tiles[i]->closestSoldierDSqr = Tile::NOT_CALCULATED; // for most of the tiles most of the time, this data is not needed
-    }
+	_save->getTileEngine()->resetThreatSurveys(); // for most of the tiles most of the time, this data is not needed
 
 }
 
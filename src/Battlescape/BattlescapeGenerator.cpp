@@ -244,12 +244,12 @@ void BattlescapeGenerator::nextStage()
 
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR) &&
-			(_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT ||
-			(_save->getTiles()[i]->getPosition().z == 1 &&
-			_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->isGravLift() &&
-			_save->getTiles()[i]->getMapData(MapData::O_OBJECT))))
-				_save->getTiles()[i]->setDiscovered(true, 2);
+		if (_save->getTile(i)->getMapData(MapData::O_FLOOR) &&
+			(_save->getTile(i)->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT ||
+			(_save->getTile(i)->getPosition().z == 1 &&
+			_save->getTile(i)->getMapData(MapData::O_FLOOR)->isGravLift() &&
+			_save->getTile(i)->getMapData(MapData::O_OBJECT))))
+				_save->getTile(i)->setDiscovered(true, 2);
 	}
 	for (std::vector<BattleUnit*>::iterator j = _save->getUnits()->begin(); j != _save->getUnits()->end(); ++j)
 	{
@@ -499,7 +499,7 @@ void BattlescapeGenerator::run()
 	{
 		for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 		{
-			_save->getTiles()[i]->setDiscovered(true, 2);
+			_save->getTile(i)->setDiscovered(true, 2);
 		}
 	}
 
@@ -507,12 +507,12 @@ void BattlescapeGenerator::run()
 	{
 		for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 		{
-			if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR) &&
-				(_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT ||
-				(_save->getTiles()[i]->getPosition().z == 1 &&
-				_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->isGravLift() &&
-				_save->getTiles()[i]->getMapData(MapData::O_OBJECT))))
-				_save->getTiles()[i]->setDiscovered(true, 2);
+			if (_save->getTile(i)->getMapData(MapData::O_FLOOR) &&
+				(_save->getTile(i)->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT ||
+				(_save->getTile(i)->getPosition().z == 1 &&
+				_save->getTile(i)->getMapData(MapData::O_FLOOR)->isGravLift() &&
+				_save->getTile(i)->getMapData(MapData::O_OBJECT))))
+				_save->getTile(i)->setDiscovered(true, 2);
 		}
 	}
 
@@ -586,19 +586,19 @@ BattleUnit *BattlescapeGenerator::addXCOMUnit(BattleUnit *unit)
 		for (int i = 0; i < _mapsize_x * _mapsize_y * _mapsize_z; i++)
 		{
 			// to spawn an xcom soldier, there has to be a tile, with a floor, with the starting point attribute and no object in the way
-			if (_save->getTiles()[i] && 
-				_save->getTiles()[i]->getMapData(MapData::O_FLOOR) && 
-				_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT && 
-				!_save->getTiles()[i]->getMapData(MapData::O_OBJECT) &&
-				_save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getTUCost(MT_WALK) < 255)
+			if (_save->getTile(i) && 
+				_save->getTile(i)->getMapData(MapData::O_FLOOR) && 
+				_save->getTile(i)->getMapData(MapData::O_FLOOR)->getSpecialType() == START_POINT && 
+				!_save->getTile(i)->getMapData(MapData::O_OBJECT) &&
+				_save->getTile(i)->getMapData(MapData::O_FLOOR)->getTUCost(MT_WALK) < 255)
 			{
 				if (_craftInventoryTile == 0)
-					_craftInventoryTile = _save->getTiles()[i];
+					_craftInventoryTile = _save->getTile(i);
 
 				// for bigger units, line them up with the first tile of the craft
-				if (unit->getArmor()->getSize() == 1 || _craftInventoryTile == 0 || _save->getTiles()[i]->getPosition().x == _craftInventoryTile->getPosition().x)
+				if (unit->getArmor()->getSize() == 1 || _craftInventoryTile == 0 || _save->getTile(i)->getPosition().x == _craftInventoryTile->getPosition().x)
 				{
-					if (_save->setUnitPosition(unit, _save->getTiles()[i]->getPosition()))
+					if (_save->setUnitPosition(unit, _save->getTile(i)->getPosition()))
 					{
 						_save->getUnits()->push_back(unit);
 						_save->getTileEngine()->calculateFOV(unit);
@@ -1710,12 +1710,12 @@ void BattlescapeGenerator::fuelPowerSources()
 {
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) 
-			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE)
+		if (_save->getTile(i)->getMapData(MapData::O_OBJECT) 
+			&& _save->getTile(i)->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE)
 		{
 			BattleItem *elerium = new BattleItem(_game->getRuleset()->getItem("STR_ELERIUM_115"), _save->getCurrentItemId());
 			_save->getItems()->push_back(elerium);
-			_save->getTiles()[i]->addItem(elerium, _game->getRuleset()->getInventory("STR_GROUND"));
+			_save->getTile(i)->addItem(elerium, _game->getRuleset()->getInventory("STR_GROUND"));
 		}
 	}
 }
@@ -1728,13 +1728,13 @@ void BattlescapeGenerator::explodePowerSources()
 {
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT) 
-			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(0,100) < 75)
+		if (_save->getTile(i)->getMapData(MapData::O_OBJECT) 
+			&& _save->getTile(i)->getMapData(MapData::O_OBJECT)->getSpecialType() == UFO_POWER_SOURCE && RNG::generate(0,100) < 75)
 		{
 			Position pos;
-			pos.x = _save->getTiles()[i]->getPosition().x*16;
-			pos.y = _save->getTiles()[i]->getPosition().y*16;
-			pos.z = (_save->getTiles()[i]->getPosition().z*24) +12;
+			pos.x = _save->getTile(i)->getPosition().x*16;
+			pos.y = _save->getTile(i)->getPosition().y*16;
+			pos.z = (_save->getTile(i)->getPosition().z*24) +12;
 			_save->getTileEngine()->explode(pos, 180+RNG::generate(0,70), DT_HE, 11);
 		}
 	}
@@ -1271,6 +1271,7 @@ void BattlescapeState::SaveAIMap()
 	r.h = 8;
 	r.w = 8;
 
+	std::vector<Position> surveyed;
 	for (int y = 0; y < h; ++y)
 	{
 		tilePos.y = y;
@@ -1282,9 +1283,15 @@ void BattlescapeState::SaveAIMap()
 			if (!t) continue;
 			if (!t->isDiscovered(2)) continue;
 			
-			if (_save->getTileEngine()->surveyXComThreatToTile(t, tilePos, unit) && t->totalExposure > expMax) expMax = t->totalExposure;
+			surveyed.push_back(tilePos);
 		}
 	}
+	_save->getTileEngine()->surveyXComThreat(surveyed, unit);
+	for (std::vector<Position>::iterator i = surveyed.begin(); i != surveyed.end(); ++i)
+	{
+		const ThreatSurvey &survey = _save->getTileEngine()->getThreatSurvey(*i);
+		if (survey.soldiersVisible != ThreatSurvey::NOT_CALCULATED && survey.totalExposure > expMax) expMax = survey.totalExposure;
+	}
 	
 	if (expMax < 100) expMax = 100;
 
@@ -1302,11 +1309,12 @@ void BattlescapeState::SaveAIMap()
 			r.x = x * r.w;
 			r.y = y * r.h;
 
-			if (t->getTUCost(MapData::O_FLOOR, MT_FLY) != 255 && t->getTUCost(MapData::O_OBJECT, MT_FLY) != 255 && _save->getTileEngine()->surveyXComThreatToTile(t, tilePos, unit) && t->soldiersVisible != Tile::NOT_CALCULATED)
+			const ThreatSurvey &survey = _save->getTileEngine()->getThreatSurvey(tilePos);
+			if (t->getTUCost(MapData::O_FLOOR, MT_FLY) != 255 && t->getTUCost(MapData::O_OBJECT, MT_FLY) != 255 && survey.soldiersVisible != ThreatSurvey::NOT_CALCULATED)
 			{
-				int e = (t->totalExposure * 255) / expMax;
+				int e = (survey.totalExposure * 255) / expMax;
 				SDL_FillRect(img, &r, SDL_MapRGB(img->format, e, 255-e, 0x20));
-				characterRGBA(img, r.x, r.y, t->soldiersVisible > 9 ? '*' : ('0'+t->soldiersVisible), 0x7f, 0x7f, 0x7f, 0x7f);
+				characterRGBA(img, r.x, r.y, survey.soldiersVisible > 9 ? '*' : ('0'+survey.soldiersVisible), 0x7f, 0x7f, 0x7f, 0x7f);
 			} else
 			{
 				if (!t->getUnit()) SDL_FillRect(img, &r, SDL_MapRGB(img->format, 0x50, 0x50, 0x50)); // gray for blocked tile
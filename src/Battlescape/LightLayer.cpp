@@ -0,0 +1,241 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "LightLayer.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/Tile.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up a light layer without any sources.
+ * @param save Pointer to the battle game.
+ * @param layer Light layer of the tiles this layer lights up.
+ */
+LightLayer::LightLayer(SavedBattleGame *save, int layer) : _save(save), _layer(layer), _levels(0), _valid(false)
+{
+}
+
+/**
+ * Deletes the light layer.
+ */
+LightLayer::~LightLayer()
+{
+}
+
+/**
+ * Gets the light pattern of a source: a circle of light that loses
+ * one level of power for every tile travelled.
+ * @param power Power of the source.
+ * @return The tiles that get any light and how much.
+ */
+const std::vector<LightStencil> &LightLayer::getStencil(int power)
+{
+	if ((int)_stencils.size() <= power)
+	{
+		_stencils.resize(power + 1);
+	}
+	std::vector<LightStencil> &stencil = _stencils[power];
+	if (stencil.empty())
+	{
+		for (int x = -power; x <= power; ++x)
+		{
+			for (int y = -power; y <= power; ++y)
+			{
+				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
+				if (power - distance > 0)
+				{
+					LightStencil cell = {x, y, power - distance};
+					stencil.push_back(cell);
+				}
+			}
+		}
+	}
+	return stencil;
+}
+
+/**
+ * Adds the light of a source to the columns around it, or takes it away again.
+ * @param source The light source.
+ * @param delta 1 to add the source, -1 to remove it.
+ */
+void LightLayer::spread(const LightSource &source, int delta)
+{
+	const std::vector<LightStencil> &stencil = getStencil(source.power);
+	const int sizeX = _save->getMapSizeX();
+	const int sizeY = _save->getMapSizeY();
+	for (std::vector<LightStencil>::const_iterator i = stencil.begin(); i != stencil.end(); ++i)
+	{
+		int x = source.x + i->x;
+		int y = source.y + i->y;
+		if (x < 0 || y < 0 || x >= sizeX || y >= sizeY)
+			continue;
+		int column = y * sizeX + x;
+		int &count = _counts[column * _levels + i->light];
+		count += delta;
+		if (delta > 0)
+		{
+			if (i->light > _light[column])
+			{
+				_light[column] = i->light;
+				mark(column);
+			}
+		}
+		else if (count == 0 && i->light == _light[column])
+		{
+			// the brightest source went away, fall back to the next one
+			int light = i->light - 1;
+			while (light > 0 && _counts[column * _levels + light] == 0)
+			{
+				--light;
+			}
+			_light[column] = light;
+			mark(column);
+		}
+	}
+}
+
+/**
+ * Marks a column of tiles to have its light updated.
+ * @param column Index of the column.
+ */
+void LightLayer::mark(int column)
+{
+	if (!_marked[column])
+	{
+		_marked[column] = true;
+		_changed.push_back(column);
+	}
+}
+
+/**
+ * Spreads the light of all sources from scratch.
+ * @param levels Number of light levels to count sources for.
+ */
+void LightLayer::rebuild(int levels)
+{
+	const int columns = _save->getMapSizeX() * _save->getMapSizeY();
+	std::vector<int> previous;
+	previous.swap(_light);
+
+	_levels = levels;
+	_counts.assign(columns * _levels, 0);
+	_light.assign(columns, 0);
+	_marked.assign(columns, false);
+	_changed.clear();
+	for (std::vector<LightSource>::const_iterator i = _sources.begin(); i != _sources.end(); ++i)
+	{
+		spread(*i, 1);
+	}
+
+	// the tiles might have any light left when starting over
+	_marked.assign(columns, false);
+	_changed.clear();
+	for (int column = 0; column < columns; ++column)
+	{
+		if (!_valid || previous[column] != _light[column])
+		{
+			mark(column);
+		}
+	}
+	_valid = true;
+	flush();
+}
+
+/**
+ * Copies the light of the marked columns to all the tiles in them.
+ */
+void LightLayer::flush()
+{
+	const int columns = _save->getMapSizeX() * _save->getMapSizeY();
+	for (std::vector<int>::const_iterator i = _changed.begin(); i != _changed.end(); ++i)
+	{
+		for (int z = 0; z < _save->getMapSizeZ(); ++z)
+		{
+			Tile *tile = _save->getTile(z * columns + *i);
+			tile->resetLight(_layer);
+			tile->addLight(_light[*i], _layer);
+		}
+		_marked[*i] = false;
+	}
+	_changed.clear();
+}
+
+/**
+ * Replaces the light sources of the layer. Only the sources that were
+ * added or removed since the last update have their light spread again.
+ * @param sources The new light sources. Gets sorted.
+ */
+void LightLayer::update(std::vector<LightSource> *sources)
+{
+	int maxPower = 0;
+	for (std::vector<LightSource>::iterator i = sources->begin(); i != sources->end();)
+	{
+		if (i->power <= 0)
+		{
+			// doesn't light up anything
+			i = sources->erase(i);
+			continue;
+		}
+		maxPower = std::max(maxPower, i->power);
+		++i;
+	}
+	std::sort(sources->begin(), sources->end());
+
+	if (!_valid || maxPower >= _levels)
+	{
+		_sources.swap(*sources);
+		rebuild(std::max(maxPower + 1, _levels));
+		return;
+	}
+
+	std::vector<LightSource> removed, added;
+	std::set_difference(_sources.begin(), _sources.end(), sources->begin(), sources->end(), std::back_inserter(removed));
+	std::set_difference(sources->begin(), sources->end(), _sources.begin(), _sources.end(), std::back_inserter(added));
+	for (std::vector<LightSource>::const_iterator i = removed.begin(); i != removed.end(); ++i)
+	{
+		spread(*i, -1);
+	}
+	for (std::vector<LightSource>::const_iterator i = added.begin(); i != added.end(); ++i)
+	{
+		spread(*i, 1);
+	}
+	_sources.swap(*sources);
+	flush();
+}
+
+/**
+ * Forgets all sources, eg. when a new map is loaded.
+ * The light is spread from scratch on the next update.
+ */
+void LightLayer::clear()
+{
+	_valid = false;
+	_sources.clear();
+	_counts.clear();
+	_light.clear();
+	_changed.clear();
+	_marked.clear();
+	_levels = 0;
+}
+
+}
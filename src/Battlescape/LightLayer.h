@@ -0,0 +1,90 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_LIGHTLAYER_H
+#define OPENXCOM_LIGHTLAYER_H
+
+#include <vector>
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+
+/**
+ * A light source as far as the light it spreads is concerned.
+ * Light spreads the same over all levels, so only the column matters.
+ */
+struct LightSource
+{
+	int x, y, power;
+	LightSource(int x_, int y_, int power_) : x(x_), y(y_), power(power_) {}
+	bool operator<(const LightSource &other) const
+	{
+		if (x != other.x) return x < other.x;
+		if (y != other.y) return y < other.y;
+		return power < other.power;
+	}
+	bool operator==(const LightSource &other) const
+	{
+		return x == other.x && y == other.y && power == other.power;
+	}
+};
+
+/**
+ * A tile in the light pattern of a source, relative to the source.
+ */
+struct LightStencil
+{
+	int x, y, light;
+};
+
+/**
+ * Keeps track of the light all sources of one light layer spread over the map.
+ * For every column it counts how many sources light it up at every light level,
+ * so adding or removing a source only touches the tiles within its range.
+ */
+class LightLayer
+{
+private:
+	SavedBattleGame *_save;
+	int _layer, _levels;
+	bool _valid;
+	std::vector<LightSource> _sources;
+	std::vector<int> _counts, _light, _changed;
+	std::vector<bool> _marked;
+	std::vector<std::vector<LightStencil> > _stencils;
+	const std::vector<LightStencil> &getStencil(int power);
+	void spread(const LightSource &source, int delta);
+	void mark(int column);
+	void rebuild(int levels);
+	void flush();
+public:
+	/// Creates a new light layer.
+	LightLayer(SavedBattleGame *save, int layer);
+	/// Cleans up the light layer.
+	~LightLayer();
+	/// Updates the light of the tiles to the new sources.
+	void update(std::vector<LightSource> *sources);
+	/// Forgets all sources.
+	void clear();
+};
+
+}
+
+#endif
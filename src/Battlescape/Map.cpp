@@ -17,6 +17,7 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include "Map.h"
@@ -43,9 +44,12 @@
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/Armor.h"
 #include "BattlescapeMessage.h"
+#include "MapDamage.h"
+#include "TerrainCache.h"
 #include "../Savegame/SavedGame.h"
 #include "../Interface/Cursor.h"
 #include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
 #include "../Interface/NumberText.h"
 
 
@@ -74,7 +78,7 @@ namespace OpenXcom
  * @param y Y position in pixels.
  * @param visibleMapHeight Current visible map height.
  */
-Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _arrow(0), _selectorX(0), _selectorY(0), _mouseX(0), _mouseY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _launch(false), _visibleMapHeight(visibleMapHeight), _unitDying(false)
+Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _arrow(0), _selectorX(0), _selectorY(0), _mouseX(0), _mouseY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _launch(false), _visibleMapHeight(visibleMapHeight), _drawnAllLayers(false), _drawnEffects(false), _recordCells(false), _drawCells(true), _unitDying(false)
 {
 	_res = _game->getResourcePack();
 	_spriteWidth = _res->getSurfaceSet("BLANKS.PCK")->getFrame(0)->getWidth();
@@ -87,6 +91,9 @@ Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight)
 	_scrollKeyTimer = new Timer(SCROLL_INTERVAL);
 	_scrollKeyTimer->onTimer((SurfaceHandler)&Map::scrollKey);
 	_camera->setScrollTimer(_scrollMouseTimer, _scrollKeyTimer);
+	_damage = new MapDamage(width, height, _save->getMapSizeXYZ() + 1);
+	_dirtyRedraw = Options::getBool("battleDirtyRedraw");
+	_terrainCache = Options::getBool("battleTerrainCache") ? new TerrainCache(_save, _spriteWidth, _spriteHeight) : 0;
 }
 
 /**
@@ -99,6 +106,8 @@ Map::~Map()
 	delete _arrow;
 	delete _message;
 	delete _camera;
+	delete _damage;
+	delete _terrainCache;
 
 	for (int i = 0; i < BULLET_SPRITES; ++i)
 	{
@@ -151,11 +160,11 @@ void Map::think()
 }
 
 /**
- * Draws the whole map, part by part.
+ * Draws the map, only the parts that changed since it was last drawn if possible.
  */
 void Map::draw()
 {
-	Surface::draw();
+	_redraw = false;
 	Tile *t;
 	
 	projectileInFOV = _save->getDebugMode();
@@ -184,7 +193,9 @@ void Map::draw()
 	}
 	else
 	{
+		Surface::draw();
 		_message->blit(this);
+		_damage->invalidate();
 	}
 }
 
@@ -197,6 +208,7 @@ void Map::draw()
 void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
 	Surface::setPalette(colors, firstcolor, ncolors);
+	_damage->invalidate();
 	for (std::vector<MapDataSet*>::const_iterator i = _save->getMapDataSets()->begin(); i != _save->getMapDataSets()->end(); ++i)
 	{
 		(*i)->getSurfaceset()->setPalette(colors, firstcolor, ncolors);
@@ -214,18 +226,14 @@ void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 */
 void Map::drawTerrain(Surface *surface)
 {
-	int frameNumber = 0;
+	ProfileZone zone("Map::drawTerrain");
 	Surface *tmpSurface;
-	Tile *tile;
 	int beginX = 0, endX = _save->getMapSizeX() - 1;
 	int beginY = 0, endY = _save->getMapSizeY() - 1;
 	int beginZ = 0, endZ = _camera->getShowAllLayers()?_save->getMapSizeZ() - 1:_camera->getViewLevel();
-	Position mapPosition, screenPosition, bulletPositionScreen;
+	Position bulletPositionScreen;
 	int bulletLowX=16000, bulletLowY=16000, bulletLowZ=16000, bulletHighX=0, bulletHighY=0, bulletHighZ=0;
 	int dummy;
-	BattleUnit *unit = 0;
-	bool invalid;
-	int tileShade, wallShade, tileColor;
 
 	NumberText *_numWaypid = 0;
 	
@@ -336,389 +344,731 @@ void Map::drawTerrain(Surface *surface)
 		_numWaypid->setColor(Palette::blockOffset(1));
 	}
 
+	Position bulletLow(bulletLowX, bulletLowY, bulletLowZ), bulletHigh(bulletHighX, bulletHighY, bulletHighZ);
+	bool effects = _projectile != 0 || !_explosions.empty();
+	if (!_dirtyRedraw || effects || _drawnEffects || _camera->getMapOffset() != _drawnOffset || _camera->getShowAllLayers() != _drawnAllLayers)
+	{
+		_damage->invalidate();
+	}
+	_drawnEffects = effects;
+	_drawnOffset = _camera->getMapOffset();
+	_drawnAllLayers = _camera->getShowAllLayers();
+	bool full = _damage->isFull();
+	if (full)
+	{
+		surface->clear();
+	}
+
+	// the first pass finds out what every cell draws, and already draws it if the whole view is redrawn,
+	// the second pass only redraws the cells that overlap the damaged parts of the view
+	const std::vector<SDL_Rect> *regions = 0;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 0)
+		{
+			_recordCells = _dirtyRedraw;
+			_drawCells = full;
+		}
+		else
+		{
+			if (full)
+				break;
+			regions = &_damage->getRegions();
+			if (regions->empty())
+				break;
+			for (std::vector<SDL_Rect>::const_iterator i = regions->begin(); i != regions->end(); ++i)
+			{
+				SDL_Rect region = *i;
+				SDL_FillRect(surface->getSurface(), &region, 0);
+			}
+			_recordCells = false;
+			_drawCells = true;
+		}
+
+		surface->lock();
+		for (int itZ = beginZ; itZ <= endZ; itZ++)
+		{
+			if (pass == 0 && full && _terrainCache && !_projectile)
+			{
+				drawCachedLevel(surface, itZ, beginX, endX, beginY, endY, bulletLow, bulletHigh, _numWaypid);
+				continue;
+			}
+			for (int itX = beginX; itX <= endX; itX++)
+			{
+				for (int itY = beginY; itY <= endY; itY++)
+				{
+					drawViewCell(surface, Position(itX, itY, itZ), regions, bulletLow, bulletHigh, _numWaypid);
+				}
+			}
+		}
+
+		// the arrow above the selected unit is tracked like one more cell
+		int index = _save->getMapSizeXYZ();
+		if (_recordCells)
+		{
+			_damage->beginCell(index);
+			drawArrow(surface);
+			_damage->endCell();
+		}
+		else if (regions)
+		{
+			for (std::vector<SDL_Rect>::const_iterator i = regions->begin(); i != regions->end(); ++i)
+			{
+				if (_damage->overlaps(index, *i))
+				{
+					SDL_SetClipRect(surface->getSurface(), &(*i));
+					drawArrow(surface);
+				}
+			}
+			SDL_SetClipRect(surface->getSurface(), 0);
+		}
+		else
+		{
+			drawArrow(surface);
+		}
+		surface->unlock();
+	}
+	_damage->repaired();
+	if (_terrainCache)
+	{
+		_terrainCache->nextFrame();
+	}
+	delete _numWaypid;
+
 	surface->lock();
 
-	for (int itZ = beginZ; itZ <= endZ; itZ++)
+	// check if we got big explosions
+	if (explosionInFOV)
+	{
+		for (std::set<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
+		{
+			if ((*i)->isBig())
+			{
+				Position voxelPos = (*i)->getPosition();
+				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+				tmpSurface = _res->getSurfaceSet("X1.PCK")->getFrame((*i)->getCurrentFrame());
+				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 64, bulletPositionScreen.y - 64, 0);
+			}
+			else if ((*i)->isHit())
+			{
+				Position voxelPos = (*i)->getPosition();
+				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+				tmpSurface = _res->getSurfaceSet("HIT.PCK")->getFrame((*i)->getCurrentFrame());
+				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
+			}
+			else
+			{
+				Position voxelPos = (*i)->getPosition();
+				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+				tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame((*i)->getCurrentFrame());
+				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
+			}
+		}
+	}
+	surface->unlock();
+}
+
+/**
+ * Draws a cell of the view, or records what it draws, if it is on the surface.
+ * When only the damaged regions of the view are redrawn, it is drawn once for
+ * every region it overlaps, clipped to that region.
+ * @param surface The surface to draw on.
+ * @param mapPosition Position of the cell on the map.
+ * @param regions The damaged regions of the view, if only those are redrawn.
+ * @param bulletLow Lowest tile position a projectile's particles are at.
+ * @param bulletHigh Highest tile position a projectile's particles are at.
+ * @param numWaypid Number to draw waypoint numbers with.
+ */
+void Map::drawViewCell(Surface *surface, const Position &mapPosition, const std::vector<SDL_Rect> *regions, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid)
+{
+	Position screenPosition;
+	_camera->convertMapToScreen(mapPosition, &screenPosition);
+	screenPosition += _camera->getMapOffset();
+
+	// only render cells that are inside the surface
+	if (screenPosition.x <= -_spriteWidth || screenPosition.x >= surface->getWidth() + _spriteWidth ||
+		screenPosition.y <= -_spriteHeight || screenPosition.y >= surface->getHeight() + _spriteHeight)
+		return;
+
+	Tile *tile = _save->getTile(mapPosition);
+	if (!tile)
+		return;
+
+	int index = _save->getTileIndex(mapPosition);
+	if (_recordCells)
 	{
-		for (int itX = beginX; itX <= endX; itX++)
+		_damage->beginCell(index);
+		drawCell(surface, tile, screenPosition, bulletLow, bulletHigh, numWaypid);
+		_damage->endCell();
+	}
+	else if (regions)
+	{
+		for (std::vector<SDL_Rect>::const_iterator i = regions->begin(); i != regions->end(); ++i)
 		{
-			for (int itY = beginY; itY <= endY; itY++)
+			if (_damage->overlaps(index, *i))
 			{
-				mapPosition = Position(itX, itY, itZ);
-				_camera->convertMapToScreen(mapPosition, &screenPosition);
-				screenPosition += _camera->getMapOffset();
+				SDL_SetClipRect(surface->getSurface(), &(*i));
+				drawCell(surface, tile, screenPosition, bulletLow, bulletHigh, numWaypid);
+			}
+		}
+	}
+	else
+	{
+		drawCell(surface, tile, screenPosition, bulletLow, bulletHigh, numWaypid);
+	}
+}
 
-				// only render cells that are inside the surface
-				if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
-					screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
+/**
+ * Draws a level of the map with the help of the terrain cache. It goes through
+ * the chunks in the order their tiles are drawn in: chunks with only terrain on
+ * them are copied from their images, the others are drawn tile by tile.
+ * Units sticking out of their tiles must overlap the neighbouring terrain
+ * the same way as without the cache, so the chunks next to those along y are
+ * drawn tile by tile as well.
+ * @param surface The surface to draw on.
+ * @param z Level to draw.
+ * @param beginX First column of tiles to draw.
+ * @param endX Last column of tiles to draw.
+ * @param beginY First row of tiles to draw.
+ * @param endY Last row of tiles to draw.
+ * @param bulletLow Lowest tile position a projectile's particles are at.
+ * @param bulletHigh Highest tile position a projectile's particles are at.
+ * @param numWaypid Number to draw waypoint numbers with.
+ */
+void Map::drawCachedLevel(Surface *surface, int z, int beginX, int endX, int beginY, int endY, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid)
+{
+	int size = TerrainCache::getChunkSize();
+	endX = std::min(endX, _save->getMapSizeX() - 1);
+	endY = std::min(endY, _save->getMapSizeY() - 1);
+	if (beginX > endX || beginY > endY)
+		return;
+	int beginChunkX = beginX / size, endChunkX = endX / size;
+	int beginChunkY = beginY / size, endChunkY = endY / size;
+	int chunks = endChunkY - beginChunkY + 1;
+	std::vector<bool> busy(chunks), tileByTile(chunks);
+
+	for (int chunkX = beginChunkX; chunkX <= endChunkX; ++chunkX)
+	{
+		int firstX = std::max(chunkX * size, beginX), lastX = std::min(chunkX * size + size - 1, endX);
+		for (int i = 0; i < chunks; ++i)
+		{
+			busy[i] = false;
+			int chunkEndX = std::min((chunkX + 1) * size, _save->getMapSizeX());
+			int chunkEndY = std::min((beginChunkY + i + 1) * size, _save->getMapSizeY());
+			for (int x = chunkX * size; x < chunkEndX && !busy[i]; ++x)
+			{
+				for (int y = (beginChunkY + i) * size; y < chunkEndY && !busy[i]; ++y)
 				{
-					tile = _save->getTile(mapPosition);
+					busy[i] = !isTerrainOnly(_save->getTile(Position(x, y, z)));
+				}
+			}
+		}
+		for (int i = 0; i < chunks; ++i)
+		{
+			tileByTile[i] = busy[i] || (i > 0 && busy[i - 1]) || (i + 1 < chunks && busy[i + 1]);
+		}
 
-					if (!tile) continue;
+		for (int i = 0; i < chunks;)
+		{
+			int last = i;
+			if (tileByTile[i])
+			{
+				// draw the whole run of chunks in the usual order
+				while (last + 1 < chunks && tileByTile[last + 1])
+				{
+					last++;
+				}
+			}
+			else
+			{
+				drawChunk(surface, chunkX, beginChunkY + i, z, bulletLow, bulletHigh, numWaypid);
+			}
 
-					if (tile->isDiscovered(2))
-					{
-						tileShade = tile->getShade();
-					}
-					else
+			// the cells still need to be recorded if they were drawn from the cache
+			bool draw = _drawCells;
+			_drawCells = tileByTile[i];
+			if (_drawCells || _recordCells)
+			{
+				int firstY = std::max((beginChunkY + i) * size, beginY), lastY = std::min((beginChunkY + last) * size + size - 1, endY);
+				for (int x = firstX; x <= lastX; ++x)
+				{
+					for (int y = firstY; y <= lastY; ++y)
 					{
-						tileShade = 16;
-						unit = 0;
+						drawViewCell(surface, Position(x, y, z), 0, bulletLow, bulletHigh, numWaypid);
 					}
+				}
+			}
+			_drawCells = draw;
+			i = last + 1;
+		}
+	}
+}
 
-					tileColor = tile->getMarkerColor();
+/**
+ * Copies the image of a chunk of terrain from the terrain cache to the surface,
+ * drawing the image first if the terrain changed.
+ * @param surface The surface to draw on.
+ * @param chunkX X position of the chunk, in chunks.
+ * @param chunkY Y position of the chunk, in chunks.
+ * @param z Level of the chunk.
+ * @param bulletLow Lowest tile position a projectile's particles are at.
+ * @param bulletHigh Highest tile position a projectile's particles are at.
+ * @param numWaypid Number to draw waypoint numbers with.
+ */
+void Map::drawChunk(Surface *surface, int chunkX, int chunkY, int z, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid)
+{
+	int size = TerrainCache::getChunkSize();
+	Position origin, screenPosition;
+	_camera->convertMapToScreen(Position(chunkX * size, chunkY * size, z), &origin);
+	screenPosition = origin + _camera->getMapOffset();
+	int left = screenPosition.x - _terrainCache->getOffsetX();
+	int top = screenPosition.y - _terrainCache->getOffsetY();
+	if (left >= surface->getWidth() || top >= surface->getHeight() || left + _terrainCache->getWidth() <= 0 || top + _terrainCache->getHeight() <= 0)
+		return;
+
+	bool valid;
+	Surface *chunk = _terrainCache->getChunk(_terrainCache->getChunkIndex(chunkX, chunkY, z), _terrainCache->getKey(chunkX, chunkY, z), &valid);
+	if (!valid)
+	{
+		bool record = _recordCells, draw = _drawCells;
+		_recordCells = false;
+		_drawCells = true;
+		int endX = std::min((chunkX + 1) * size, _save->getMapSizeX());
+		int endY = std::min((chunkY + 1) * size, _save->getMapSizeY());
+		chunk->lock();
+		for (int x = chunkX * size; x < endX; ++x)
+		{
+			for (int y = chunkY * size; y < endY; ++y)
+			{
+				Tile *tile = _save->getTile(Position(x, y, z));
+				_camera->convertMapToScreen(tile->getPosition(), &screenPosition);
+				screenPosition += Position(_terrainCache->getOffsetX() - origin.x, _terrainCache->getOffsetY() - origin.y, 0);
+				drawCell(chunk, tile, screenPosition, bulletLow, bulletHigh, numWaypid);
+			}
+		}
+		chunk->unlock();
+		_recordCells = record;
+		_drawCells = draw;
+	}
+	chunk->blitNShade(surface, left, top, 0);
+}
 
-					// Draw floor
-					tmpSurface = tile->getSprite(MapData::O_FLOOR);
-					if (tmpSurface)
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_FLOOR)->getYOffset(), tileShade, false, tileColor);
-					unit = tile->getUnit();
+/**
+ * Checks if only the terrain of a tile is drawn, nothing that moves or
+ * blinks, so the tile can be drawn from the terrain cache.
+ * @param tile Pointer to the tile.
+ * @return True if the tile only shows terrain.
+ */
+bool Map::isTerrainOnly(Tile *tile) const
+{
+	const Position &pos = tile->getPosition();
+	if (tile->getUnit() || tile->getFire() || tile->getSmoke() || tile->isAnimated())
+		return false;
+	// units on stairs are also drawn on the tile above them
+	if (pos.z > 0 && _save->getTile(pos - Position(0, 0, 1))->getUnit())
+		return false;
+	if (_cursorType != CT_NONE && _selectorX > pos.x - _cursorSize && _selectorY > pos.y - _cursorSize && _selectorX < pos.x+1 && _selectorY < pos.y+1)
+		return false;
+	for (std::vector<Position>::const_iterator i = _waypoints.begin(); i != _waypoints.end(); ++i)
+	{
+		if (*i == pos)
+			return false;
+	}
+	// parts have to fit in the chunk image
+	for (int part = 0; part < 4; ++part)
+	{
+		MapData *data = tile->getMapData(part);
+		if (data && (data->getYOffset() < 0 || data->getYOffset() > _spriteHeight))
+			return false;
+	}
+	return true;
+}
 
-					// Draw cursor back
-					if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1 && _game->getCursor()->getY() < 144)
-					{
-						if (_camera->getViewLevel() == itZ)
-						{
-							if (_cursorType != CT_AIM)
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = (_animFrame % 2); // yellow box
-								else
-									frameNumber = 0; // red box
-							}else
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
-								else
-									frameNumber = 6; // red static crosshairs
-							}
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						}
-						else if (_camera->getViewLevel() > itZ)
-						{
-							frameNumber = 2; // blue box
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						}
-					}
+/**
+ * Draws everything on a single map cell: terrain, items, units, cursor and effects.
+ * @param surface The surface to draw on.
+ * @param tile Pointer to the tile of the cell.
+ * @param screenPosition Position of the cell on the surface.
+ * @param bulletLow Lowest tile position a projectile's particles are at.
+ * @param bulletHigh Highest tile position a projectile's particles are at.
+ * @param numWaypid Number to draw waypoint numbers with.
+ */
+void Map::drawCell(Surface *surface, Tile *tile, const Position &screenPosition, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid)
+{
+	const Position &mapPosition = tile->getPosition();
+	int frameNumber = 0;
+	Surface *tmpSurface;
+	Position bulletPositionScreen;
+	BattleUnit *unit = 0;
+	bool invalid;
+	int tileShade, wallShade, tileColor;
 
-					// Draw walls
-					if (!tile->isVoid())
-					{
-						// Draw west wall
-						tmpSurface = tile->getSprite(MapData::O_WESTWALL);
-						if (tmpSurface)
-						{
-							if ((tile->getMapData(MapData::O_WESTWALL)->isDoor() || tile->getMapData(MapData::O_WESTWALL)->isUFODoor())
-								 && tile->isDiscovered(0))
-								wallShade = tile->getShade();
-							else
-								wallShade = tileShade;
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_WESTWALL)->getYOffset(), wallShade, false);
-						}
-						// Draw north wall
-						tmpSurface = tile->getSprite(MapData::O_NORTHWALL);
-						if (tmpSurface)
-						{
-							if ((tile->getMapData(MapData::O_NORTHWALL)->isDoor() || tile->getMapData(MapData::O_NORTHWALL)->isUFODoor())
-								 && tile->isDiscovered(1))
-								wallShade = tile->getShade();
-							else
-								wallShade = tileShade;
-							if (tile->getMapData(MapData::O_WESTWALL))
-							{
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade, true);
-							}
-							else
-							{
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade, false);
-							}
-						}
-						// Draw object
-						if (tile->getMapData(MapData::O_OBJECT) && tile->getMapData(MapData::O_OBJECT)->getBigWall() < 6)
-						{
-							tmpSurface = tile->getSprite(MapData::O_OBJECT);
-							if (tmpSurface)
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade, false, tileColor);
-						}
-						// draw an item on top of the floor (if any)
-						int sprite = tile->getTopItemSprite();
-						if (sprite != -1)
-						{
-							tmpSurface = _res->getSurfaceSet("FLOOROB.PCK")->getFrame(sprite);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), tileShade, false);
-						}
-						
-					}
+	if (tile->isDiscovered(2))
+	{
+		tileShade = tile->getShade();
+	}
+	else
+	{
+		tileShade = 16;
+		unit = 0;
+	}
 
-					// check if we got bullet && it is in Field Of View
-					if (_projectile && projectileInFOV)
-					{
-						tmpSurface = 0;
-						if (_projectile->getItem())
-						{
-							tmpSurface = _projectile->getSprite();
-
-							Position voxelPos = _projectile->getPosition();
-							// draw shadow on the floor
-							voxelPos.z = _save->getTileEngine()->castedShade(voxelPos);
-							if (voxelPos.x / 16 >= itX &&
-								voxelPos.y / 16 >= itY &&
-								voxelPos.x / 16 <= itX+1 &&
-								voxelPos.y / 16 <= itY+1 &&
-								voxelPos.z / 24 == itZ &&
-								_save->getTileEngine()->isVoxelVisible(voxelPos))
-							{
-								_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-								tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 16);
-							}
-
-							voxelPos = _projectile->getPosition();
-							// draw thrown object
-							if (voxelPos.x / 16 >= itX &&
-								voxelPos.y / 16 >= itY &&
-								voxelPos.x / 16 <= itX+1 &&
-								voxelPos.y / 16 <= itY+1 &&
-								voxelPos.z / 24 == itZ &&
-								_save->getTileEngine()->isVoxelVisible(voxelPos))
-							{
-								_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-								tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 0);
-							}
+	tileColor = tile->getMarkerColor();
 
-						}
-						else
-						{
-							// draw bullet on the correct tile
-							if (itX >= bulletLowX && itX <= bulletHighX && itY >= bulletLowY && itY <= bulletHighY)
-							{
-								for (int i = 1; i <= _projectile->getParticle(0); ++i)
-								{
-									if (_projectile->getParticle(i) != 0xFF)
-									{
-										Position voxelPos = _projectile->getPosition(1-i);
-										// draw shadow on the floor
-										voxelPos.z = _save->getTileEngine()->castedShade(voxelPos);
-										if (voxelPos.x / 16 == itX &&
-											voxelPos.y / 16 == itY &&
-											voxelPos.z / 24 == itZ &&
-											_save->getTileEngine()->isVoxelVisible(voxelPos))
-										{
-											_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-											_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 16);
-										}
-										// draw bullet itself
-										voxelPos = _projectile->getPosition(1-i);
-										if (voxelPos.x / 16 == itX &&
-											voxelPos.y / 16 == itY &&
-											voxelPos.z / 24 == itZ &&
-											_save->getTileEngine()->isVoxelVisible(voxelPos))
-										{
-											_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-											_bullet[_projectile->getParticle(i)]->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 0);
-										}
-
-									}
-								}
-							}
-						}
-					}
+	// Draw floor
+	tmpSurface = tile->getSprite(MapData::O_FLOOR);
+	if (tmpSurface)
+		drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_FLOOR)->getYOffset(), tileShade, false, tileColor);
+	unit = tile->getUnit();
 
-			        unit = tile->getUnit();
-					// Draw soldier
-					if (unit && (unit->getVisible() || _save->getDebugMode()))
-					{
-						// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
-						int part = 0;
-						part += tile->getPosition().x - unit->getPosition().x;
-						part += (tile->getPosition().y - unit->getPosition().y)*2;
-						tmpSurface = unit->getCache(&invalid, part);
-						if (tmpSurface)
-						{
-							Position offset;
-							calculateWalkingOffset(unit, &offset);
-							tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
-							if (unit->getFire() > 0)
-							{
-								frameNumber = 4 + (_animFrame / 2);
-								tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
-							}
-						}
-					}
-					// if we can see through the floor, draw the soldier below it if it is on stairs
-					Tile *tileBelow = _save->getTile(mapPosition + Position(0, 0, -1));
-					if (itZ > 0 && tile->hasNoFloor(tileBelow))
-					{
-						BattleUnit *tunit = _save->selectUnit(Position(itX, itY, itZ-1));
-						Tile *ttile = _save->getTile(Position(itX, itY, itZ-1));
-						if (tunit && tunit->getVisible() && ttile->getTerrainLevel() < 0 && ttile->isDiscovered(2))
-						{
-							// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
-							int part = 0;
-							part += ttile->getPosition().x - tunit->getPosition().x;
-							part += (ttile->getPosition().y - tunit->getPosition().y)*2;
-							tmpSurface = tunit->getCache(&invalid, part);
-							if (tmpSurface)
-							{
-								Position offset;
-								calculateWalkingOffset(tunit, &offset);
-								offset.y += 24;
-								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, ttile->getShade());
-								if (tunit->getArmor()->getSize() > 1)
-								{
-									offset.y += 4;
-								}
-								if (tunit->getFire() > 0)
-								{
-									frameNumber = 4 + (_animFrame / 2);
-									tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-									tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
-								}
-							}
-						}
-					}
-					if (!tile->isVoid())
-					{
-						// Draw object
-						if (tile->getMapData(MapData::O_OBJECT) && tile->getMapData(MapData::O_OBJECT)->getBigWall() >= 6)
-						{
-							tmpSurface = tile->getSprite(MapData::O_OBJECT);
-							if (tmpSurface)
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade, false, tileColor);
-						}
-					}
+	// Draw cursor back
+	if (_cursorType != CT_NONE && _selectorX > mapPosition.x - _cursorSize && _selectorY > mapPosition.y - _cursorSize && _selectorX < mapPosition.x+1 && _selectorY < mapPosition.y+1 && _game->getCursor()->getY() < 144)
+	{
+		if (_camera->getViewLevel() == mapPosition.z)
+		{
+			if (_cursorType != CT_AIM)
+			{
+				if (unit && (unit->getVisible() || _save->getDebugMode()))
+					frameNumber = (_animFrame % 2); // yellow box
+				else
+					frameNumber = 0; // red box
+			}else
+			{
+				if (unit && (unit->getVisible() || _save->getDebugMode()))
+					frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
+				else
+					frameNumber = 6; // red static crosshairs
+			}
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+		}
+		else if (_camera->getViewLevel() > mapPosition.z)
+		{
+			frameNumber = 2; // blue box
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+		}
+	}
 
-					// Draw cursor front
-					if (_cursorType != CT_NONE && _selectorX > itX - _cursorSize && _selectorY > itY - _cursorSize && _selectorX < itX+1 && _selectorY < itY+1 && _game->getCursor()->getY() < 144)
-					{
-						if (_camera->getViewLevel() == itZ)
-						{
-							if (_cursorType != CT_AIM)
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = 3 + (_animFrame % 2); // yellow box
-								else
-									frameNumber = 3; // red box
-							}else
-							{
-								if (unit && (unit->getVisible() || _save->getDebugMode()))
-									frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
-								else
-									frameNumber = 6; // red static crosshairs
-							}
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						}
-						else if (_camera->getViewLevel() > itZ)
-						{
-							frameNumber = 5; // blue box
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						}
-						if (_cursorType > 2 && _camera->getViewLevel() == itZ)
-						{
-							int frame[6] = {0, 0, 0, 11, 13, 15};
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frame[_cursorType] + (_animFrame / 4));
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-						}
-					}
+	// Draw walls
+	if (!tile->isVoid())
+	{
+		// Draw west wall
+		tmpSurface = tile->getSprite(MapData::O_WESTWALL);
+		if (tmpSurface)
+		{
+			if ((tile->getMapData(MapData::O_WESTWALL)->isDoor() || tile->getMapData(MapData::O_WESTWALL)->isUFODoor())
+				 && tile->isDiscovered(0))
+				wallShade = tile->getShade();
+			else
+				wallShade = tileShade;
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_WESTWALL)->getYOffset(), wallShade, false);
+		}
+		// Draw north wall
+		tmpSurface = tile->getSprite(MapData::O_NORTHWALL);
+		if (tmpSurface)
+		{
+			if ((tile->getMapData(MapData::O_NORTHWALL)->isDoor() || tile->getMapData(MapData::O_NORTHWALL)->isUFODoor())
+				 && tile->isDiscovered(1))
+				wallShade = tile->getShade();
+			else
+				wallShade = tileShade;
+			if (tile->getMapData(MapData::O_WESTWALL))
+			{
+				drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade, true);
+			}
+			else
+			{
+				drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_NORTHWALL)->getYOffset(), wallShade, false);
+			}
+		}
+		// Draw object
+		if (tile->getMapData(MapData::O_OBJECT) && tile->getMapData(MapData::O_OBJECT)->getBigWall() < 6)
+		{
+			tmpSurface = tile->getSprite(MapData::O_OBJECT);
+			if (tmpSurface)
+				drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade, false, tileColor);
+		}
+		// draw an item on top of the floor (if any)
+		int sprite = tile->getTopItemSprite();
+		if (sprite != -1)
+		{
+			tmpSurface = _res->getSurfaceSet("FLOOROB.PCK")->getFrame(sprite);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), tileShade, false);
+		}
+		
+	}
 
-					// Draw waypoints if any on this tile
-					int waypid = 1;
-					for (std::vector<Position>::const_iterator i = _waypoints.begin(); i != _waypoints.end(); ++i)
-					{
-						if ((*i) == mapPosition)
-						{
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(7);
-							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-							_numWaypid->setValue(waypid);
-							_numWaypid->draw();
-							_numWaypid->blitNShade(surface, screenPosition.x+2, screenPosition.y+2, 0);
-						}
-						waypid++;
-					}
+	// check if we got bullet && it is in Field Of View
+	if (_projectile && projectileInFOV)
+	{
+		tmpSurface = 0;
+		if (_projectile->getItem())
+		{
+			tmpSurface = _projectile->getSprite();
+
+			Position voxelPos = _projectile->getPosition();
+			// draw shadow on the floor
+			voxelPos.z = _save->getTileEngine()->castedShade(voxelPos);
+			if (voxelPos.x / 16 >= mapPosition.x &&
+				voxelPos.y / 16 >= mapPosition.y &&
+				voxelPos.x / 16 <= mapPosition.x+1 &&
+				voxelPos.y / 16 <= mapPosition.y+1 &&
+				voxelPos.z / 24 == mapPosition.z &&
+				_save->getTileEngine()->isVoxelVisible(voxelPos))
+			{
+				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+				drawSprite(tmpSurface, surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 16);
+			}
 
+			voxelPos = _projectile->getPosition();
+			// draw thrown object
+			if (voxelPos.x / 16 >= mapPosition.x &&
+				voxelPos.y / 16 >= mapPosition.y &&
+				voxelPos.x / 16 <= mapPosition.x+1 &&
+				voxelPos.y / 16 <= mapPosition.y+1 &&
+				voxelPos.z / 24 == mapPosition.z &&
+				_save->getTileEngine()->isVoxelVisible(voxelPos))
+			{
+				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+				drawSprite(tmpSurface, surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 0);
+			}
 
-					// Draw smoke/fire
-					if (tile->getFire() && tile->isDiscovered(2))
+		}
+		else
+		{
+			// draw bullet on the correct tile
+			if (mapPosition.x >= bulletLow.x && mapPosition.x <= bulletHigh.x && mapPosition.y >= bulletLow.y && mapPosition.y <= bulletHigh.y)
+			{
+				for (int i = 1; i <= _projectile->getParticle(0); ++i)
+				{
+					if (_projectile->getParticle(i) != 0xFF)
 					{
-						frameNumber = 0; // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
-						if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
+						Position voxelPos = _projectile->getPosition(1-i);
+						// draw shadow on the floor
+						voxelPos.z = _save->getTileEngine()->castedShade(voxelPos);
+						if (voxelPos.x / 16 == mapPosition.x &&
+							voxelPos.y / 16 == mapPosition.y &&
+							voxelPos.z / 24 == mapPosition.z &&
+							_save->getTileEngine()->isVoxelVisible(voxelPos))
 						{
-							frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
+							_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+							drawSprite(_bullet[_projectile->getParticle(i)], surface, bulletPositionScreen.x, bulletPositionScreen.y, 16);
 						}
-						else
+						// draw bullet itself
+						voxelPos = _projectile->getPosition(1-i);
+						if (voxelPos.x / 16 == mapPosition.x &&
+							voxelPos.y / 16 == mapPosition.y &&
+							voxelPos.z / 24 == mapPosition.z &&
+							_save->getTileEngine()->isVoxelVisible(voxelPos))
 						{
-							frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
+							_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+							drawSprite(_bullet[_projectile->getParticle(i)], surface, bulletPositionScreen.x, bulletPositionScreen.y, 0);
 						}
-						tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
-					}
-					if (tile->getSmoke() && tile->isDiscovered(2))
-					{
-						frameNumber = 8 + int(floor((tile->getSmoke() / 6.0) - 0.1)); // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
 
-						if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
-						{
-							frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
-						}
-						else
-						{
-							frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
-						}
-						tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
-						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 					}
 				}
 			}
 		}
 	}
-	unit = (BattleUnit*)_save->getSelectedUnit();
-	if (unit && (_save->getSide() == FACTION_PLAYER || _save->getDebugMode()) && unit->getPosition().z <= _camera->getViewLevel())
+
+	unit = tile->getUnit();
+	// Draw soldier
+	if (unit && (unit->getVisible() || _save->getDebugMode()))
 	{
-		_camera->convertMapToScreen(unit->getPosition(), &screenPosition);
-		screenPosition += _camera->getMapOffset();
-		Position offset;
-		calculateWalkingOffset(unit, &offset);
-		if (unit->getArmor()->getSize() > 1)
+		// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
+		int part = 0;
+		part += tile->getPosition().x - unit->getPosition().x;
+		part += (tile->getPosition().y - unit->getPosition().y)*2;
+		tmpSurface = unit->getCache(&invalid, part);
+		if (tmpSurface)
 		{
-			offset.y += 4;
+			Position offset;
+			calculateWalkingOffset(unit, &offset);
+			drawSprite(tmpSurface, surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
+			if (unit->getFire() > 0)
+			{
+				frameNumber = 4 + (_animFrame / 2);
+				tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+				drawSprite(tmpSurface, surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
+			}
+		}
+	}
+	// if we can see through the floor, draw the soldier below it if it is on stairs
+	Tile *tileBelow = _save->getTile(mapPosition + Position(0, 0, -1));
+	if (mapPosition.z > 0 && tile->hasNoFloor(tileBelow))
+	{
+		BattleUnit *tunit = _save->selectUnit(Position(mapPosition.x, mapPosition.y, mapPosition.z-1));
+		Tile *ttile = _save->getTile(Position(mapPosition.x, mapPosition.y, mapPosition.z-1));
+		if (tunit && tunit->getVisible() && ttile->getTerrainLevel() < 0 && ttile->isDiscovered(2))
+		{
+			// the part is 0 for small units, large units have parts 1,2 & 3 depending on the relative x/y position of this tile vs the actual unit position.
+			int part = 0;
+			part += ttile->getPosition().x - tunit->getPosition().x;
+			part += (ttile->getPosition().y - tunit->getPosition().y)*2;
+			tmpSurface = tunit->getCache(&invalid, part);
+			if (tmpSurface)
+			{
+				Position offset;
+				calculateWalkingOffset(tunit, &offset);
+				offset.y += 24;
+				drawSprite(tmpSurface, surface, screenPosition.x + offset.x, screenPosition.y + offset.y, ttile->getShade());
+				if (tunit->getArmor()->getSize() > 1)
+				{
+					offset.y += 4;
+				}
+				if (tunit->getFire() > 0)
+				{
+					frameNumber = 4 + (_animFrame / 2);
+					tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+					drawSprite(tmpSurface, surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
+				}
+			}
+		}
+	}
+	if (!tile->isVoid())
+	{
+		// Draw object
+		if (tile->getMapData(MapData::O_OBJECT) && tile->getMapData(MapData::O_OBJECT)->getBigWall() >= 6)
+		{
+			tmpSurface = tile->getSprite(MapData::O_OBJECT);
+			if (tmpSurface)
+				drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y - tile->getMapData(MapData::O_OBJECT)->getYOffset(), tileShade, false, tileColor);
 		}
-		_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
 	}
-	delete _numWaypid;
 
-	// check if we got big explosions
-	if (explosionInFOV)
+	// Draw cursor front
+	if (_cursorType != CT_NONE && _selectorX > mapPosition.x - _cursorSize && _selectorY > mapPosition.y - _cursorSize && _selectorX < mapPosition.x+1 && _selectorY < mapPosition.y+1 && _game->getCursor()->getY() < 144)
 	{
-		for (std::set<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
+		if (_camera->getViewLevel() == mapPosition.z)
 		{
-			if ((*i)->isBig())
+			if (_cursorType != CT_AIM)
 			{
-				Position voxelPos = (*i)->getPosition();
-				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-				tmpSurface = _res->getSurfaceSet("X1.PCK")->getFrame((*i)->getCurrentFrame());
-				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 64, bulletPositionScreen.y - 64, 0);
+				if (unit && (unit->getVisible() || _save->getDebugMode()))
+					frameNumber = 3 + (_animFrame % 2); // yellow box
+				else
+					frameNumber = 3; // red box
+			}else
+			{
+				if (unit && (unit->getVisible() || _save->getDebugMode()))
+					frameNumber = 7 + (_animFrame / 2); // yellow animated crosshairs
+				else
+					frameNumber = 6; // red static crosshairs
 			}
-			else if ((*i)->isHit())
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+		}
+		else if (_camera->getViewLevel() > mapPosition.z)
+		{
+			frameNumber = 5; // blue box
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+		}
+		if (_cursorType > 2 && _camera->getViewLevel() == mapPosition.z)
+		{
+			int frame[6] = {0, 0, 0, 11, 13, 15};
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frame[_cursorType] + (_animFrame / 4));
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+		}
+	}
+
+	// Draw waypoints if any on this tile
+	int waypid = 1;
+	for (std::vector<Position>::const_iterator i = _waypoints.begin(); i != _waypoints.end(); ++i)
+	{
+		if ((*i) == mapPosition)
+		{
+			tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(7);
+			drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+			if (_recordCells)
 			{
-				Position voxelPos = (*i)->getPosition();
-				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-				tmpSurface = _res->getSurfaceSet("HIT.PCK")->getFrame((*i)->getCurrentFrame());
-				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
+				_damage->record(waypid);
 			}
-			else
+			if (_drawCells)
 			{
-				Position voxelPos = (*i)->getPosition();
-				_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
-				tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame((*i)->getCurrentFrame());
-				tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
+				numWaypid->setValue(waypid);
+				numWaypid->draw();
+				numWaypid->blitNShade(surface, screenPosition.x+2, screenPosition.y+2, 0);
 			}
 		}
+		waypid++;
+	}
+
+
+	// Draw smoke/fire
+	if (tile->getFire() && tile->isDiscovered(2))
+	{
+		frameNumber = 0; // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
+		if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
+		{
+			frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
+		}
+		else
+		{
+			frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
+		}
+		tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+		drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+	}
+	if (tile->getSmoke() && tile->isDiscovered(2))
+	{
+		frameNumber = 8 + int(floor((tile->getSmoke() / 6.0) - 0.1)); // see http://www.ufopaedia.org/images/c/cb/Smoke.gif
+
+		if ((_animFrame / 2) + tile->getAnimationOffset() > 3)
+		{
+			frameNumber += ((_animFrame / 2) + tile->getAnimationOffset() - 4);
+		}
+		else
+		{
+			frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
+		}
+		tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+		drawSprite(tmpSurface, surface, screenPosition.x, screenPosition.y, 0);
+	}
+}
+
+/**
+ * Draws the arrow above the selected unit.
+ * @param surface The surface to draw on.
+ */
+void Map::drawArrow(Surface *surface)
+{
+	BattleUnit *unit = (BattleUnit*)_save->getSelectedUnit();
+	if (unit && (_save->getSide() == FACTION_PLAYER || _save->getDebugMode()) && unit->getPosition().z <= _camera->getViewLevel())
+	{
+		Position screenPosition;
+		_camera->convertMapToScreen(unit->getPosition(), &screenPosition);
+		screenPosition += _camera->getMapOffset();
+		Position offset;
+		calculateWalkingOffset(unit, &offset);
+		if (unit->getArmor()->getSize() > 1)
+		{
+			offset.y += 4;
+		}
+		drawSprite(_arrow, surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + _animFrame, 0);
+	}
+}
+
+/**
+ * Draws a sprite of the map, or records what would be drawn to find out what changed.
+ * @param sprite Pointer to the sprite.
+ * @param surface The surface to draw on.
+ * @param x X position in pixels.
+ * @param y Y position in pixels.
+ * @param shade Shade of the sprite.
+ * @param half Only draw the right half of the sprite.
+ * @param color Replacement base color, plus 1.
+ */
+void Map::drawSprite(Surface *sprite, Surface *surface, int x, int y, int shade, bool half, int color)
+{
+	if (_recordCells)
+	{
+		_damage->record(sprite, x, y, shade, half, color);
+	}
+	if (_drawCells)
+	{
+		sprite->blitNShade(surface, x, y, shade, half, color);
 	}
-	surface->unlock();
 }
 
 /**
@@ -810,7 +1160,7 @@ void Map::animate(bool redraw)
 	// animate tiles
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		_save->getTiles()[i]->animate();
+		_save->getTile(i)->animate();
 	}
 
 	// animate certain units (large flying units have a propultion animation)
@@ -1030,10 +1380,36 @@ void Map::cacheUnit(BattleUnit *unit)
 			unitSprite->blit(cache);
 			unit->setCache(cache, i);
 		}
+		invalidateUnit(unit);
 	}	
 	delete unitSprite;
 }
 
+/**
+ * Makes sure the cells a unit is drawn on get drawn again,
+ * as their sprites stay the same when the unit's looks change.
+ * @param unit Pointer to the unit.
+ */
+void Map::invalidateUnit(BattleUnit *unit)
+{
+	int size = unit->getArmor()->getSize();
+	// units on stairs are also drawn on the cell above them
+	for (int z = unit->getPosition().z; z <= unit->getPosition().z + 1 && z < _save->getMapSizeZ(); ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			for (int y = 0; y < size; ++y)
+			{
+				Position pos = Position(unit->getPosition().x + x, unit->getPosition().y + y, z);
+				if (_save->getTile(pos))
+				{
+					_damage->invalidateCell(_save->getTileIndex(pos));
+				}
+			}
+		}
+	}
+}
+
 /**
  * Put a projectile sprite on the map
  * @param projectile
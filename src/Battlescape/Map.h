@@ -20,6 +20,7 @@
 #define OPENXCOM_MAP_H
 
 #include "../Engine/InteractiveSurface.h"
+#include "Position.h"
 #include <set>
 #include <vector>
 
@@ -30,7 +31,6 @@ class ResourcePack;
 class SavedBattleGame;
 class Surface;
 class MapData;
-class Position;
 class Tile;
 class BattleUnit;
 class BulletSprite;
@@ -39,6 +39,9 @@ class Explosion;
 class BattlescapeMessage;
 class Camera;
 class Timer;
+class NumberText;
+class MapDamage;
+class TerrainCache;
 
 enum CursorType { CT_NONE, CT_NORMAL, CT_AIM, CT_PSI, CT_WAYPOINT, CT_THROW };
 
@@ -70,7 +73,18 @@ private:
 	BattlescapeMessage *_message;
 	Camera *_camera;
 	int _visibleMapHeight;
+	MapDamage *_damage;
+	TerrainCache *_terrainCache;
+	Position _drawnOffset;
+	bool _dirtyRedraw, _drawnAllLayers, _drawnEffects, _recordCells, _drawCells;
 	void drawTerrain(Surface *surface);
+	void drawViewCell(Surface *surface, const Position &mapPosition, const std::vector<SDL_Rect> *regions, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid);
+	void drawCachedLevel(Surface *surface, int z, int beginX, int endX, int beginY, int endY, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid);
+	void drawChunk(Surface *surface, int chunkX, int chunkY, int z, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid);
+	bool isTerrainOnly(Tile *tile) const;
+	void drawCell(Surface *surface, Tile *tile, const Position &screenPosition, const Position &bulletLow, const Position &bulletHigh, NumberText *numWaypid);
+	void drawArrow(Surface *surface);
+	void drawSprite(Surface *sprite, Surface *surface, int x, int y, int shade, bool half = false, int color = 0);
 	int getTerrainLevel(Position pos, int size);
 	std::vector<Position> _waypoints;
 	bool _unitDying;
@@ -113,6 +127,8 @@ public:
 	void cacheUnits();
 	/// Cache unit.
 	void cacheUnit(BattleUnit *unit);
+	/// Redraw the cells of a unit.
+	void invalidateUnit(BattleUnit *unit);
 	/// Set projectile
 	void setProjectile(Projectile *projectile);
 	/// Get projectile
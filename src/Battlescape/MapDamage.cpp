@@ -0,0 +1,266 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MapDamage.h"
+#include <algorithm>
+#include "../Engine/Surface.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Mixes a value into a cell signature (FNV-1a).
+ * @param signature Signature so far.
+ * @param value Value to mix in.
+ * @return New signature.
+ */
+static inline Uint64 mixSignature(Uint64 signature, Uint64 value)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		signature = (signature ^ (value & 0xFF)) * 1099511628211ULL;
+		value >>= 8;
+	}
+	return signature;
+}
+
+/**
+ * Sets up a damage tracker for a view, with the whole view damaged.
+ * @param width Width of the view in pixels.
+ * @param height Height of the view in pixels.
+ * @param cells Number of cells that can be drawn in the view.
+ */
+MapDamage::MapDamage(int width, int height, int cells) : _width(width), _height(height), _full(true), _currentIndex(-1)
+{
+	_columns = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	_rows = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	_blocks.resize(_columns * _rows, false);
+	MapCell empty = { 0, 0, 0, 0, 0 };
+	_cells.resize(cells, empty);
+	_current = empty;
+}
+
+/**
+ * Deletes the damage tracker.
+ */
+MapDamage::~MapDamage()
+{
+}
+
+/**
+ * Damages a rectangle of the view.
+ * @param left Left edge in pixels.
+ * @param top Top edge in pixels.
+ * @param right Right edge in pixels, exclusive.
+ * @param bottom Bottom edge in pixels, exclusive.
+ */
+void MapDamage::damage(int left, int top, int right, int bottom)
+{
+	if (right <= left || bottom <= top)
+		return;
+	left = std::max(left, 0) / BLOCK_SIZE;
+	top = std::max(top, 0) / BLOCK_SIZE;
+	right = (std::min(right, _width) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	bottom = (std::min(bottom, _height) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	for (int y = top; y < bottom; ++y)
+	{
+		for (int x = left; x < right; ++x)
+		{
+			_blocks[y * _columns + x] = true;
+		}
+	}
+}
+
+/**
+ * Damages the whole view, eg. when it scrolled.
+ */
+void MapDamage::invalidate()
+{
+	_full = true;
+}
+
+/**
+ * Forces a cell to be redrawn, for changes that don't show
+ * in its signature, like a unit sprite that was drawn again.
+ * @param index Index of the cell.
+ */
+void MapDamage::invalidateCell(int index)
+{
+	const MapCell &cell = _cells[index];
+	damage(cell.left, cell.top, cell.right, cell.bottom);
+}
+
+/**
+ * Checks if the whole view is damaged.
+ * @return True if everything needs to be redrawn.
+ */
+bool MapDamage::isFull() const
+{
+	return _full;
+}
+
+/**
+ * Starts recording the sprites a cell draws.
+ * @param index Index of the cell.
+ */
+void MapDamage::beginCell(int index)
+{
+	_currentIndex = index;
+	_current.signature = 14695981039346656037ULL;
+	_current.left = _current.top = _current.right = _current.bottom = 0;
+}
+
+/**
+ * Records a sprite drawn for the current cell.
+ * @param sprite Pointer to the sprite.
+ * @param x X position in pixels.
+ * @param y Y position in pixels.
+ * @param shade Shade of the sprite.
+ * @param half Only the right half of the sprite is drawn.
+ * @param color Replacement base color.
+ */
+void MapDamage::record(Surface *sprite, int x, int y, int shade, bool half, int color)
+{
+	_current.signature = mixSignature(_current.signature, (Uint64)(size_t)sprite);
+	_current.signature = mixSignature(_current.signature, ((Uint64)(Uint32)x << 32) | (Uint32)y);
+	_current.signature = mixSignature(_current.signature, ((Uint64)(Uint32)shade << 32) | ((Uint32)color << 1) | (half ? 1 : 0));
+
+	int left = half ? x + sprite->getWidth() / 2 : x;
+	int right = x + sprite->getWidth();
+	int bottom = y + sprite->getHeight();
+	if (_current.right <= _current.left)
+	{
+		_current.left = left;
+		_current.top = y;
+		_current.right = right;
+		_current.bottom = bottom;
+	}
+	else
+	{
+		_current.left = std::min(_current.left, left);
+		_current.top = std::min(_current.top, y);
+		_current.right = std::max(_current.right, right);
+		_current.bottom = std::max(_current.bottom, bottom);
+	}
+}
+
+/**
+ * Records a value the looks of the current cell depend on,
+ * that isn't evident from the sprites it draws.
+ * @param value The value.
+ */
+void MapDamage::record(int value)
+{
+	_current.signature = mixSignature(_current.signature, (Uint32)value);
+}
+
+/**
+ * Finishes recording the current cell. If it draws something else
+ * than last time, both the area it covered and covers now are damaged.
+ */
+void MapDamage::endCell()
+{
+	MapCell &cell = _cells[_currentIndex];
+	if (!_full && cell.signature != _current.signature)
+	{
+		damage(cell.left, cell.top, cell.right, cell.bottom);
+		damage(_current.left, _current.top, _current.right, _current.bottom);
+	}
+	cell = _current;
+	_currentIndex = -1;
+}
+
+/**
+ * Gets the damaged parts of the view as rectangles. Neighbouring damaged
+ * blocks on a row are joined, and so are equal spans on successive rows.
+ * @return List of rectangles, empty if nothing needs redrawing.
+ */
+const std::vector<SDL_Rect> &MapDamage::getRegions()
+{
+	_regions.clear();
+	if (_full)
+	{
+		SDL_Rect all = { 0, 0, (Uint16)_width, (Uint16)_height };
+		_regions.push_back(all);
+		return _regions;
+	}
+
+	// spans on the previous row that can still grow downwards
+	std::vector<size_t> open, next;
+	for (int y = 0; y < _rows; ++y)
+	{
+		next.clear();
+		for (int x = 0; x < _columns; ++x)
+		{
+			if (!_blocks[y * _columns + x])
+				continue;
+			int start = x;
+			while (x < _columns && _blocks[y * _columns + x])
+				++x;
+
+			SDL_Rect region;
+			region.x = start * BLOCK_SIZE;
+			region.y = y * BLOCK_SIZE;
+			region.w = std::min(x * BLOCK_SIZE, _width) - region.x;
+			region.h = std::min((y + 1) * BLOCK_SIZE, _height) - region.y;
+
+			bool joined = false;
+			for (std::vector<size_t>::const_iterator i = open.begin(); i != open.end(); ++i)
+			{
+				if (_regions[*i].x == region.x && _regions[*i].w == region.w)
+				{
+					_regions[*i].h += region.h;
+					next.push_back(*i);
+					joined = true;
+					break;
+				}
+			}
+			if (!joined)
+			{
+				next.push_back(_regions.size());
+				_regions.push_back(region);
+			}
+		}
+		open.swap(next);
+	}
+	return _regions;
+}
+
+/**
+ * Checks if what a cell drew overlaps a damaged part of the view.
+ * @param index Index of the cell.
+ * @param region The damaged part.
+ * @return True if the cell needs to be drawn again.
+ */
+bool MapDamage::overlaps(int index, const SDL_Rect &region) const
+{
+	const MapCell &cell = _cells[index];
+	return cell.right > cell.left && cell.left < region.x + region.w && cell.right > region.x
+		&& cell.top < region.y + region.h && cell.bottom > region.y;
+}
+
+/**
+ * Marks the whole view as redrawn.
+ */
+void MapDamage::repaired()
+{
+	_full = false;
+	std::fill(_blocks.begin(), _blocks.end(), false);
+}
+
+}
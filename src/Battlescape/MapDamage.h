@@ -0,0 +1,87 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_MAPDAMAGE_H
+#define OPENXCOM_MAPDAMAGE_H
+
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+class Surface;
+
+/**
+ * What was drawn for a single map cell the last time the map was drawn:
+ * a signature of all the sprites blitted for it and the area they covered.
+ */
+struct MapCell
+{
+	Uint64 signature;
+	int left, top, right, bottom;
+};
+
+/**
+ * Keeps track of the parts of the battlescape view that need to be redrawn.
+ * Every cell records the sprites it draws; cells that draw something else than
+ * last time damage the screen area they covered before and cover now.
+ * The damaged area is kept as a grid of blocks, handed out as rectangles.
+ */
+class MapDamage
+{
+private:
+	static const int BLOCK_SIZE = 16;
+	int _width, _height, _columns, _rows;
+	bool _full;
+	std::vector<MapCell> _cells;
+	std::vector<bool> _blocks;
+	std::vector<SDL_Rect> _regions;
+	MapCell _current;
+	int _currentIndex;
+	void damage(int left, int top, int right, int bottom);
+public:
+	/// Creates a new damage tracker.
+	MapDamage(int width, int height, int cells);
+	/// Cleans up the damage tracker.
+	~MapDamage();
+	/// Damages the whole view.
+	void invalidate();
+	/// Forces a cell to be redrawn.
+	void invalidateCell(int index);
+	/// Checks if the whole view is damaged.
+	bool isFull() const;
+	/// Starts recording what a cell draws.
+	void beginCell(int index);
+	/// Records a sprite drawn for the current cell.
+	void record(Surface *sprite, int x, int y, int shade, bool half, int color);
+	/// Records a value the current cell's looks depend on.
+	void record(int value);
+	/// Finishes recording what a cell draws.
+	void endCell();
+	/// Gets the damaged parts of the view.
+	const std::vector<SDL_Rect> &getRegions();
+	/// Checks if a cell overlaps a damaged part of the view.
+	bool overlaps(int index, const SDL_Rect &region) const;
+	/// Marks the whole view as redrawn.
+	void repaired();
+};
+
+}
+
+#endif
@@ -17,25 +17,34 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <list>
+#include <algorithm>
 #include "Pathfinding.h"
 #include "PathfindingNode.h"
 #include "PathfindingOpenSet.h"
+#include "ReachabilityCache.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
 #include "../Ruleset/MapData.h"
 #include "../Ruleset/Armor.h"
 #include "../Savegame/BattleUnit.h"
 #include "../Engine/Game.h"
+#include "../Engine/Profiler.h"
 #include "../Battlescape/TileEngine.h"
 
 namespace OpenXcom
 {
 
+/// A step cost that hasn't been worked out yet.
+static const unsigned short STEP_UNKNOWN = 0xFFFF;
+/// How far away (in tiles) a terrain change can affect the cost of a step: a step looks at
+/// tiles up to 3 tiles from its start, and a detonation also changes the next tiles over.
+static const int STEP_RANGE = 4;
+
 /**
  * Sets up a Pathfinding.
  * @param save pointer to SavedBattleGame object.
  */
-Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0), _pathPreviewed(false)
+Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _searchId(0), _reachability(0), _movementType(MT_WALK), _unit(0), _pathPreviewed(false), _strafeMove(false)
 {
 	_size = _save->getMapSizeXYZ();
 	// Initialize one node per tile
@@ -46,6 +55,7 @@ Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0
 		_save->getTileCoords(i, &p.x, &p.y, &p.z);
 		_nodes.push_back(PathfindingNode(p));
 	}
+	_reachability = new ReachabilityCache(save);
 }
 
 /**
@@ -54,7 +64,7 @@ Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _nodes(), _unit(0
  */
 Pathfinding::~Pathfinding()
 {
-	// Nothing more to do here.
+	delete _reachability;
 }
 
 /**
@@ -64,7 +74,24 @@ Pathfinding::~Pathfinding()
  */
 PathfindingNode *Pathfinding::getNode(const Position& pos)
 {
-	return &_nodes[_save->getTileIndex(pos)];
+	PathfindingNode *node = &_nodes[_save->getTileIndex(pos)];
+	node->reset(_searchId);
+	return node;
+}
+
+/**
+ * Starts a new search: all nodes count as reset from now on, and the open set is emptied.
+ */
+void Pathfinding::newSearch()
+{
+	if (++_searchId == 0)
+	{
+		// the id wrapped around, old ids could come back, so really reset every node once
+		for (std::vector<PathfindingNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+			it->reset(0);
+		_searchId = 1;
+	}
+	_openSet.clear();
 }
 
 /**
@@ -77,6 +104,7 @@ PathfindingNode *Pathfinding::getNode(const Position& pos)
 
 void Pathfinding::calculate(BattleUnit *unit, Position endPosition, BattleUnit *target, int maxTUCost)
 {
+	ProfileZone zone("Pathfinding::calculate");
 	_totalTUCost = 0;
 	// i'm DONE with these out of bounds errors.
 	if (endPosition.x > _save->getMapSizeX() - unit->getArmor()->getSize() || endPosition.y > _save->getMapSizeY() - unit->getArmor()->getSize() || endPosition.x < 0 || endPosition.y < 0) return;
@@ -177,13 +205,12 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition, BattleUnit *
 bool Pathfinding::aStarPath(const Position &startPosition, const Position &endPosition, BattleUnit *target, bool sneak, int maxTUCost)
 {
 	// reset every node, so we have to check them all
-	for (std::vector<PathfindingNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
-		it->reset();
+	newSearch();
 
 	// start position is the first one in our "open" list
 	PathfindingNode *start = getNode(startPosition);
 	start->connect(0, 0, 0, endPosition);
-	PathfindingOpenSet openList;
+	PathfindingOpenSet &openList = _openSet;
 	openList.push(start);
 	bool missile = (target && maxTUCost == 10000);
 	// if the open list is empty, we've reached the end
@@ -232,6 +259,8 @@ bool Pathfinding::aStarPath(const Position &startPosition, const Position &endPo
  * Gets the TU cost to move from 1 tile to the other (ONE STEP ONLY).
  * But also updates the endPosition, because it is possible
  * the unit goes upstairs or falls down while walking.
+ * The cost of the terrain is cached per tile and direction for each movement type
+ * and unit size, steps that could be affected by units are worked out every time.
  * @param startPosition The position to start from.
  * @param direction The direction we are facing.
  * @param endPosition The position we want to reach.
@@ -241,6 +270,73 @@ bool Pathfinding::aStarPath(const Position &startPosition, const Position &endPo
  * @return TU cost or 255 if movement impossible
  */
 int Pathfinding::getTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile)
+{
+	int size = unit->getArmor()->getSize();
+	if (size > 2 || unit->getArmor()->getMovementType() != _movementType || (_save->getStrafeSetting() && _strafeMove)
+		|| startPosition.x < 0 || startPosition.y < 0 || startPosition.z < 0
+		|| startPosition.x >= _save->getMapSizeX() || startPosition.y >= _save->getMapSizeY() || startPosition.z >= _save->getMapSizeZ()
+		|| hasUnitsNear(startPosition, direction, size))
+	{
+		return calculateTUCost(startPosition, direction, endPosition, unit, target, missile);
+	}
+
+	std::vector<unsigned short> &costs = _stepCosts[_movementType][size - 1];
+	if (costs.empty())
+	{
+		costs.resize(_size * 10, STEP_UNKNOWN);
+		if (_uncachedSteps.empty())
+		{
+			_uncachedSteps.resize(_size, false);
+			for (int i = 0; i < _size; ++i)
+			{
+				markUfoDoor(_save->getTile(i)->getPosition());
+			}
+		}
+	}
+	int index = _save->getTileIndex(startPosition);
+	if (_uncachedSteps[index])
+	{
+		return calculateTUCost(startPosition, direction, endPosition, unit, target, missile);
+	}
+
+	// the low 10 bits hold the cost, the rest where the step ends up
+	unsigned short &step = costs[index * 10 + direction];
+	int cost;
+	if (step == STEP_UNKNOWN)
+	{
+		cost = calculateTUCost(startPosition, direction, endPosition, unit, target, false);
+		Position offset = *endPosition - startPosition;
+		if (cost < 1023 && abs(offset.x) <= 1 && abs(offset.y) <= 1 && offset.z >= -2 && offset.z <= 1)
+		{
+			step = cost | ((((offset.x + 1) * 3 + offset.y + 1) * 4 + offset.z + 2) << 10);
+		}
+	}
+	else
+	{
+		_unit = unit;
+		cost = step & 1023;
+		int code = step >> 10;
+		*endPosition = startPosition + Position(code / 12 - 1, code / 4 % 3 - 1, code % 4 - 2);
+	}
+
+	if (missile && cost < 255)
+		return 0;
+	else
+		return cost;
+}
+
+/**
+ * Works out the TU cost to move from 1 tile to the other, like getTUCost(),
+ * looking at the actual tiles instead of the cached costs.
+ * @param startPosition The position to start from.
+ * @param direction The direction we are facing.
+ * @param endPosition The position we want to reach.
+ * @param unit The unit moving.
+ * @param target The target unit.
+ * @param missile Is this a guided missile?
+ * @return TU cost or 255 if movement impossible
+ */
+int Pathfinding::calculateTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile)
 {
 	_unit = unit;
 	directionToVector(direction, endPosition);
@@ -942,17 +1038,47 @@ bool Pathfinding::bresenhamPath(const Position& origin, const Position& target,
  */
 std::vector<int> Pathfinding::findReachable(BattleUnit *unit, int tuMax)
 {
-	const Position &start = unit->getPosition();
+	return getReachable(unit, tuMax).tiles;
+}
 
-	for (std::vector<PathfindingNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+/**
+ * Gets all tiles reachable to @a *unit with a TU cost no more than @a tuMax, along with
+ * the cost of each of them. The result is kept until the unit, any other unit
+ * or the terrain changes, so any number of destinations can be looked up at once.
+ * @param unit Pointer to the unit.
+ * @param tuMax The maximum cost of the path to each tile.
+ * @return The reachable tiles, valid until the next change to the map.
+ */
+const ReachableTiles &Pathfinding::getReachable(BattleUnit *unit, int tuMax)
+{
+	ReachableTiles *reachable = _reachability->find(unit, tuMax);
+	if (reachable == 0)
 	{
-		it->reset();
+		reachable = _reachability->update(unit, tuMax);
+		flood(unit, tuMax, reachable);
 	}
+	return *reachable;
+}
+
+/**
+ * Use Dijkstra's algorithm to locate all tiles reachable to @a *unit with a TU cost no more than @a tuMax.
+ * @param unit Pointer to the unit.
+ * @param tuMax The maximum cost of the path to each tile.
+ * @param reachable Receives the reachable tiles, sorted in ascending order of cost, and their costs.
+ */
+void Pathfinding::flood(BattleUnit *unit, int tuMax, ReachableTiles *reachable)
+{
+	const Position &start = unit->getPosition();
+	_movementType = unit->getArmor()->getMovementType();
+	bool strafeMove = _strafeMove;
+	_strafeMove = false;
+
+	newSearch();
 	PathfindingNode *startNode = getNode(start);
 	startNode->connect(0, 0, 0);
-	PathfindingOpenSet unvisited;
+	PathfindingOpenSet &unvisited = _openSet;
 	unvisited.push(startNode);
-	std::vector<PathfindingNode*> reachable;
+	std::vector<PathfindingNode*> nodes;
 	while (!unvisited.empty())
 	{
 		PathfindingNode *currentNode = unvisited.pop();
@@ -979,16 +1105,17 @@ std::vector<int> Pathfinding::findReachable(BattleUnit *unit, int tuMax)
 			}
 		}
 		currentNode->setChecked();
-		reachable.push_back(currentNode);
+		nodes.push_back(currentNode);
 	}
-	std::sort(reachable.begin(), reachable.end(), MinNodeCosts());
-	std::vector<int> tiles;
-	tiles.reserve(reachable.size());
-	for (std::vector<PathfindingNode*>::const_iterator it = reachable.begin(); it != reachable.end(); ++it)
+	std::sort(nodes.begin(), nodes.end(), MinNodeCosts());
+	reachable->tiles.reserve(nodes.size());
+	for (std::vector<PathfindingNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
 	{
-		tiles.push_back(_save->getTileIndex((*it)->getPosition()));
+		int index = _save->getTileIndex((*it)->getPosition());
+		reachable->tiles.push_back(index);
+		reachable->costs[index] = (*it)->getTUCost(false);
 	}
-	return tiles;
+	_strafeMove = strafeMove;
 }
 
 /**
@@ -999,4 +1126,124 @@ bool Pathfinding::getStrafeMove() const {
 	return _strafeMove;
 }
 
+/**
+ * Checks if there are units on any of the tiles a step could
+ * end up on, or that could get in the way of a flying unit.
+ * Steps like that depend on more than just the terrain, so they aren't cached.
+ * @param startPosition The position to start from.
+ * @param direction The direction of the step.
+ * @param size The size of the unit.
+ * @return True if there are units nearby.
+ */
+bool Pathfinding::hasUnitsNear(const Position &startPosition, int direction, int size) const
+{
+	Position vector;
+	directionToVector(direction, &vector);
+	int minZ = std::max(startPosition.z - 2, 0);
+	int maxZ = std::min(startPosition.z + 1, _save->getMapSizeZ() - 1);
+	int layer = _save->getMapSizeX() * _save->getMapSizeY();
+	Tile **tiles = _save->getTiles();
+	// the step can end up above or below the start (falling) or the destination (stairs)
+	for (int column = 0; column < (direction < DIR_UP ? 2 : 1); ++column)
+	{
+		Position origin = column ? startPosition + vector : startPosition;
+		for (int x = origin.x; x < origin.x + size; ++x)
+		{
+			for (int y = origin.y; y < origin.y + size; ++y)
+			{
+				if (x < 0 || y < 0 || x >= _save->getMapSizeX() || y >= _save->getMapSizeY())
+					continue;
+				int index = _save->getTileIndex(Position(x, y, minZ));
+				for (int z = minZ; z <= maxZ; ++z, index += layer)
+				{
+					if (tiles[index]->getUnit())
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Checks if a tile has a ufo door, and if so, stops caching all the
+ * steps around it. Ufo doors change their cost while they animate.
+ * @param position The position of the tile.
+ */
+void Pathfinding::markUfoDoor(const Position &position)
+{
+	Tile *tile = _save->getTile(position);
+	if (tile == 0)
+		return;
+	bool ufoDoor = false;
+	for (int part = 0; part < 4; ++part)
+	{
+		if (tile->getMapData(part) && tile->getMapData(part)->isUFODoor())
+			ufoDoor = true;
+	}
+	if (!ufoDoor)
+		return;
+	for (int x = std::max(position.x - STEP_RANGE, 0); x <= std::min(position.x + STEP_RANGE, _save->getMapSizeX() - 1); ++x)
+	{
+		for (int y = std::max(position.y - STEP_RANGE, 0); y <= std::min(position.y + STEP_RANGE, _save->getMapSizeY() - 1); ++y)
+		{
+			for (int z = std::max(position.z - STEP_RANGE, 0); z <= std::min(position.z + STEP_RANGE, _save->getMapSizeZ() - 1); ++z)
+			{
+				_uncachedSteps[_save->getTileIndex(Position(x, y, z))] = true;
+			}
+		}
+	}
+}
+
+/**
+ * Forgets the cached costs of all the steps that could be affected
+ * by a change of the terrain on a tile, and all reachable tiles.
+ * Needs to be called whenever a tile part is destroyed or a door opens.
+ * @param position The position of the changed tile.
+ */
+void Pathfinding::tileChanged(const Position &position)
+{
+	_reachability->tileChanged();
+	if (_uncachedSteps.empty())
+		return;
+	for (int x = std::max(position.x - STEP_RANGE, 0); x <= std::min(position.x + STEP_RANGE, _save->getMapSizeX() - 1); ++x)
+	{
+		for (int y = std::max(position.y - STEP_RANGE, 0); y <= std::min(position.y + STEP_RANGE, _save->getMapSizeY() - 1); ++y)
+		{
+			for (int z = std::max(position.z - STEP_RANGE, 0); z <= std::min(position.z + STEP_RANGE, _save->getMapSizeZ() - 1); ++z)
+			{
+				int index = _save->getTileIndex(Position(x, y, z)) * 10;
+				for (int i = 0; i < 6; ++i)
+				{
+					std::vector<unsigned short> &costs = _stepCosts[i / 2][i % 2];
+					if (!costs.empty())
+						std::fill(costs.begin() + index, costs.begin() + index + 10, STEP_UNKNOWN);
+				}
+			}
+		}
+	}
+	markUfoDoor(position);
+}
+
+/**
+ * Forgets all the cached step costs and reachable tiles, eg. when a new map is loaded.
+ */
+void Pathfinding::invalidateCache()
+{
+	_reachability->clear();
+	for (int i = 0; i < 6; ++i)
+	{
+		std::vector<unsigned short>().swap(_stepCosts[i / 2][i % 2]);
+	}
+	std::vector<bool>().swap(_uncachedSteps);
+}
+
+/**
+ * Forgets all the cached reachable tiles, eg. at the start of a turn.
+ */
+void Pathfinding::clearReachable()
+{
+	_reachability->clear();
+}
+
 }
@@ -22,6 +22,7 @@
 #include <vector>
 #include "Position.h"
 #include "../Ruleset/MapData.h"
+#include "PathfindingOpenSet.h"
 
 namespace OpenXcom
 {
@@ -31,6 +32,8 @@ class SavedBattleGame;
 class PathfindingNode;
 class Tile;
 class BattleUnit;
+class ReachabilityCache;
+struct ReachableTiles;
 
 /**
  * A utility class that calculates the shortest path between two points on the battlescape map.
@@ -40,11 +43,18 @@ class Pathfinding
 private:
 	SavedBattleGame *_save;
 	std::vector<PathfindingNode> _nodes;
+	unsigned int _searchId;
+	PathfindingOpenSet _openSet;
+	std::vector<unsigned short> _stepCosts[3][2];
+	std::vector<bool> _uncachedSteps;
+	ReachabilityCache *_reachability;
 	int _size;
 	std::vector<int> _path;
 	MovementType _movementType;
 	/// Gets the node at certain position.
 	PathfindingNode *getNode(const Position& pos);
+	/// Starts a new search.
+	void newSearch();
 	/// whether a tile blocks a certain movementType
 	bool isBlocked(Tile *tile, const int part, BattleUnit *missileTarget, int bigWallExclusion = -1);
 	///Try to find a straight line path between two positions.
@@ -53,6 +63,14 @@ private:
 	bool aStarPath(const Position& origin, const Position& target, BattleUnit *missileTarget, bool sneak = false, int maxTUCost = 1000);
 	bool canFallDown(Tile *destinationTile);
 	bool canFallDown(Tile *destinationTile, int size);
+	/// Works out the TU cost of a step, without using the cached costs.
+	int calculateTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile);
+	/// Checks if there are units that could change the cost of a step.
+	bool hasUnitsNear(const Position &startPosition, int direction, int size) const;
+	/// Stops caching steps that go near a ufo door.
+	void markUfoDoor(const Position &position);
+	/// Finds all the tiles a unit can reach.
+	void flood(BattleUnit *unit, int tuMax, ReachableTiles *reachable);
 	BattleUnit *_unit;
 	bool _pathPreviewed;
 	bool _strafeMove;
@@ -89,8 +107,16 @@ public:
 	void setUnit(BattleUnit *unit) { _unit = unit; };
 	/// Get all reachable tiles, based on cost.
 	std::vector<int> findReachable(BattleUnit *unit, int tuMax);
+	/// Get all reachable tiles and their costs, cached for the rest of the turn.
+	const ReachableTiles &getReachable(BattleUnit *unit, int tuMax);
 	/// get _totalTUCost; find out whether we can hike somewhere in this turn or not
 	int getTotalTUCost() const { return _totalTUCost; }
+	/// Forgets the cached step costs around a tile and all reachable tiles.
+	void tileChanged(const Position &position);
+	/// Forgets all cached step costs and reachable tiles.
+	void invalidateCache();
+	/// Forgets all cached reachable tiles.
+	void clearReachable();
 };
 
 }
@@ -27,7 +27,7 @@ namespace OpenXcom
  * Sets up a PathfindingNode.
  * @param pos Position.
  */
-PathfindingNode::PathfindingNode(Position pos) : _pos(pos), _openentry(0)
+PathfindingNode::PathfindingNode(Position pos) : _pos(pos), _checked(false), _searchId(0), _inOpenSet(false), _openCost(0), _openPrev(0), _openNext(0)
 {
 
 }
@@ -49,12 +49,18 @@ const Position &PathfindingNode::getPosition() const
 	return _pos;
 }
 /**
- * Reset node.
+ * Reset node for a new search.
+ * Nodes are reset lazily when a search first touches them, so a search
+ * does not have to go through every node of the map beforehand.
+ * @param searchId Id of the current search; nothing happens if the node was already reset for it.
  */
-void PathfindingNode::reset()
+void PathfindingNode::reset(unsigned int searchId)
 {
+	if (_searchId == searchId)
+		return;
+	_searchId = searchId;
 	_checked = false;
-	_openentry = 0;
+	_inOpenSet = false;
 }
 
 /**
@@ -25,7 +25,6 @@ namespace OpenXcom
 {
 
 class PathfindingOpenSet;
-struct OpenSetEntry;
 
 /**
  * A class that holds pathfinding info for a certain node on the map.
@@ -40,8 +39,12 @@ private:
 	int _prevDir;
 	/// Approximate cost to reach goal position.
 	int _tuGuess;
-	// Invasive field needed by PathfindingOpenSet
-	OpenSetEntry *_openentry;
+	/// Search this node was last reset for.
+	unsigned int _searchId;
+	// Invasive fields needed by PathfindingOpenSet
+	bool _inOpenSet;
+	unsigned int _openCost;
+	PathfindingNode *_openPrev, *_openNext;
 	friend class PathfindingOpenSet;
 public:
 	/// Creates a new PathfindingNode class
@@ -50,8 +53,8 @@ public:
 	~PathfindingNode();
 	/// Get the node position
 	const Position &getPosition() const;
-	/// Reset node.
-	void reset();
+	/// Reset node for a new search.
+	void reset(unsigned int searchId);
 	/// is checked?
 	bool isChecked() const;
 	/// Mark as checked
@@ -65,7 +68,7 @@ public:
 	/// get previous walking direction
 	int getPrevDir() const;
 	/// Is this node already in a PathfindingOpenSet?
-	bool inOpenSet() const { return (_openentry != 0); }
+	bool inOpenSet() const { return _inOpenSet; }
 	/// Get approximate cost to reach target position.
 	int getTUGuess() const { return _tuGuess; }
 	/// Connect to previous node along the path.
@@ -17,33 +17,56 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "PathfindingOpenSet.h"
+#include <assert.h>
 #include "PathfindingNode.h"
 
 namespace OpenXcom
 {
 
 /**
- * Cleans up all the entries still in set.
+ * Sets up an empty set.
+ */
+PathfindingOpenSet::PathfindingOpenSet() : _first(0), _last(0), _size(0)
+{
+}
+
+/**
+ * The nodes are not owned by the set, so there is nothing to free.
  */
 PathfindingOpenSet::~PathfindingOpenSet()
 {
-	while (!_queue.empty())
-	{
-		delete _queue.top();
-		_queue.pop();
-	}
 }
 
 /**
- * Keep removing all discarded entries that have come to the top of the queue.
+ * Remove all nodes from the set, keeping the buckets for the next search.
+ * The nodes themselves are not touched, they get reset by the next search anyway.
  */
-void PathfindingOpenSet::removeDiscarded()
+void PathfindingOpenSet::clear()
 {
-	while (!_queue.empty() && !_queue.top()->_node)
+	if (_size != 0)
 	{
-		delete _queue.top();
-		_queue.pop();
+		for (unsigned int i = _first; i <= _last && i < _buckets.size(); ++i)
+		{
+			_buckets[i] = 0;
+		}
 	}
+	_first = _last = _size = 0;
+}
+
+/**
+ * Unlink the node from the bucket it is in.
+ * @param node A pointer to the node to remove.
+ */
+void PathfindingOpenSet::remove(PathfindingNode *node)
+{
+	if (node->_openPrev)
+		node->_openPrev->_openNext = node->_openNext;
+	else
+		_buckets[node->_openCost] = node->_openNext;
+	if (node->_openNext)
+		node->_openNext->_openPrev = node->_openPrev;
+	node->_inOpenSet = false;
+	--_size;
 }
 
 /**
@@ -54,32 +77,50 @@ void PathfindingOpenSet::removeDiscarded()
 PathfindingNode *PathfindingOpenSet::pop()
 {
 	assert(!empty());
-	PathfindingNode *nd = _queue.top()->_node;
-	delete _queue.top();
-	_queue.pop();
-	nd->_openentry = 0;
-
-	// Discarded entries might be visible now.
-	removeDiscarded();
+	while (!_buckets[_first])
+	{
+		++_first;
+	}
+	PathfindingNode *nd = _buckets[_first];
+	remove(nd);
 	return nd;
 }
 
 /**
  * Place the node in the set.
- * If the node was already in the set, the previous entry is discarded.
+ * If the node was already in the set, it is moved to the bucket of its new cost.
  * It is the caller's responsibility to never re-add a node with a worse cost.
  * @param node A pointer to the node to add.
  */
 void PathfindingOpenSet::push(PathfindingNode *node)
 {
-	OpenSetEntry *entry = new OpenSetEntry;
-	entry->_node = node;
-	entry->_cost = node->getTUCost(false) + node->getTUGuess();
-	if (node->_openentry)
-		node->_openentry->_node = 0;
-	node->_openentry = entry;
-	_queue.push(entry);
+	if (node->_inOpenSet)
+		remove(node);
+	unsigned int cost = node->getTUCost(false) + node->getTUGuess();
+	if (cost >= _buckets.size())
+	{
+		_buckets.resize(cost + 1, 0);
+	}
+	if (_size == 0)
+	{
+		_first = _last = cost;
+	}
+	else if (cost < _first)
+	{
+		_first = cost;
+	}
+	else if (cost > _last)
+	{
+		_last = cost;
+	}
+	node->_openCost = cost;
+	node->_openPrev = 0;
+	node->_openNext = _buckets[cost];
+	if (node->_openNext)
+		node->_openNext->_openPrev = node;
+	_buckets[cost] = node;
+	node->_inOpenSet = true;
+	++_size;
 }
 
-
 }
@@ -19,57 +19,41 @@
 #ifndef OPENXCOM_PATHFINDINGOPENSET_H
 #define OPENXCOM_PATHFINDINGOPENSET_H
 
-#include <queue>
+#include <vector>
 
 namespace OpenXcom
 {
 
 class PathfindingNode;
 
-struct OpenSetEntry
-{
-	int _cost;
-	PathfindingNode *_node;
-};
-
-/**
- * Helper class to compare entries through pointers.
- */
-class EntryCompare
-{
-public:
- 	/**
-	 * Compare entries @a *a and @a *b.
-         * @param a Pointer to first entry.
-         * @param b Pointer to second entry.
-	 * @return true If entry @a *b must come before @a *a.
-	 */
-	bool operator()(OpenSetEntry *a, OpenSetEntry *b) const
-	{
-		return b->_cost < a->_cost;
-	}
-};
-
 /**
  * A class that holds references to the nodes to be examined in pathfinding.
+ * TU costs are small integers, so the nodes are kept in one bucket per cost.
+ * The buckets are lists linked through the nodes themselves, so adding,
+ * moving and removing nodes never allocates memory.
  */
 class PathfindingOpenSet
 {
 public:
-	/// Cleanup the set and free allocated memory.
+	/// Create an empty set.
+	PathfindingOpenSet();
+	/// Cleanup the set.
 	~PathfindingOpenSet();
 	/// Get the next node to check.
 	PathfindingNode *pop();
 	/// Add a node in the set.
 	void push(PathfindingNode *node);
 	/// Is the set empty?
-	bool empty() const { return _queue.empty(); }
+	bool empty() const { return _size == 0; }
+	/// Remove all nodes from the set.
+	void clear();
 
 private:
-	std::priority_queue<OpenSetEntry*, std::vector<OpenSetEntry*>, EntryCompare> _queue;
+	std::vector<PathfindingNode*> _buckets;
+	unsigned int _first, _last, _size;
 
-	/// Remove reachable discarded entries.
-	void removeDiscarded();
+	/// Unlink a node from its bucket.
+	void remove(PathfindingNode *node);
 };
 
 }
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ReachabilityCache.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleUnit.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up an empty reachability cache.
+ * @param save Pointer to the battle game.
+ */
+ReachabilityCache::ReachabilityCache(SavedBattleGame *save) : _save(save), _changes(0)
+{
+}
+
+/**
+ * Deletes the reachability cache.
+ */
+ReachabilityCache::~ReachabilityCache()
+{
+}
+
+/**
+ * Takes a snapshot of the position and state of all units on the map.
+ * @param placements Receives the placements.
+ */
+void ReachabilityCache::getPlacements(std::vector<UnitPlacement> *placements) const
+{
+	placements->clear();
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		UnitPlacement placement;
+		placement.unit = *i;
+		placement.position = (*i)->getPosition();
+		placement.out = (*i)->isOut();
+		placement.visible = (*i)->getVisible();
+		placements->push_back(placement);
+	}
+}
+
+/**
+ * Gets the cached reachable tiles of a unit, as long as neither
+ * the unit, the other units nor the terrain changed since.
+ * @param unit Pointer to the unit.
+ * @param tuMax The maximum cost of the path to each tile.
+ * @return Pointer to the reachable tiles, or 0 if they have to be worked out again.
+ */
+ReachableTiles *ReachabilityCache::find(BattleUnit *unit, int tuMax)
+{
+	std::map<BattleUnit*, ReachableTiles>::iterator i = _units.find(unit);
+	if (i == _units.end())
+		return 0;
+	ReachableTiles *reachable = &i->second;
+	if (reachable->position != unit->getPosition() || reachable->tuMax != tuMax || reachable->faction != unit->getFaction() || reachable->changesSeen != _changes)
+		return 0;
+	getPlacements(&_placements);
+	if (reachable->placements != _placements)
+		return 0;
+	return reachable;
+}
+
+/**
+ * Gets the entry for the reachable tiles of a unit, set up for
+ * the current situation, for the caller to fill in.
+ * @param unit Pointer to the unit.
+ * @param tuMax The maximum cost of the path to each tile.
+ * @return Pointer to the empty reachable tiles.
+ */
+ReachableTiles *ReachabilityCache::update(BattleUnit *unit, int tuMax)
+{
+	ReachableTiles *reachable = &_units[unit];
+	reachable->position = unit->getPosition();
+	reachable->tuMax = tuMax;
+	reachable->faction = unit->getFaction();
+	reachable->changesSeen = _changes;
+	getPlacements(&reachable->placements);
+	reachable->tiles.clear();
+	reachable->costs.assign(_save->getMapSizeXYZ(), -1);
+	return reachable;
+}
+
+/**
+ * Logs a change of the terrain, which makes all reachable tiles out of date.
+ */
+void ReachabilityCache::tileChanged()
+{
+	++_changes;
+}
+
+/**
+ * Forgets all reachable tiles, eg. at the start of a turn.
+ */
+void ReachabilityCache::clear()
+{
+	_units.clear();
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_REACHABILITYCACHE_H
+#define OPENXCOM_REACHABILITYCACHE_H
+
+#include <map>
+#include <vector>
+#include "Position.h"
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+class BattleUnit;
+
+/**
+ * Where a unit is, as far as getting in the way of other units is concerned.
+ * If none of the units change, the reachable tiles stay the same.
+ */
+struct UnitPlacement
+{
+	BattleUnit *unit;
+	Position position;
+	bool out, visible;
+	bool operator==(const UnitPlacement &other) const
+	{
+		return unit == other.unit && position == other.position && out == other.out && visible == other.visible;
+	}
+};
+
+/**
+ * All the tiles a unit can reach from where it stands, and what it costs to get there.
+ */
+struct ReachableTiles
+{
+	Position position;
+	int tuMax, faction;
+	unsigned int changesSeen;
+	std::vector<UnitPlacement> placements;
+	/// Tile indices in order of cost, the first one is the unit's own.
+	std::vector<int> tiles;
+	/// TU cost for each tile index, -1 if it can't be reached.
+	std::vector<int> costs;
+	/// Gets the TU cost to reach a tile, -1 if it can't be reached.
+	int getTUCost(int index) const { return costs[index]; }
+	/// Checks if a tile can be reached.
+	bool isReachable(int index) const { return costs[index] != -1; }
+};
+
+/**
+ * Keeps the reachable tiles of each unit, so the AI can look up the
+ * cost of many destinations without searching for a path to each of them.
+ * Entries are dropped when the terrain or any unit changes, and at the end of the turn.
+ */
+class ReachabilityCache
+{
+private:
+	SavedBattleGame *_save;
+	std::map<BattleUnit*, ReachableTiles> _units;
+	std::vector<UnitPlacement> _placements;
+	unsigned int _changes;
+	/// Takes a snapshot of where all units are.
+	void getPlacements(std::vector<UnitPlacement> *placements) const;
+public:
+	/// Creates a new reachability cache.
+	ReachabilityCache(SavedBattleGame *save);
+	/// Cleans up the reachability cache.
+	~ReachabilityCache();
+	/// Gets the reachable tiles of a unit, if they are still up to date.
+	ReachableTiles *find(BattleUnit *unit, int tuMax);
+	/// Gets an empty entry for the reachable tiles of a unit.
+	ReachableTiles *update(BattleUnit *unit, int tuMax);
+	/// Logs a terrain change.
+	void tileChanged();
+	/// Forgets everything.
+	void clear();
+};
+
+}
+
+#endif
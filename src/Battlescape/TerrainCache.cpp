@@ -0,0 +1,246 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "TerrainCache.h"
+#include <algorithm>
+#include "../Engine/Surface.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/Tile.h"
+#include "../Ruleset/MapData.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Mixes a value into a chunk key (FNV-1a).
+ * @param key Key so far.
+ * @param value Value to mix in.
+ * @return New key.
+ */
+static inline Uint64 mixKey(Uint64 key, Uint64 value)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		key = (key ^ (value & 0xFF)) * 1099511628211ULL;
+		value >>= 8;
+	}
+	return key;
+}
+
+/**
+ * Sets up an empty terrain cache for a map.
+ * @param save Pointer to the battle game.
+ * @param spriteWidth Width of a tile sprite in pixels.
+ * @param spriteHeight Height of a tile sprite in pixels.
+ */
+TerrainCache::TerrainCache(SavedBattleGame *save, int spriteWidth, int spriteHeight) : _save(save), _levels(save->getMapSizeZ()), _frame(0), _allocated(0)
+{
+	_chunksX = (save->getMapSizeX() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	_chunksY = (save->getMapSizeY() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	// tiles go down-right along x and down-left along y, parts can stick out a whole sprite above the tile
+	_offsetX = (CHUNK_SIZE - 1) * (spriteWidth / 2);
+	_offsetY = spriteHeight;
+	_width = CHUNK_SIZE * spriteWidth;
+	_height = _offsetY + (CHUNK_SIZE - 1) * (spriteWidth / 2) + spriteHeight;
+	_surfaces.resize(_chunksX * _chunksY * _levels, 0);
+	_keys.resize(_surfaces.size(), 0);
+	_used.resize(_surfaces.size(), 0);
+}
+
+/**
+ * Deletes all chunk images.
+ */
+TerrainCache::~TerrainCache()
+{
+	clear();
+}
+
+/**
+ * Gets the size of the side of a chunk.
+ * @return Size in tiles.
+ */
+int TerrainCache::getChunkSize()
+{
+	return CHUNK_SIZE;
+}
+
+/**
+ * Gets the index of a chunk.
+ * @param x X position of the chunk, in chunks.
+ * @param y Y position of the chunk, in chunks.
+ * @param z Level of the chunk.
+ * @return Index of the chunk.
+ */
+int TerrainCache::getChunkIndex(int x, int y, int z) const
+{
+	return (z * _chunksY + y) * _chunksX + x;
+}
+
+/**
+ * Gets the width of a chunk image.
+ * @return Width in pixels.
+ */
+int TerrainCache::getWidth() const
+{
+	return _width;
+}
+
+/**
+ * Gets the height of a chunk image.
+ * @return Height in pixels.
+ */
+int TerrainCache::getHeight() const
+{
+	return _height;
+}
+
+/**
+ * Gets where the first tile of a chunk is drawn in the chunk image.
+ * @return X position in pixels.
+ */
+int TerrainCache::getOffsetX() const
+{
+	return _offsetX;
+}
+
+/**
+ * Gets where the first tile of a chunk is drawn in the chunk image.
+ * @return Y position in pixels.
+ */
+int TerrainCache::getOffsetY() const
+{
+	return _offsetY;
+}
+
+/**
+ * Adds everything the static terrain of a tile is drawn from to a chunk key.
+ * @param key Key so far.
+ * @param tile Pointer to the tile.
+ * @return New key.
+ */
+Uint64 TerrainCache::addToKey(Uint64 key, Tile *tile) const
+{
+	for (int part = 0; part < 4; ++part)
+	{
+		key = mixKey(key, (Uint64)(size_t)tile->getMapData(part));
+		key = mixKey(key, (Uint64)(size_t)tile->getSprite(part));
+	}
+	key = mixKey(key, ((Uint64)(Uint32)tile->getShade() << 32) | (Uint32)tile->getMarkerColor());
+	key = mixKey(key, ((Uint64)(Uint32)tile->getTopItemSprite() << 32) | (Uint32)tile->getTerrainLevel());
+	key = mixKey(key, (tile->isDiscovered(0) ? 1 : 0) | (tile->isDiscovered(1) ? 2 : 0) | (tile->isDiscovered(2) ? 4 : 0));
+	return key;
+}
+
+/**
+ * Gets the key of a chunk, made from the looks of all its tiles.
+ * @param x X position of the chunk, in chunks.
+ * @param y Y position of the chunk, in chunks.
+ * @param z Level of the chunk.
+ * @return Key of the chunk.
+ */
+Uint64 TerrainCache::getKey(int x, int y, int z) const
+{
+	Uint64 key = 14695981039346656037ULL;
+	int endX = std::min((x + 1) * CHUNK_SIZE, _save->getMapSizeX());
+	int endY = std::min((y + 1) * CHUNK_SIZE, _save->getMapSizeY());
+	for (int tileX = x * CHUNK_SIZE; tileX < endX; ++tileX)
+	{
+		for (int tileY = y * CHUNK_SIZE; tileY < endY; ++tileY)
+		{
+			key = addToKey(key, _save->getTile(Position(tileX, tileY, z)));
+		}
+	}
+	return key;
+}
+
+/**
+ * Gets the image of a chunk. If it was drawn for another key, or not at all,
+ * it needs to be drawn again; images are cleared beforehand.
+ * @param index Index of the chunk.
+ * @param key Key made from the looks of all tiles in the chunk.
+ * @param valid Receives whether the image is up to date.
+ * @return Pointer to the chunk image.
+ */
+Surface *TerrainCache::getChunk(int index, Uint64 key, bool *valid)
+{
+	_used[index] = _frame;
+	if (_surfaces[index] == 0)
+	{
+		if (_allocated >= MAX_CHUNKS)
+		{
+			evict();
+		}
+		_surfaces[index] = new Surface(_width, _height);
+		_allocated++;
+		*valid = false;
+	}
+	else
+	{
+		*valid = _keys[index] == key;
+		if (!*valid)
+		{
+			_surfaces[index]->clear();
+		}
+	}
+	_keys[index] = key;
+	return _surfaces[index];
+}
+
+/**
+ * Drops the chunk image that was used the longest time ago.
+ */
+void TerrainCache::evict()
+{
+	int oldest = -1;
+	for (size_t i = 0; i < _surfaces.size(); ++i)
+	{
+		if (_surfaces[i] && (oldest == -1 || _used[i] < _used[oldest]))
+		{
+			oldest = i;
+		}
+	}
+	if (oldest != -1)
+	{
+		delete _surfaces[oldest];
+		_surfaces[oldest] = 0;
+		_allocated--;
+	}
+}
+
+/**
+ * Starts a new frame, to tell apart the chunk images that were used recently.
+ */
+void TerrainCache::nextFrame()
+{
+	_frame++;
+}
+
+/**
+ * Drops all chunk images.
+ */
+void TerrainCache::clear()
+{
+	for (std::vector<Surface*>::iterator i = _surfaces.begin(); i != _surfaces.end(); ++i)
+	{
+		delete *i;
+		*i = 0;
+	}
+	_allocated = 0;
+}
+
+}
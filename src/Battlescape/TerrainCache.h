@@ -0,0 +1,81 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_TERRAINCACHE_H
+#define OPENXCOM_TERRAINCACHE_H
+
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+class Surface;
+class Tile;
+class SavedBattleGame;
+
+/**
+ * Keeps pre-drawn images of the static terrain of the battlescape,
+ * in square chunks of tiles per level. A chunk is identified by a key
+ * made from the looks of all its tiles, so it is drawn again as soon as
+ * a tile is destroyed, a door opens, the light changes or a tile is discovered.
+ * Only a limited number of chunk images is kept, the ones used the longest
+ * time ago are dropped first.
+ */
+class TerrainCache
+{
+private:
+	static const int CHUNK_SIZE = 8;
+	static const int MAX_CHUNKS = 128;
+	SavedBattleGame *_save;
+	int _chunksX, _chunksY, _levels, _width, _height, _offsetX, _offsetY, _frame, _allocated;
+	std::vector<Surface*> _surfaces;
+	std::vector<Uint64> _keys;
+	std::vector<int> _used;
+	Uint64 addToKey(Uint64 key, Tile *tile) const;
+	void evict();
+public:
+	/// Creates a new terrain cache.
+	TerrainCache(SavedBattleGame *save, int spriteWidth, int spriteHeight);
+	/// Cleans up the terrain cache.
+	~TerrainCache();
+	/// Gets the size of a chunk in tiles.
+	static int getChunkSize();
+	/// Gets the index of a chunk.
+	int getChunkIndex(int x, int y, int z) const;
+	/// Gets the width of a chunk image.
+	int getWidth() const;
+	/// Gets the height of a chunk image.
+	int getHeight() const;
+	/// Gets the horizontal position of the first tile in a chunk image.
+	int getOffsetX() const;
+	/// Gets the vertical position of the first tile in a chunk image.
+	int getOffsetY() const;
+	/// Gets the key of a chunk.
+	Uint64 getKey(int x, int y, int z) const;
+	/// Gets the image of a chunk.
+	Surface *getChunk(int index, Uint64 key, bool *valid);
+	/// Starts a new frame.
+	void nextFrame();
+	/// Drops all chunk images.
+	void clear();
+};
+
+}
+
+#endif
@@ -19,9 +19,11 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 #include <climits>
-#include <set>
+#include <algorithm>
 #include <functional>
 #include "TileEngine.h"
+#include "VisibilityCache.h"
+#include "LightLayer.h"
 #include <SDL.h>
 #include "BattleAIState.h"
 #include "AggroBAIState.h"
@@ -41,8 +43,10 @@
 #include "../Resource/ResourcePack.h"
 #include "Pathfinding.h"
 #include "../Engine/Options.h"
+#include "../Engine/ThreadPool.h"
 #include "ProjectileFlyBState.h"
 #include "../Engine/Logger.h"
+#include "../Engine/Profiler.h"
 #include "../aresame.h"
 
 namespace OpenXcom
@@ -54,8 +58,14 @@ const int TileEngine::heightFromCenter[11] = {0,-2,+2,-4,+4,-6,+6,-8,+8,-12,+12}
  * Sets up a TileEngine.
  * @param save pointer to SavedBattleGame object.
  */
-TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true)
+TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true), _discoveryGeneration(0)
 {
+	_shadowcastFOV = Options::getBool("battleShadowcastFOV");
+	_batchExplosions = Options::getBool("battleExplosionBatch");
+	_threadPool = new ThreadPool(Options::getInt("battleAIThreads"));
+	_visibilityCache = new VisibilityCache(save);
+	_terrainLight = new LightLayer(save, 1); // Static lighting layer.
+	_unitLight = new LightLayer(save, 2); // Dynamic lighting layer.
 }
 
 /**
@@ -63,7 +73,10 @@ TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) :
  */
 TileEngine::~TileEngine()
 {
-
+	delete _visibilityCache;
+	delete _terrainLight;
+	delete _unitLight;
+	delete _threadPool;
 }
 
 
@@ -76,8 +89,8 @@ void TileEngine::calculateSunShading()
 
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		_save->getTiles()[i]->resetLight(layer);
-		calculateSunShading(_save->getTiles()[i]);
+		_save->getTile(i)->resetLight(layer);
+		calculateSunShading(_save->getTile(i));
 	}
 }
 
@@ -105,65 +118,57 @@ void TileEngine::calculateSunShading(Tile *tile)
 
 /**
   * Recalculate lighting for the terrain: objects,items,fire.
+  * Only the light of sources that appeared or went away is spread again.
   */
 void TileEngine::calculateTerrainLighting()
 {
-	const int layer = 1; // Static lighting layer.
 	const int fireLightPower = 15; // amount of light a fire generates
 
-	// reset all light to 0 first
+	std::vector<LightSource> sources;
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
+		Tile *tile = _save->getTile(i);
+		const Position &pos = tile->getPosition();
 
-	// add lighting of terrain
-	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
-	{
 		// only floors and objects can light up
-		if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR)
-			&& _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource())
+		if (tile->getMapData(MapData::O_FLOOR)
+			&& tile->getMapData(MapData::O_FLOOR)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource(), layer);
+			sources.push_back(LightSource(pos.x, pos.y, tile->getMapData(MapData::O_FLOOR)->getLightSource()));
 		}
-		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT)
-			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource())
+		if (tile->getMapData(MapData::O_OBJECT)
+			&& tile->getMapData(MapData::O_OBJECT)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource(), layer);
+			sources.push_back(LightSource(pos.x, pos.y, tile->getMapData(MapData::O_OBJECT)->getLightSource()));
 		}
 
 		// fires
-		if (_save->getTiles()[i]->getFire())
+		if (tile->getFire())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), fireLightPower, layer);
+			sources.push_back(LightSource(pos.x, pos.y, fireLightPower));
 		}
 
-		for (std::vector<BattleItem*>::iterator it = _save->getTiles()[i]->getInventory()->begin(); it != _save->getTiles()[i]->getInventory()->end(); ++it)
+		for (std::vector<BattleItem*>::iterator it = tile->getInventory()->begin(); it != tile->getInventory()->end(); ++it)
 		{
 			if ((*it)->getRules()->getBattleType() == BT_FLARE)
 			{
-				addLight(_save->getTiles()[i]->getPosition(), (*it)->getRules()->getPower(), layer);
+				sources.push_back(LightSource(pos.x, pos.y, (*it)->getRules()->getPower()));
 			}
 		}
-
 	}
 
+	_terrainLight->update(&sources);
 }
 
 /**
   * Recalculate lighting for the units.
+  * Only the light of units that moved is spread again.
   */
 void TileEngine::calculateUnitLighting()
 {
-	const int layer = 2; // Dynamic lighting layer.
 	const int personalLightPower = 15; // amount of light a unit generates
 
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
-	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
-
+	std::vector<LightSource> sources;
 	if (_personalLighting)
 	{
 		// add lighting of soldiers
@@ -171,58 +176,43 @@ void TileEngine::calculateUnitLighting()
 		{
 			if ((*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
 			{
-				addLight((*i)->getPosition(), personalLightPower, layer);
+				sources.push_back(LightSource((*i)->getPosition().x, (*i)->getPosition().y, personalLightPower));
 			}
 		}
 	}
+
+	_unitLight->update(&sources);
 }
 
 /**
- * Adds circular light pattern starting from center and loosing power with distance travelled.
- * @param center
- * @param power
- * @param layer Light is seperated in 3 layers: Ambient, Static and Dynamic.
+ * Forgets the light sources of the terrain and units, so the light is
+ * spread from scratch on the next calculation, eg. when a new map is loaded.
  */
-void TileEngine::addLight(const Position &center, int power, int layer)
+void TileEngine::invalidateLighting()
 {
-	// only loop through the positive quadrant.
-	for (int x = 0; x <= power; ++x)
-	{
-		for (int y = 0; y <= power; ++y)
-		{
-			for (int z = 0; z < _save->getMapSizeZ(); z++)
-			{
-				int distance = int(floor(sqrt(float(x*x + y*y)) + 0.5));
-
-				if (_save->getTile(Position(center.x + x,center.y + y, z)))
-					_save->getTile(Position(center.x + x,center.y + y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y - y, z)))
-					_save->getTile(Position(center.x - x,center.y - y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y + y, z)))
-					_save->getTile(Position(center.x - x,center.y + y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x + x,center.y - y, z)))
-					_save->getTile(Position(center.x + x,center.y - y, z))->addLight(power - distance, layer);
-			}
-		}
-	}
+	_terrainLight->clear();
+	_unitLight->clear();
 }
 
+
 /**
  * Calculates line of sight of a soldier.
+ * The result of the previous calculation is reused where possible: units
+ * are only looked for again when the viewer or a unit near it changed, and
+ * only the lines of sight that went through changed terrain are traced again.
  * @param unit
  * @return true when new aliens spotted
  */
 bool TileEngine::calculateFOV(BattleUnit *unit)
 {
+	ProfileZone zone("TileEngine::calculateFOV");
 	size_t oldNumVisibleUnits = unit->getUnitsSpottedThisTurn().size();
 	Position center = unit->getPosition();
 	Position test;
 	int direction;
 	bool swap;
 	std::vector<Position> _trajectory;
+	std::vector<int> footprint;
 	if (_save->getStrafeSetting() && (unit->getTurretType() > -1)) {
 		direction = unit->getTurretDirection();
 	}
@@ -235,17 +225,66 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 	int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
 	int y1, y2;
 
-	unit->clearVisibleUnits();
-	unit->clearVisibleTiles();
-
 	if (unit->isOut())
+	{
+		unit->clearVisibleUnits();
+		unit->clearVisibleTiles();
+		_visibilityCache->removeViewer(unit);
 		return false;
+	}
 	Position pos = unit->getPosition();
 
 	if ((unit->getHeight() + unit->getFloatHeight() + -_save->getTile(unit->getPosition())->getTerrainLevel()) >= 24 + 4)
 	{
 		++pos.z;
 	}
+
+	ViewerCache *viewer = _visibilityCache->getViewer(unit);
+	Position eye = getSightOriginVoxel(unit);
+	bool moved = !viewer->valid || viewer->position != center || viewer->eye != eye || viewer->direction != direction || viewer->faction != unit->getFaction();
+	std::vector<Sighting> sightings;
+	getSightings(unit, &sightings);
+	bool lookForUnits = moved || sightings != viewer->sightings || _visibilityCache->hasChangesInRange(viewer, MAX_VIEW_DISTANCE + 2);
+	bool discoverTiles = unit->getFaction() == FACTION_PLAYER && (moved || !viewer->discovered
+		|| (_shadowcastFOV && _visibilityCache->hasChangesInRange(viewer, MAX_VIEW_DISTANCE + 2)));
+	int size = unit->getArmor()->getSize();
+
+	if (unit->getFaction() == FACTION_PLAYER && !discoverTiles && !_shadowcastFOV)
+	{
+		// trace again only the lines of sight that went through changed terrain
+		std::vector<int> rays;
+		_visibilityCache->getChangedRays(viewer, &rays);
+		for (std::vector<int>::const_iterator i = rays.begin(); i != rays.end(); ++i)
+		{
+			int eyeIndex = viewer->rayEyes[*i];
+			_save->getTileCoords(viewer->rayTargets[*i], &test.x, &test.y, &test.z);
+			discoverLine(pos + Position(eyeIndex / size, eyeIndex % size, 0), test, unit, &_trajectory, &footprint);
+			_visibilityCache->replaceRay(viewer, *i, footprint);
+		}
+	}
+	else if (discoverTiles)
+	{
+		_visibilityCache->clearRays(viewer);
+		viewer->discovered = true;
+	}
+
+	viewer->valid = true;
+	viewer->position = center;
+	viewer->eye = eye;
+	viewer->direction = direction;
+	viewer->faction = unit->getFaction();
+	viewer->sightings.swap(sightings);
+	_visibilityCache->acknowledgeChanges(viewer);
+
+	if (!lookForUnits && !discoverTiles)
+		return false;
+
+	if (lookForUnits)
+	{
+		unit->clearVisibleUnits();
+		unit->clearVisibleTiles();
+	}
+
 	for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
 	{
 		if (direction%2)
@@ -271,7 +310,7 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 					if (_save->getTile(test))
 					{
 						BattleUnit *visibleUnit = _save->getTile(test)->getUnit();
-						if (visibleUnit && !visibleUnit->isOut() && visible(unit, _save->getTile(test)))
+						if (lookForUnits && visibleUnit && !visibleUnit->isOut() && visible(unit, _save->getTile(test)))
 						{
 							if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() != FACTION_HOSTILE)
 								|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
@@ -295,34 +334,16 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 							}
 						}
 
-						if (unit->getFaction() == FACTION_PLAYER)
+						if (discoverTiles && !_shadowcastFOV)
 						{
 							// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
 							// large units have "4 pair of eyes"
-							int size = unit->getArmor()->getSize();
 							for (int xo = 0; xo < size; xo++)
 							{
 								for (int yo = 0; yo < size; yo++)
 								{
-									Position poso = pos + Position(xo,yo,0);
-									_trajectory.clear();
-									int tst = calculateLine(poso, test, true, &_trajectory, unit, false);
-									unsigned int tsize = _trajectory.size();
-									if (tst>127) --tsize; //last tile is blocked thus must be cropped
-									for (unsigned int i = 0; i < tsize; i++)
-									{
-										Position posi = _trajectory.at(i); 
-										//mark every tile of line as visible (as in original)
-										//this is needed because of bresenham narrow stroke. 
-										_save->getTile(posi)->setVisible(+1);
-										_save->getTile(posi)->setDiscovered(true, 2);
-										// walls to the east or south of a visible tile, we see that too
-										Tile* t = _save->getTile(Position(posi.x + 1, posi.y, posi.z));
-										if (t) t->setDiscovered(true, 0);
-										t = _save->getTile(Position(posi.x, posi.y + 1, posi.z));
-										if (t) t->setDiscovered(true, 1);
-									}
-
+									discoverLine(pos + Position(xo,yo,0), test, unit, &_trajectory, &footprint);
+									_visibilityCache->addRay(viewer, _save->getTileIndex(test), xo * size + yo, footprint);
 								}
 							}
 						}
@@ -332,6 +353,54 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 		}
 	}
 
+	if (discoverTiles && _shadowcastFOV)
+	{
+		// one sweep per eye, every tile is checked only once
+		for (int xo = 0; xo < size; xo++)
+		{
+			for (int yo = 0; yo < size; yo++)
+			{
+				Position origin = pos + Position(xo,yo,0);
+				if (!_save->getTile(origin))
+					continue;
+				// the stamps keep the generation in their upper 31 bits
+				if (++_discoveryGeneration == 0x80000000u)
+				{
+					_discoveryStamps.clear();
+					_discoveryGeneration = 1;
+				}
+				for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
+				{
+					if (direction%2)
+					{
+						y1 = 0;
+						y2 = MAX_VIEW_DISTANCE;
+					}
+					else
+					{
+						y1 = -x;
+						y2 = x;
+					}
+					for (int y = y1; y <= y2; ++y)
+					{
+						if (x*x + y*y > MAX_VIEW_DISTANCE*MAX_VIEW_DISTANCE)
+							continue;
+						test.x = center.x + signX[direction]*(swap?y:x);
+						test.y = center.y + signY[direction]*(swap?x:y);
+						for (int z = 0; z < _save->getMapSizeZ(); z++)
+						{
+							test.z = z;
+							if (_save->getTile(test))
+							{
+								discoverTile(origin, test);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
 	// we only react when there are at least the same amount of visible units as before AND the checksum is different
 	// this way we stop if there are the same amount of visible units, but a different unit is seen
 	// or we stop if there are more visible units seen
@@ -357,106 +426,389 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 
 }
 
-
-
 /**
- * @brief Find all the soldiers that would see queryingUnit at tile (aka tilePos) and collect some statistics for AI.
- * @param tile the tile to check
- * @param tilePos the position of the tile to check, redundantly
- * @param queryingUnit the unit to temporarily place at tilePos for calculations
- * @return false if the unit couldn't possibly be placed at tile (i.e., something's blocking it), true otherwise
+ * Traces a line of sight in tilespace and marks the tiles along it as discovered.
+ * @param origin Tile the line starts from.
+ * @param target Tile the line goes to.
+ * @param unit The viewer.
+ * @param trajectory Scratch vector for the traced line.
+ * @param footprint Receives the tile indices of all tiles the line went through, including the one that blocked it.
  */
-bool TileEngine::surveyXComThreatToTile(Tile *tile, Position &tilePos, BattleUnit *queryingUnit)
+void TileEngine::discoverLine(const Position &origin, const Position &target, BattleUnit *unit, std::vector<Position> *trajectory, std::vector<int> *footprint)
 {
-	if (tile->soldiersVisible != -1) return true; // already calculated this turn
+	trajectory->clear();
+	footprint->clear();
+	int tst = calculateLine(origin, target, true, trajectory, unit, false);
+	unsigned int tsize = trajectory->size();
+	for (unsigned int i = 0; i < tsize; i++)
+	{
+		if (_save->getTile(trajectory->at(i)))
+			footprint->push_back(_save->getTileIndex(trajectory->at(i)));
+	}
+	if (tst>127) --tsize; //last tile is blocked thus must be cropped
+	for (unsigned int i = 0; i < tsize; i++)
+	{
+		Position posi = trajectory->at(i); 
+		//mark every tile of line as visible (as in original)
+		//this is needed because of bresenham narrow stroke. 
+		_save->getTile(posi)->setVisible(+1);
+		_save->getTile(posi)->setDiscovered(true, 2);
+		// walls to the east or south of a visible tile, we see that too
+		Tile* t = _save->getTile(Position(posi.x + 1, posi.y, posi.z));
+		if (t) t->setDiscovered(true, 0);
+		t = _save->getTile(Position(posi.x, posi.y + 1, posi.z));
+		if (t) t->setDiscovered(true, 1);
+	}
+}
 
-	BattleUnit hypotheticalUnit(*queryingUnit); // this is why I needed a copy constructor for BattleUnit
-	// I tried repeatedly to just move queryingUnit without making a copy of it but that caused mysterious crashes in loftemps calculations for 2x2 units. :<
-	
-	if (!_save->setUnitPosition(&hypotheticalUnit, tilePos, true)) 
+/**
+ * Shadowcasting tile discovery: a tile is visible when the tile before it on the
+ * tilespace line from the eye is visible and the step in between is not blocked.
+ * Each tile is only checked once per eye, the result is remembered for the tiles behind it.
+ * Visible tiles are marked right away, with the same rules as discoverLine().
+ * @param origin Tile of the eye.
+ * @param target Tile to check.
+ * @return True if the tile is visible.
+ */
+bool TileEngine::discoverTile(const Position &origin, const Position &target)
+{
+	int index = _save->getTileIndex(target);
+	if ((int)_discoveryStamps.size() != _save->getMapSizeXYZ())
 	{
-		return false;
+		_discoveryStamps.assign(_save->getMapSizeXYZ(), 0);
 	}
-	
-	std::map<int, BattleUnit*> originalTileUnits;
-	std::vector<Position> toBackUp;
-	
-	toBackUp.push_back(hypotheticalUnit.getPosition());
-	toBackUp.push_back(hypotheticalUnit.getTile()->getPosition()); // no such thing as too many backups??? .__.
-	toBackUp.push_back(hypotheticalUnit.getLastPosition());
-	toBackUp.push_back(tilePos);
-	
-	// back up the BattleUnit pointers from the live tile data
-	for (std::vector<Position>::iterator which = toBackUp.begin(); which != toBackUp.end(); ++which)
+	if (_discoveryStamps[index] >> 1 == _discoveryGeneration)
 	{
-		for (int x = hypotheticalUnit.getArmor()->getSize()-1; x >= 0; x--)
+		return (_discoveryStamps[index] & 1) != 0;
+	}
+
+	bool seen = true;
+	if (target != origin)
+	{
+		// find the previous point of the line, the same way calculateLine() steps through it
+		int x0 = origin.x, x1 = target.x;
+		int y0 = origin.y, y1 = target.y;
+		int z0 = origin.z, z1 = target.z;
+		bool swap_xy = abs(y1 - y0) > abs(x1 - x0);
+		if (swap_xy)
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		bool swap_xz = abs(z1 - z0) > abs(x1 - x0);
+		if (swap_xz)
 		{
-			for (int y = hypotheticalUnit.getArmor()->getSize()-1; y >= 0; y--)
+			std::swap(x0, z0);
+			std::swap(x1, z1);
+		}
+		int delta_x = abs(x1 - x0);
+		int delta_y = abs(y1 - y0);
+		int delta_z = abs(z1 - z0);
+		int step = delta_x - 1;
+		int cx = x0 + (x1 > x0 ? step : -step);
+		int cy = y0 + (y1 > y0 ? 1 : -1) * ((step * delta_y - delta_x / 2 + delta_x - 1) / delta_x);
+		int cz = z0 + (z1 > z0 ? 1 : -1) * ((step * delta_z - delta_x / 2 + delta_x - 1) / delta_x);
+		if (swap_xz) std::swap(cx, cz);
+		if (swap_xy) std::swap(cx, cy);
+		Position previous(cx, cy, cz);
+
+		seen = discoverTile(origin, previous)
+			&& horizontalBlockage(_save->getTile(previous), _save->getTile(target), DT_NONE)
+			+ verticalBlockage(_save->getTile(previous), _save->getTile(target), DT_NONE) <= 127;
+	}
+	_discoveryStamps[index] = (_discoveryGeneration << 1) | (seen ? 1 : 0);
+
+	if (seen)
+	{
+		Tile *tile = _save->getTile(target);
+		tile->setVisible(+1);
+		tile->setDiscovered(true, 2);
+		// walls to the east or south of a visible tile, we see that too
+		Tile* t = _save->getTile(Position(target.x + 1, target.y, target.z));
+		if (t) t->setDiscovered(true, 0);
+		t = _save->getTile(Position(target.x, target.y + 1, target.z));
+		if (t) t->setDiscovered(true, 1);
+	}
+	return seen;
+}
+
+/**
+ * Takes a snapshot of all the units around a viewer that matter for what it can see:
+ * the units it might spot, and the units that might be in the way.
+ * @param unit The viewer.
+ * @param sightings Receives the snapshot.
+ */
+void TileEngine::getSightings(BattleUnit *unit, std::vector<Sighting> *sightings)
+{
+	const int range = MAX_VIEW_DISTANCE + 2;
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if (std::abs((*i)->getPosition().x - unit->getPosition().x) > range || std::abs((*i)->getPosition().y - unit->getPosition().y) > range)
+			continue;
+		Sighting sighting;
+		sighting.unit = *i;
+		sighting.position = (*i)->getPosition();
+		sighting.direction = (*i)->getDirection();
+		sighting.height = (*i)->getHeight() + (*i)->getFloatHeight();
+		sighting.status = (*i)->getStatus();
+		sighting.faction = (*i)->getFaction();
+		sighting.darkness = 0;
+		int size = (*i)->getArmor()->getSize();
+		for (int x = 0; x < size; ++x)
+		{
+			for (int y = 0; y < size; ++y)
 			{
-				Position pos = *which;
-				pos.x += x;
-				pos.y += y;
-				
-				Tile *tileToSave = _save->getTile(pos);
-				if (!tileToSave) continue; // out of map bounds?
-				
-				int index = _save->getTileIndex(pos);				
-				originalTileUnits[index] = tileToSave->getUnit();
+				Tile *tile = _save->getTile(sighting.position + Position(x, y, 0));
+				if (tile && tile->getShade() > MAX_DARKNESS_TO_SEE_UNITS)
+					sighting.darkness |= 1 << (x * size + y);
 			}
 		}
+		sightings->push_back(sighting);
 	}
+}
 
+/**
+ * Marks a tile as changed, so the fields of view looking through it
+ * and the costs of the steps around it are recalculated.
+ * @param position Position of the changed tile.
+ */
+void TileEngine::tileChanged(const Position &position)
+{
+	_visibilityCache->tileChanged(position);
+	_save->getPathfinding()->tileChanged(position);
+	if (!_tilePlanes.empty())
+	{
+		// a detonation also destroys the walls and roof the tile shares with its neighbours
+		updateVoxelPlane(position);
+		updateVoxelPlane(position + Position(1, 0, 0));
+		updateVoxelPlane(position + Position(0, 1, 0));
+		updateVoxelPlane(position + Position(0, 0, 1));
+	}
+}
 
-#if 0
-	// this block of code would make sure that the unit in question wouldn't occlude its own LOS checks
-	// since the LOS checks happen from soldiers to the hypothetical unit, this is possible, I think
-	// however, this code also causes the game to crash in other parts of the code for mysterious reasons
-	for (int x = hypotheticalUnit.getArmor()->getSize()-1; x >= 0; x--)
+/**
+ * Drops all cached fields of view, so they are fully recalculated.
+ */
+void TileEngine::invalidateFOV()
+{
+	_visibilityCache->clear();
+}
+
+/**
+ * Builds the terrain voxels of all tiles, if they aren't yet.
+ */
+void TileEngine::buildVoxelPlanes()
+{
+	if (_tilePlanes.empty())
 	{
-		for (int y = hypotheticalUnit.getArmor()->getSize()-1; y >= 0; y--)
+		_voxelPlanes.resize(12 * 16, 0);
+		_tilePlanes.resize(_save->getMapSizeXYZ(), 0);
+		for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 		{
-			Position pos = hypotheticalUnit.getPosition();
-			pos.x += x;
-			pos.y += y;
-
-			Tile *zeroMe = _save->getTile(pos);
-			assert (!zeroMe || zeroMe->getUnit() == queryingUnit);
-			if (zeroMe) zeroMe->setUnit(0);
+			updateVoxelPlane(_save->getTile(i)->getPosition());
 		}
 	}
-#endif
+}
+
+/**
+ * Drops the terrain voxels of all tiles, so they are rebuilt from the map data, eg. when a new map is loaded.
+ */
+void TileEngine::invalidateVoxels()
+{
+	std::vector<Uint16>().swap(_voxelPlanes);
+	std::vector<int>().swap(_tilePlanes);
+	_planeIndices.clear();
+}
 
-#ifdef _DEBUG
-	// sanity-check the tile data...
-	int count = 0;
-	for (int i = 0; i < _save->getMapSizeX() * _save->getMapSizeY() * _save->getMapSizeZ(); ++i)
+/**
+ * Combines the terrain voxels of all the solid parts of a tile into one plane,
+ * so voxelCheck() only needs a single lookup to tell whether a voxel is empty.
+ * Tiles with the same parts share the same plane; plane 0 is empty.
+ * @param position Position of the tile.
+ */
+void TileEngine::updateVoxelPlane(const Position &position)
+{
+	Tile *tile = _save->getTile(position);
+	if (tile == 0)
+		return;
+	std::vector<MapData*> parts(4, (MapData*)0);
+	bool empty = true;
+	for (int i = 0; i < 4; ++i)
 	{
-		if (_save->getTiles()[i]->getUnit() == queryingUnit)
+		if (!tile->isUfoDoorOpen(i) && tile->getMapData(i))
 		{
-			++count;
+			parts[i] = tile->getMapData(i);
+			empty = false;
 		}
 	}
-	if (count != queryingUnit->getArmor()->getSize()*queryingUnit->getArmor()->getSize())
+	if (empty)
 	{
-		Log(LOG_ERROR) << count << " tiles are occupied by " << queryingUnit->getType() << " #" << queryingUnit->getId() << " and that is messed up.";
+		_tilePlanes[_save->getTileIndex(position)] = 0;
+		return;
 	}
-#endif
-	
-	_save->setUnitPosition(&hypotheticalUnit, tilePos); // updates the unit and the tiles
-	//_save->setUnitPosition(&hypotheticalUnit, tilePos); // reset its lastPosition too
+	std::map<std::vector<MapData*>, int>::iterator i = _planeIndices.find(parts);
+	if (i == _planeIndices.end())
+	{
+		int plane = _voxelPlanes.size() / (12 * 16);
+		_voxelPlanes.resize(_voxelPlanes.size() + 12 * 16, 0);
+		for (int part = 0; part < 4; ++part)
+		{
+			if (parts[part] == 0)
+				continue;
+			for (int layer = 0; layer < 12; ++layer)
+			{
+				for (int y = 0; y < 16; ++y)
+				{
+					_voxelPlanes[(plane * 12 + layer) * 16 + y] |= _voxelData->at(parts[part]->getLoftID(layer) * 16 + y);
+				}
+			}
+		}
+		i = _planeIndices.insert(std::make_pair(parts, plane)).first;
+	}
+	_tilePlanes[_save->getTileIndex(position)] = i->second;
+}
 
-		
-	tile->soldiersVisible = 0; // we're actually not updating the other three tiles of a 2x2 unit because the AI code is going to ignore them anyway for now
-	tile->closestSoldierDSqr = INT_MAX;
-	tile->closestAlienDSqr = INT_MAX;
-	tile->meanSoldierDSqr = INT_MAX;
-	tile->totalExposure = 0;
+namespace
+{
+
+/**
+ * A batch of tiles to survey, shared by all the threads.
+ */
+struct SurveyBatch
+{
+	TileEngine *engine;
+	BattleUnit *unit;
+	const std::vector<Position> *positions;
+	std::vector<ThreatSurvey> *results;
+};
+
+}
+
+/**
+ * Gets the survey of a tile, made since the AI situation was last reset.
+ * @param pos Position of the tile.
+ * @return The survey; soldiersVisible is ThreatSurvey::NOT_CALCULATED if there is none.
+ */
+const ThreatSurvey &TileEngine::getThreatSurvey(const Position &pos)
+{
+	if ((int)_threatSurveys.size() != _save->getMapSizeXYZ())
+	{
+		resetThreatSurveys();
+	}
+	return _threatSurveys[_save->getTileIndex(pos)];
+}
+
+/**
+ * Forgets the surveys of all tiles, eg. at the start of a turn.
+ */
+void TileEngine::resetThreatSurveys()
+{
+	ThreatSurvey survey;
+	survey.soldiersVisible = ThreatSurvey::NOT_CALCULATED; // actual calculations will take place as needed
+	survey.closestSoldierDSqr = ThreatSurvey::NOT_CALCULATED;
+	survey.closestSoldierPos = Position(INT_MAX, INT_MAX, INT_MAX);
+	survey.meanSoldierDSqr = 0;
+	survey.closestAlienDSqr = 0;
+	survey.totalExposure = 0;
+	_threatSurveys.assign(_save->getMapSizeXYZ(), survey);
+}
+
+/**
+ * @brief Find all the soldiers that would see queryingUnit at tile (aka tilePos) and collect some statistics for AI.
+ * The results are kept until the next reset, see getThreatSurvey().
+ * @param tilePos the position of the tile to check
+ * @param queryingUnit the unit to pretend is placed at tilePos for calculations
+ * @return false if the unit couldn't possibly be placed at tile (i.e., something's blocking it), true otherwise
+ */
+bool TileEngine::surveyXComThreatToTile(const Position &tilePos, BattleUnit *queryingUnit)
+{
+	if (!_save->getTile(tilePos)) return false;
+	surveyXComThreat(std::vector<Position>(1, tilePos), queryingUnit);
+	return getThreatSurvey(tilePos).soldiersVisible != ThreatSurvey::NOT_CALCULATED;
+}
+
+/**
+ * Surveys the threat of the soldiers to a number of tiles at once, spread over all threads.
+ * The unit isn't actually placed on the tiles, so the map is only read while surveying,
+ * and every tile gets its own result, so it doesn't matter how many threads there are.
+ * Tiles that were already surveyed or where the unit can't be placed are skipped.
+ * @param positions Positions of the tiles to check.
+ * @param queryingUnit The unit to pretend is placed at the tiles.
+ */
+void TileEngine::surveyXComThreat(const std::vector<Position> &positions, BattleUnit *queryingUnit)
+{
+	if ((int)_threatSurveys.size() != _save->getMapSizeXYZ())
+	{
+		resetThreatSurveys();
+	}
+
+	BattleUnit hypotheticalUnit(*queryingUnit); // this is why I needed a copy constructor for BattleUnit
+
+	std::vector<Position> todo;
+	std::vector<bool> queued(_save->getMapSizeXYZ(), false);
+	for (std::vector<Position>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+	{
+		if (!_save->getTile(*i)) continue;
+		int index = _save->getTileIndex(*i);
+		if (queued[index] || _threatSurveys[index].soldiersVisible != ThreatSurvey::NOT_CALCULATED) continue; // already calculated this turn
+		if (!_save->setUnitPosition(&hypotheticalUnit, *i, true)) continue;
+		queued[index] = true;
+		todo.push_back(*i);
+	}
+	if (todo.empty()) return;
+
+	// the lines of sight need the terrain voxels, which would otherwise be built on first use
+	buildVoxelPlanes();
+
+	std::vector<ThreatSurvey> results(todo.size());
+	SurveyBatch batch;
+	batch.engine = this;
+	batch.unit = &hypotheticalUnit;
+	batch.positions = &todo;
+	batch.results = &results;
+	_threadPool->run(surveyJob, &batch, todo.size());
+
+	for (size_t i = 0; i < todo.size(); ++i)
+	{
+		_threatSurveys[_save->getTileIndex(todo[i])] = results[i];
+	}
+}
+
+/**
+ * Surveys a single tile of a batch, on one of the threads.
+ * @param context Pointer to the batch.
+ * @param index Index of the tile in the batch.
+ */
+void TileEngine::surveyJob(void *context, int index)
+{
+	SurveyBatch *batch = (SurveyBatch*)context;
+	SurveyPlacement placement;
+	placement.unit = batch->unit;
+	placement.position = batch->positions->at(index);
+	placement.size = batch->unit->getArmor()->getSize();
+	batch->engine->surveyTile(placement, &batch->results->at(index));
+}
+
+/**
+ * Finds all the soldiers that would see a unit placed on a tile. Only reads the map,
+ * so several tiles can be surveyed at the same time.
+ * @param placement Where the unit is pretended to be.
+ * @param survey Receives the statistics.
+ */
+void TileEngine::surveyTile(const SurveyPlacement &placement, ThreatSurvey *survey)
+{
+	const Position &tilePos = placement.position;
+	Tile *tile = _save->getTile(tilePos);
+
+	survey->soldiersVisible = 0; // we're actually not updating the other three tiles of a 2x2 unit because the AI code is going to ignore them anyway for now
+	survey->closestSoldierDSqr = INT_MAX;
+	survey->closestSoldierPos = Position(INT_MAX, INT_MAX, INT_MAX);
+	survey->closestAlienDSqr = INT_MAX;
+	survey->meanSoldierDSqr = INT_MAX;
+	survey->totalExposure = 0;
 	
 	int dsqrTotal = 0;
 	
-	//Position targetVoxel = getSightOriginVoxel(&hypotheticalUnit); // relevant if trying to use calculateLine() which doesn't seem to cooperate anyway!
-	Position targetVoxel(0,0,0);
-	
 	for (std::vector<BattleUnit*>::const_iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
 	{
 		if ((*i)->isOut()) continue;
@@ -468,49 +820,32 @@ bool TileEngine::surveyXComThreatToTile(Tile *tile, Position &tilePos, BattleUni
 		
 		Position originVoxel = getSightOriginVoxel(*i);
 
-		// these three things don't seem to work, probably because I don't know how to call them properly:
-		//if ((*i)->getFaction() == FACTION_PLAYER && visible(*i, tile))
-		//if ((*i)->getFaction() == FACTION_PLAYER && canTargetTile(&originVoxel, tile, MapData::O_FLOOR, &targetVoxel, *i)) 
-		//if ((*i)->getFaction() == FACTION_PLAYER && calculateLine(originVoxel, targetVoxel, false, 0, *i, false) == 4)
-
-		// this works OK but we don't need to try all those rays for this tactical assessment
-		//if ((*i)->getFaction() == FACTION_PLAYER && canTargetUnit(&originVoxel, tile, &targetVoxel, *i))		
 		// this should be the best, a routine that gives us the degree of exposure while economizing raytraces:
 		int exposure;
-		if ((*i)->getFaction() == FACTION_PLAYER && (exposure = checkVoxelExposure(&originVoxel, tile, *i, &hypotheticalUnit)))
+		if ((*i)->getFaction() == FACTION_PLAYER && (exposure = checkVoxelExposure(&originVoxel, tile, *i, placement.unit, &placement)))
 		{
-			++tile->soldiersVisible;
-			tile->totalExposure += exposure;
+			++survey->soldiersVisible;
+			survey->totalExposure += exposure;
 
-			if (dsqr < tile->closestSoldierDSqr)
+			if (dsqr < survey->closestSoldierDSqr)
 			{
-				tile->closestSoldierDSqr = dsqr;
-				tile->closestSoldierPos = (*i)->getPosition();
+				survey->closestSoldierDSqr = dsqr;
+				survey->closestSoldierPos = (*i)->getPosition();
 			}
 			
 			dsqrTotal += dsqr;
 		}
 
-		if ((*i)->getFaction() == FACTION_HOSTILE && dsqr < tile->closestAlienDSqr) tile->closestAlienDSqr = dsqr;
+		if ((*i)->getFaction() == FACTION_HOSTILE && dsqr < survey->closestAlienDSqr) survey->closestAlienDSqr = dsqr;
 	}
 	
-	tile->meanSoldierDSqr = tile->soldiersVisible ? (dsqrTotal / tile->soldiersVisible) : 0;
+	survey->meanSoldierDSqr = survey->soldiersVisible ? (dsqrTotal / survey->soldiersVisible) : 0;
 	
-	//if (tile->_soldiersVisible == 0 && tile->getVisible()) { Log(LOG_WARNING) << "Visible tile returned !canTargetTile() for all soldiers."; }
-
-	// restore tile data
-	for (std::map<int,BattleUnit*>::iterator i = originalTileUnits.begin(); i != originalTileUnits.end(); ++i)
+	if (survey->soldiersVisible == 0)
 	{
-		_save->getTiles()[i->first]->setUnit(i->second);
+		survey->closestSoldierDSqr = -1; 
+		survey->closestSoldierPos = Position(INT_MAX, INT_MAX, INT_MAX);
 	}
-	
-	if (tile->soldiersVisible == 0)
-	{
-		tile->closestSoldierDSqr = -1; 
-		tile->closestSoldierPos = Position(INT_MAX, INT_MAX, INT_MAX);
-	}
-	
-	return true;
 }
 
 /**
@@ -594,14 +929,15 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
  * @param tile the tile to check for
  * @param excludeUnit is self (not to hit self)
  * @param excludeAllBut [optional] is unit which is the only one to be considered for ray hits
+ * @param placement [optional] a unit to pretend is on the map, for surveys
  * @return degree of exposure (as percent)
  */
-int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit *excludeUnit, BattleUnit *excludeAllBut)
+int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit *excludeUnit, BattleUnit *excludeAllBut, const SurveyPlacement *placement)
 {
 	Position targetVoxel = Position((tile->getPosition().x * 16) + 7, (tile->getPosition().y * 16) + 8, tile->getPosition().z * 24);
 	Position scanVoxel;
 	std::vector<Position> _trajectory;
-	BattleUnit *otherUnit = tile->getUnit();
+	BattleUnit *otherUnit = (placement && placement->covers(tile->getPosition())) ? placement->unit : tile->getUnit();
 	if (otherUnit == 0) return 0; //no unit in this tile, even if it elevated and appearing in it.
 	if (otherUnit == excludeUnit) return 0; //skip self
 
@@ -649,7 +985,7 @@ int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit
 			scanVoxel.x=targetVoxel.x + sliceTargets[j*2];
 			scanVoxel.y=targetVoxel.y + sliceTargets[j*2+1];
 			_trajectory.clear();
-			int test = calculateLine(*originVoxel, scanVoxel, false, &_trajectory, excludeUnit, true, false, excludeAllBut);
+			int test = calculateLine(*originVoxel, scanVoxel, false, &_trajectory, excludeUnit, true, false, excludeAllBut, placement);
 			if (test == 4)
 			{
 				//voxel of hit must be inside of scanned box
@@ -884,6 +1220,7 @@ bool TileEngine::canTargetTile(Position *originVoxel, Tile *tile, int part, Posi
  */
 void TileEngine::calculateFOV(const Position &position)
 {
+	ProfileZone zone("TileEngine::calculateFOV");
 	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
 	{
 		if (distance(position, (*i)->getPosition()) < 20 && (*i)->getFaction() == _save->getSide())
@@ -1015,6 +1352,7 @@ BattleUnit *TileEngine::hit(const Position &center, int power, ItemDamageType ty
 		int rndPower = RNG::generate(power/4, (power*3)/4); //RNG::boxMuller(power, power/6)
 		if (tile->damage(part, rndPower))
 			_save->setObjectiveDestroyed(true);
+		tileChanged(tile->getPosition());
 	}
 	else if (part == 4)
 	{
@@ -1074,6 +1412,129 @@ BattleUnit *TileEngine::hit(const Position &center, int power, ItemDamageType ty
 	return bu;
 }
 
+/**
+ * Gets the directions of the rays an explosion is traced with: every 5 degrees of
+ * elevation and every 3 degrees around, which makes sure we cover all tiles in a circle.
+ * The table is built once, the rays are in the order they are traced.
+ * @return The ray directions.
+ */
+const std::vector<ExplosionRay> &TileEngine::getExplosionRays()
+{
+	if (_explosionRays.empty())
+	{
+		for (int fi = -90; fi <= 90; fi += 5)
+		{
+			for (int te = 0; te <= 360; te += 3)
+			{
+				ExplosionRay ray;
+				ray.cos_te = cos(te * M_PI / 180.0);
+				ray.sin_te = sin(te * M_PI / 180.0);
+				ray.sin_fi = sin(fi * M_PI / 180.0);
+				ray.cos_fi = cos(fi * M_PI / 180.0);
+				_explosionRays.push_back(ray);
+			}
+		}
+	}
+	return _explosionRays;
+}
+
+/**
+ * Applies the effects of an explosion to a tile the first time a ray reaches it.
+ * @param dest The tile.
+ * @param power Power of the explosion left at the tile.
+ * @param type The damage type of the explosion.
+ * @param unit The unit that caused the explosion.
+ */
+void TileEngine::explodeTile(Tile *dest, int power, ItemDamageType type, BattleUnit *unit)
+{
+	if (type == DT_STUN)
+	{
+		// power 50 - 150%
+		if (dest->getUnit())
+		{
+			dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power/2.0, power*1.5)), type);
+		}
+		for (std::vector<BattleItem*>::iterator it = dest->getInventory()->begin(); it != dest->getInventory()->end(); ++it)
+		{
+			if ((*it)->getUnit())
+			{
+				(*it)->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power/2.0, power*1.5)), type);
+			}
+		}
+	}
+	if (type == DT_HE)
+	{
+		// power 50 - 150%
+		if (dest->getUnit())
+		{
+			dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power/2.0, power*1.5)), type);
+		}
+		bool done = false;
+		while (!done)
+		{
+			done = dest->getInventory()->size() == 0;
+			for (std::vector<BattleItem*>::iterator it = dest->getInventory()->begin(); it != dest->getInventory()->end(); )
+			{
+				if (power > (*it)->getRules()->getArmor())
+				{
+					if ((*it)->getUnit() && (*it)->getUnit()->getStatus() == STATUS_UNCONSCIOUS)
+						(*it)->getUnit()->instaKill();
+					_save->removeItem((*it));
+					break;
+				}
+				else
+				{
+					++it;
+					done = it == dest->getInventory()->end();
+				}
+			}
+		}
+	}
+
+	if (type == DT_SMOKE)
+	{
+		// smoke from explosions always stay 6 to 14 turns - power of a smoke grenade is 60
+		if (dest->getSmoke() < 10)
+		{
+			dest->addSmoke(RNG::generate(power/10, 14));
+		}
+	}
+
+	if (type == DT_IN && !dest->isVoid())
+	{
+		if (dest->getFire() == 0)
+		{
+			dest->ignite();
+		}
+		if (dest->getUnit())
+		{
+			dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(0, power/3), type); // immediate IN damage
+			dest->getUnit()->setFire(RNG::generate(1, 5)); // catch fire and burn for 1-5 rounds
+		}
+	}
+
+	if (unit && dest->getUnit() && dest->getUnit()->getFaction() != unit->getFaction())
+	{
+		unit->addFiringExp();
+	}
+}
+
+/**
+ * Marks a tile reached by an explosion ray.
+ * @param dest The tile.
+ * @param affected Receives the tile if no ray reached it before.
+ * @return True if no ray reached it before.
+ */
+bool TileEngine::visitExplosionTile(Tile *dest, std::vector<Tile*> *affected)
+{
+	int index = _save->getTileIndex(dest->getPosition());
+	if (_explosionVisited[index])
+		return false;
+	_explosionVisited[index] = true;
+	affected->push_back(dest);
+	return true;
+}
+
 /**
  * HE, smoke and fire explodes in a circular pattern on 1 level only. HE however damages floor tiles of the above level. Not the units on it.
  * HE destroys an object if its armor is lower than the explosive power, then it's HE blockage is applied for further propagation.
@@ -1090,8 +1551,7 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 	double centerX = (int)(center.x / 16) + 0.5;
 	double centerY = (int)(center.y / 16) + 0.5;
 	int power_;
-	std::set<Tile*> tilesAffected;
-	std::pair<std::set<Tile*>::iterator,bool> ret;
+	std::vector<Tile*> tilesAffected;
 
 	if (type == DT_IN)
 	{
@@ -1114,152 +1574,187 @@ void TileEngine::explode(const Position &center, int power, ItemDamageType type,
 		vertdec = 5;
 	}
 
+	const std::vector<ExplosionRay> &rays = getExplosionRays();
+	if ((int)_explosionVisited.size() != _save->getMapSizeXYZ())
+	{
+		_explosionVisited.assign(_save->getMapSizeXYZ(), false);
+	}
 
-	for (int fi = -90; fi <= 90; fi += 5)
-//	for (int fi = 0; fi <= 0; fi += 10)
+	if (_batchExplosions)
 	{
-		// raytrace every 3 degrees makes sure we cover all tiles in a circle.
-		for (int te = 0; te <= 360; te += 3)
-		{
-			double cos_te = cos(te * M_PI / 180.0);
-			double sin_te = sin(te * M_PI / 180.0);
-			double sin_fi = sin(fi * M_PI / 180.0);
-			double cos_fi = cos(fi * M_PI / 180.0);
+		explodeBatches(centerX, centerY, centerZ, power, type, maxRadius, vertdec, unit, &tilesAffected);
+	}
+	else for (std::vector<ExplosionRay>::const_iterator ray = rays.begin(); ray != rays.end(); ++ray)
+	{
+		const double cos_te = ray->cos_te;
+		const double sin_te = ray->sin_te;
+		const double sin_fi = ray->sin_fi;
+		const double cos_fi = ray->cos_fi;
 
-			Tile *origin = _save->getTile(Position(centerX, centerY, centerZ));
-			double l = 0;
-			double vx, vy, vz;
-			int tileX, tileY, tileZ;
-			power_ = power + 1;
+		Tile *origin = _save->getTile(Position(centerX, centerY, centerZ));
+		double l = 0;
+		double vx, vy, vz;
+		int tileX, tileY, tileZ;
+		power_ = power + 1;
 
-			while (power_ > 0 && l <= maxRadius)
-			{
-				vx = centerX + l * sin_te * cos_fi;
-				vy = centerY + l * cos_te * cos_fi;
-				vz = centerZ + l * sin_fi;
+		while (power_ > 0 && l <= maxRadius)
+		{
+			vx = centerX + l * sin_te * cos_fi;
+			vy = centerY + l * cos_te * cos_fi;
+			vz = centerZ + l * sin_fi;
 
-				tileZ = int(floor(vz));
-				tileX = int(floor(vx));
-				tileY = int(floor(vy));
+			tileZ = int(floor(vz));
+			tileX = int(floor(vx));
+			tileY = int(floor(vy));
 
-				Tile *dest = _save->getTile(Position(tileX, tileY, tileZ));
-				if (!dest) break; // out of map!
+			Tile *dest = _save->getTile(Position(tileX, tileY, tileZ));
+			if (!dest) break; // out of map!
 
 
-				// blockage by terrain is deducted from the explosion power
-				if (std::abs(l) > 0) // no need to block epicentrum
+			// blockage by terrain is deducted from the explosion power
+			if (std::abs(l) > 0) // no need to block epicentrum
+			{
+				power_ -= (horizontalBlockage(origin, dest, type) + verticalBlockage(origin, dest, type)) * 2;
+				power_ -= 10; // explosive damage decreases by 10 per tile
+				if (origin->getPosition().z != tileZ) power_ -= vertdec; //3d explosion factor
+			}
+
+			if (power_ > 0)
+			{
+				if (type == DT_HE)
 				{
-					power_ -= (horizontalBlockage(origin, dest, type) + verticalBlockage(origin, dest, type)) * 2;
-					power_ -= 10; // explosive damage decreases by 10 per tile
-					if (origin->getPosition().z != tileZ) power_ -= vertdec; //3d explosion factor
+					// explosives do 1/2 damage to terrain and 1/2 up to 3/2 random damage to units
+					dest->setExplosive(power_ / 2);
 				}
 
-				if (power_ > 0)
+				if (visitExplosionTile(dest, &tilesAffected)) // check if we had this tile already
 				{
-					if (type == DT_HE)
-					{
-						// explosives do 1/2 damage to terrain and 1/2 up to 3/2 random damage to units
-						dest->setExplosive(power_ / 2);
-					}
-
-					ret = tilesAffected.insert(dest); // check if we had this tile already
-					if (ret.second)
-					{
-						if (type == DT_STUN)
-						{
-							// power 50 - 150%
-							if (dest->getUnit())
-							{
-								dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5)), type);
-							}
-							for (std::vector<BattleItem*>::iterator it = dest->getInventory()->begin(); it != dest->getInventory()->end(); ++it)
-							{
-								if ((*it)->getUnit())
-								{
-									(*it)->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5)), type);
-								}
-							}
-						}
-						if (type == DT_HE)
-						{
-							// power 50 - 150%
-							if (dest->getUnit())
-							{
-								dest->getUnit()->damage(Position(0, 0, 0), (int)(RNG::generate(power_/2.0, power_*1.5)), type);
-							}
-							bool done = false;
-							while (!done)
-							{
-								done = dest->getInventory()->size() == 0;
-								for (std::vector<BattleItem*>::iterator it = dest->getInventory()->begin(); it != dest->getInventory()->end(); )
-								{
-									if (power_ > (*it)->getRules()->getArmor())
-									{
-										if ((*it)->getUnit() && (*it)->getUnit()->getStatus() == STATUS_UNCONSCIOUS)
-											(*it)->getUnit()->instaKill();
-										_save->removeItem((*it));
-										break;
-									}
-									else
-									{
-										++it;
-										done = it == dest->getInventory()->end();
-									}
-								}
-							}
-						}
-
-						if (type == DT_SMOKE)
-						{
-							// smoke from explosions always stay 6 to 14 turns - power of a smoke grenade is 60
-							if (dest->getSmoke() < 10)
-							{
-								dest->addSmoke(RNG::generate(power_/10, 14));
-							}
-						}
-
-						if (type == DT_IN && !dest->isVoid())
-						{
-							if (dest->getFire() == 0)
-							{
-								dest->ignite();
-							}
-							if (dest->getUnit())
-							{
-								dest->getUnit()->damage(Position(0, 0, 0), RNG::generate(0, power_/3), type); // immediate IN damage
-								dest->getUnit()->setFire(RNG::generate(1, 5)); // catch fire and burn for 1-5 rounds
-							}
-						}
-
-						if (unit && dest->getUnit() && dest->getUnit()->getFaction() != unit->getFaction())
-						{
-							unit->addFiringExp();
-						}
-
-					}
+					explodeTile(dest, power_, type, unit);
 				}
-				origin = dest;
-				l++;
 			}
+			origin = dest;
+			l++;
 		}
 	}
+
+	// the tiles used to be collected in a set of pointers, keep detonating them in that order
+	std::sort(tilesAffected.begin(), tilesAffected.end());
+	for (std::vector<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
+	{
+		_explosionVisited[_save->getTileIndex((*i)->getPosition())] = false;
+	}
+
 	// now detonate the tiles affected with HE
 
 	if (type == DT_HE)
 	{
-		for (std::set<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
+		for (std::vector<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
 		{
 			if (detonate(*i))
 				_save->setObjectiveDestroyed(true);
 			applyItemGravity(*i);
 		}
 	}
+	for (std::vector<Tile*>::iterator i = tilesAffected.begin(); i != tilesAffected.end(); ++i)
+	{
+		tileChanged((*i)->getPosition());
+	}
 
 	calculateSunShading(); // roofs could have been destroyed
 	calculateFOV(center);
 	calculateTerrainLighting(); // fires could have been started
 }
 
+/**
+ * Traces the rays of an explosion in batches of the same elevation, moving all
+ * rays of a batch one tile further at a time. Neighbouring rays mostly cross
+ * the same tiles, so the blockage between them is only looked up once per step.
+ * Tiles are reached in a different order than ray by ray, which gives slightly different results.
+ * @param centerX Center of the explosion in tilespace.
+ * @param centerY Center of the explosion in tilespace.
+ * @param centerZ Center of the explosion in tilespace.
+ * @param power Power of the explosion.
+ * @param type The damage type of the explosion.
+ * @param maxRadius The maximum radius of the explosion.
+ * @param vertdec Power lost when changing level.
+ * @param unit The unit that caused the explosion.
+ * @param tilesAffected Receives the tiles reached by the explosion.
+ */
+void TileEngine::explodeBatches(double centerX, double centerY, double centerZ, int power, ItemDamageType type, int maxRadius, int vertdec, BattleUnit *unit, std::vector<Tile*> *tilesAffected)
+{
+	const std::vector<ExplosionRay> &rays = getExplosionRays();
+	const int batchSize = 121; // rays around, per elevation
+	Tile *center = _save->getTile(Position(centerX, centerY, centerZ));
+	std::vector<int> powers(batchSize);
+	std::vector<Tile*> origins(batchSize);
+	std::vector<int> tileX(batchSize), tileY(batchSize), tileZ(batchSize);
+
+	for (size_t batch = 0; batch + batchSize <= rays.size(); batch += batchSize)
+	{
+		const ExplosionRay *ray = &rays[batch];
+		std::fill(powers.begin(), powers.end(), power + 1);
+		std::fill(origins.begin(), origins.end(), center);
+		int alive = batchSize;
+
+		for (int l = 0; l <= maxRadius && alive > 0; ++l)
+		{
+			// positions of the whole batch at once
+			for (int i = 0; i < batchSize; ++i)
+			{
+				tileX[i] = int(floor(centerX + l * ray[i].sin_te * ray[i].cos_fi));
+				tileY[i] = int(floor(centerY + l * ray[i].cos_te * ray[i].cos_fi));
+				tileZ[i] = int(floor(centerZ + l * ray[i].sin_fi));
+			}
+
+			Tile *lastOrigin = 0, *lastDest = 0;
+			int lastBlock = 0;
+			for (int i = 0; i < batchSize; ++i)
+			{
+				if (powers[i] <= 0)
+					continue;
+
+				Tile *dest = _save->getTile(Position(tileX[i], tileY[i], tileZ[i]));
+				if (!dest) // out of map!
+				{
+					powers[i] = 0;
+					--alive;
+					continue;
+				}
+
+				if (l > 0) // no need to block epicentrum
+				{
+					if (origins[i] != lastOrigin || dest != lastDest)
+					{
+						lastOrigin = origins[i];
+						lastDest = dest;
+						lastBlock = (horizontalBlockage(origins[i], dest, type) + verticalBlockage(origins[i], dest, type)) * 2;
+					}
+					powers[i] -= lastBlock;
+					powers[i] -= 10; // explosive damage decreases by 10 per tile
+					if (origins[i]->getPosition().z != tileZ[i]) powers[i] -= vertdec; //3d explosion factor
+				}
+
+				if (powers[i] > 0)
+				{
+					if (type == DT_HE)
+					{
+						dest->setExplosive(powers[i] / 2);
+					}
+					if (visitExplosionTile(dest, tilesAffected))
+					{
+						explodeTile(dest, powers[i], type, unit);
+					}
+				}
+				else
+				{
+					--alive;
+				}
+				origins[i] = dest;
+			}
+		}
+	}
+}
+
 /**
  * get the height of an object checking it's voxels at 8,8
  * @return int height
@@ -1339,9 +1834,9 @@ Tile *TileEngine::checkForTerrainExplosions()
 
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		if (_save->getTiles()[i]->getExplosive())
+		if (_save->getTile(i)->getExplosive())
 		{
-			return _save->getTiles()[i];
+			return _save->getTile(i);
 		}
 	}
 	return 0;
@@ -1675,6 +2170,7 @@ int TileEngine::unitOpensDoor(BattleUnit *unit, bool rClick)
 					door = tile->openDoor(i->second, unit, _save->getDebugMode());
 					if (door != -1)
 					{
+						tileChanged(tile->getPosition());
 						part = i->second;
 						if (door == 1)
 						{
@@ -1735,6 +2231,7 @@ void TileEngine::checkAdjacentDoors(Position pos, int part)
 		if (tile && tile->getMapData(part) && tile->getMapData(part)->isUFODoor())
 		{
 			tile->openDoor(part);
+			tileChanged(tile->getPosition());
 		}
 		else break;
 	}
@@ -1745,6 +2242,7 @@ void TileEngine::checkAdjacentDoors(Position pos, int part)
 		if (tile && tile->getMapData(part) && tile->getMapData(part)->isUFODoor())
 		{
 			tile->openDoor(part);
+			tileChanged(tile->getPosition());
 		}
 		else break;
 	}
@@ -1761,10 +2259,10 @@ int TileEngine::closeUfoDoors()
 	// prepare a list of tiles on fire/smoke & close any ufo doors
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
-		if (_save->getTiles()[i]->getUnit() && _save->getTiles()[i]->getUnit()->getArmor()->getSize() > 1)
+		if (_save->getTile(i)->getUnit() && _save->getTile(i)->getUnit()->getArmor()->getSize() > 1)
 		{
-			BattleUnit *bu = _save->getTiles()[i]->getUnit();
-			Tile *tile = _save->getTiles()[i];
+			BattleUnit *bu = _save->getTile(i)->getUnit();
+			Tile *tile = _save->getTile(i);
 			Tile *oneTileNorth = _save->getTile(tile->getPosition() + Position(0, -1, 0));
 			Tile *oneTileWest = _save->getTile(tile->getPosition() + Position(-1, 0, 0));
 			if ((tile->isUfoDoorOpen(MapData::O_NORTHWALL) && oneTileNorth && oneTileNorth->getUnit() && oneTileNorth->getUnit() == bu) ||
@@ -1773,7 +2271,11 @@ int TileEngine::closeUfoDoors()
 				continue;
 			}
 		}
-		doorsclosed += _save->getTiles()[i]->closeUfoDoor();
+		if (_save->getTile(i)->closeUfoDoor())
+		{
+			++doorsclosed;
+			tileChanged(_save->getTile(i)->getPosition());
+		}
 	}
 
 	return doorsclosed;
@@ -1788,9 +2290,10 @@ int TileEngine::closeUfoDoors()
  * @param doVoxelCheck Check against voxel or tile blocking? (first one for units visibility and line of fire, second one for terrain visibility)
  * @param onlyVisible skip invisible units? used in FPS view
  * @param excludeAllBut [optional] the only unit to be considered for ray hits
+ * @param placement [optional] a unit to pretend is on the map, for surveys
  * @return the objectnumber(0-3) or unit(4) or out of map (5) or -1(hit nothing)
  */
-int TileEngine::calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck, bool onlyVisible, BattleUnit *excludeAllBut)
+int TileEngine::calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck, bool onlyVisible, BattleUnit *excludeAllBut, const SurveyPlacement *placement)
 {
 	int x, x0, x1, delta_x, step_x;
 	int y, y0, y1, delta_y, step_y;
@@ -1858,7 +2361,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 		//passes through this point?
 		if (doVoxelCheck)
 		{
-			result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible, excludeAllBut);
+			result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible, excludeAllBut, placement);
 			if (result != -1)
 			{
 				if (trajectory)
@@ -1895,7 +2398,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 				cx = x;	cz = z; cy = y;
 				if (swap_xz) std::swap(cx, cz);
 				if (swap_xy) std::swap(cx, cy);
-				result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible, excludeAllBut);
+				result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible, excludeAllBut, placement);
 				if (result != -1)
 				{
 					if (trajectory != 0)
@@ -1919,7 +2422,7 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 				cx = x;	cz = z; cy = y;
 				if (swap_xz) std::swap(cx, cz);
 				if (swap_xy) std::swap(cx, cy);
-				result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible,  excludeAllBut);
+				result = voxelCheck(Position(cx, cy, cz), excludeUnit, false, onlyVisible, excludeAllBut, placement);
 				if (result != -1)
 				{
 					if (trajectory != 0)
@@ -2045,7 +2548,7 @@ bool TileEngine::isVoxelVisible(const Position& voxel)
  * @param excludeAllBut if set, the only unit to be considered for ray hits
  * @return the objectnumber(0-3) or unit(4) or out of map (5) or -1(hit nothing)
  */
-int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits, bool onlyVisible, BattleUnit *excludeAllBut)
+int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits, bool onlyVisible, BattleUnit *excludeAllBut, const SurveyPlacement *placement)
 {
 
 	Tile *tile = _save->getTile(Position(voxel.x/16, voxel.y/16, voxel.z/24));
@@ -2062,39 +2565,46 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 			return 0;
 	}
 
+	buildVoxelPlanes();
+
 	// first we check terrain voxel data, not to allow 2x2 units stick through walls
-	for (int i=0; i< 4; ++i)
+	int plane = _tilePlanes[_save->getTileIndex(tile->getPosition())];
+	if (plane != 0 && (_voxelPlanes[(plane * 12 + (voxel.z%24)/2) * 16 + voxel.y%16] & (1 << (15 - voxel.x%16))))
 	{
-		MapData *mp = tile->getMapData(i);
-		if (tile->isUfoDoorOpen(i))
-			continue;
-		if (mp != 0)
+		// something solid is here, find out which part it is
+		for (int i=0; i< 4; ++i)
 		{
-			int x = 15 - voxel.x%16;
-			int y = voxel.y%16;
-			int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
-			if (_voxelData->at(idx) & (1 << x))
+			MapData *mp = tile->getMapData(i);
+			if (tile->isUfoDoorOpen(i))
+				continue;
+			if (mp != 0)
 			{
-				return i;
+				int x = 15 - voxel.x%16;
+				int y = voxel.y%16;
+				int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
+				if (_voxelData->at(idx) & (1 << x))
+				{
+					return i;
+				}
 			}
 		}
 	}
 
 	if (!excludeAllUnits)
 	{
-		BattleUnit *unit = tile->getUnit();
+		BattleUnit *unit = (placement && placement->covers(tile->getPosition())) ? placement->unit : tile->getUnit();
 		// sometimes there is unit on the tile below, but sticks up to this tile with his head,
 		// in this case we couldn't have unit standing at current tile.
 		if (unit == 0) 
 		{
 			tile = _save->getTile(Position(voxel.x/16, voxel.y/16, (voxel.z/24)-1)); //below
-			if (tile) unit = tile->getUnit();
+			if (tile) unit = (placement && placement->covers(tile->getPosition())) ? placement->unit : tile->getUnit();
 		}
 
 		if (unit != 0 && unit != excludeUnit && (!excludeAllBut || unit == excludeAllBut) && (!onlyVisible || unit->getVisible() ) )
 		{
 			Position tilepos;
-			Position unitpos = unit->getPosition();
+			Position unitpos = (placement && unit == placement->unit) ? placement->position : unit->getPosition();
 			int tz = unitpos.z*24 + unit->getFloatHeight()+(-tile->getTerrainLevel());//bottom
 			if ((voxel.z > tz) && (voxel.z <= tz + unit->getHeight()) )
 			{
@@ -20,6 +20,7 @@
 #define OPENXCOM_TILEENGINE_H
 
 #include <vector>
+#include <map>
 #include "Position.h"
 #include "../Ruleset/MapData.h"
 #include <SDL.h>
@@ -33,6 +34,47 @@ class SavedBattleGame;
 class BattleUnit;
 class BattleItem;
 class Tile;
+class VisibilityCache;
+class LightLayer;
+class ThreadPool;
+struct Sighting;
+
+/**
+ * The direction of a ray an explosion is traced with.
+ */
+struct ExplosionRay
+{
+	double cos_te, sin_te, sin_fi, cos_fi;
+};
+
+/**
+ * What the AI found out by surveying how exposed a tile is to the X-Com soldiers.
+ */
+struct ThreatSurvey
+{
+	static const int NOT_CALCULATED = -1;
+	// how many soldiers are visible from a square and how close is the closest one:
+	int closestSoldierDSqr;
+	Position closestSoldierPos;
+	int meanSoldierDSqr;
+	int soldiersVisible;
+	int closestAlienDSqr;
+	int totalExposure;
+};
+
+/**
+ * A unit pretended to be standing somewhere for a survey, without actually putting it on the tiles.
+ */
+struct SurveyPlacement
+{
+	BattleUnit *unit;
+	Position position;
+	int size;
+	bool covers(const Position &pos) const
+	{
+		return pos.z == position.z && pos.x >= position.x && pos.x < position.x + size && pos.y >= position.y && pos.y < position.y + size;
+	}
+};
 
 /**
  * A utility class that modifies tile properties on a battlescape map. This includes lighting, destruction, smoke, fire, fog of war.
@@ -46,10 +88,33 @@ private:
 	SavedBattleGame *_save;
 	std::vector<Uint16> *_voxelData;
 	static const int heightFromCenter[11];
-	void addLight(const Position &center, int power, int layer);
 	int blockage(Tile *tile, const int part, ItemDamageType type);
 	int vectorToDirection(const Position &vector);
 	bool _personalLighting;
+	VisibilityCache *_visibilityCache;
+	LightLayer *_terrainLight, *_unitLight;
+	bool _shadowcastFOV;
+	std::vector<unsigned int> _discoveryStamps;
+	unsigned int _discoveryGeneration;
+	void discoverLine(const Position &origin, const Position &target, BattleUnit *unit, std::vector<Position> *trajectory, std::vector<int> *footprint);
+	bool discoverTile(const Position &origin, const Position &target);
+	void getSightings(BattleUnit *unit, std::vector<Sighting> *sightings);
+	std::vector<Uint16> _voxelPlanes;
+	std::vector<int> _tilePlanes;
+	std::map<std::vector<MapData*>, int> _planeIndices;
+	void updateVoxelPlane(const Position &position);
+	bool _batchExplosions;
+	std::vector<ExplosionRay> _explosionRays;
+	std::vector<bool> _explosionVisited;
+	ThreadPool *_threadPool;
+	std::vector<ThreatSurvey> _threatSurveys;
+	static void surveyJob(void *context, int index);
+	void surveyTile(const SurveyPlacement &placement, ThreatSurvey *survey);
+	void buildVoxelPlanes();
+	const std::vector<ExplosionRay> &getExplosionRays();
+	bool visitExplosionTile(Tile *dest, std::vector<Tile*> *affected);
+	void explodeTile(Tile *dest, int power, ItemDamageType type, BattleUnit *unit);
+	void explodeBatches(double centerX, double centerY, double centerZ, int power, ItemDamageType type, int maxRadius, int vertdec, BattleUnit *unit, std::vector<Tile*> *tilesAffected);
 public:
 	/// Creates a new TileEngine class.
 	TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData);
@@ -63,12 +128,20 @@ public:
 	bool calculateFOV(BattleUnit *unit);
 	/// Calculate the field of view within range of a certain position.
 	void calculateFOV(const Position &position);
+	/// Mark a tile as changed for the cached fields of view and step costs.
+	void tileChanged(const Position &position);
+	/// Drop all the cached fields of view.
+	void invalidateFOV();
+	/// Drop the terrain voxels of all tiles.
+	void invalidateVoxels();
 	/// Check reaction fire.
 	bool checkReactionFire(BattleUnit *unit, BattleAction *action, BattleUnit *potentialVictim = 0, bool recalculateFOV = true);
 	/// Recalculate lighting of the battlescape.
 	void calculateTerrainLighting();
 	/// Recalculate lighting of the battlescape.
 	void calculateUnitLighting();
+	/// Forget the light sources of the battlescape.
+	void invalidateLighting();
 	/// Explosions.
 	BattleUnit *hit(const Position &center, int power, ItemDamageType type, BattleUnit *unit);
 	void explode(const Position &center, int power, ItemDamageType type, int maxRadius, BattleUnit *unit = 0);
@@ -79,11 +152,17 @@ public:
 	/// Close ufo doors.
 	int closeUfoDoors();
 	/// Calculate line.
-	int calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck = true, bool onlyVisible = false, BattleUnit *excludeAllBut = 0);
+	int calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck = true, bool onlyVisible = false, BattleUnit *excludeAllBut = 0, const SurveyPlacement *placement = 0);
 	/// Calculate a parabola trajectory.
 	int calculateParabola(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, double curvature, double accuracy);
 	/// Find all the soldiers that would see queryingUnit at tile (aka tilePos) and collect some statistics for AI.
-	bool surveyXComThreatToTile(Tile *tile, Position &tilePos, BattleUnit *hypotheticalUnit);	
+	bool surveyXComThreatToTile(const Position &tilePos, BattleUnit *queryingUnit);
+	/// Find the soldiers that would see queryingUnit for a number of tiles at once.
+	void surveyXComThreat(const std::vector<Position> &positions, BattleUnit *queryingUnit);
+	/// Get the statistics of a tile surveyed for AI.
+	const ThreatSurvey &getThreatSurvey(const Position &pos);
+	/// Forget the statistics of all tiles surveyed for AI.
+	void resetThreatSurveys();
 	/// Get the origin voxel of a unit's eyesight
 	Position getSightOriginVoxel(BattleUnit *currentUnit);
 	/// Check visibility of a unit on this tile
@@ -111,7 +190,7 @@ public:
 	/// get the ai to look through a window
 	int faceWindow(const Position &position);
 	/// get the exposure % of a unit on a tile
-	int checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit *excludeUnit, BattleUnit *excludeAllBut);
+	int checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit *excludeUnit, BattleUnit *excludeAllBut, const SurveyPlacement *placement = 0);
 	/// check validity for targetting a unit
 	bool canTargetUnit(Position *originVoxel, Tile *tile, Position *scanVoxel, BattleUnit *excludeUnit);
 	/// check validity for targetting a tile
@@ -121,7 +200,7 @@ public:
 	/// check the visibility of a given voxel
 	bool isVoxelVisible(const Position& voxel);
 	/// check what type of voxel occupies this space
-	int voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits = false, bool onlyVisible = false, BattleUnit *excludeAllBut = 0);
+	int voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool excludeAllUnits = false, bool onlyVisible = false, BattleUnit *excludeAllBut = 0, const SurveyPlacement *placement = 0);
 	/// get the height of an object checking it's voxels
 	int getVoxelHeight(MapData *mp);
 	/// blow this tile up
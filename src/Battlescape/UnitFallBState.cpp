@@ -173,6 +173,7 @@ void UnitFallBState::think()
 				if ((*unit)->getSpecialAbility() == SPECAB_BURNFLOOR)
 				{
 					(*unit)->getTile()->destroy(MapData::O_FLOOR);
+					_terrain->tileChanged((*unit)->getPosition());
 				}
 				// move our personal lighting with us
 				_terrain->calculateUnitLighting();
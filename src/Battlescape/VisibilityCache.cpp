@@ -0,0 +1,241 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "VisibilityCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include "../Savegame/SavedBattleGame.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up an empty visibility cache.
+ * @param save Pointer to the battle game.
+ */
+VisibilityCache::VisibilityCache(SavedBattleGame *save) : _save(save)
+{
+}
+
+/**
+ * Deletes the visibility cache.
+ */
+VisibilityCache::~VisibilityCache()
+{
+}
+
+/**
+ * Gets the cached field of view of a unit, creating an invalid one if there is none yet.
+ * @param unit Pointer to the unit.
+ * @return Pointer to the cache.
+ */
+ViewerCache *VisibilityCache::getViewer(BattleUnit *unit)
+{
+	std::map<BattleUnit*, ViewerCache>::iterator i = _viewers.find(unit);
+	if (i == _viewers.end())
+	{
+		i = _viewers.insert(std::make_pair(unit, ViewerCache())).first;
+		i->second.valid = false;
+		i->second.discovered = false;
+		i->second.direction = -1;
+		i->second.faction = -1;
+		i->second.changesSeen = _changes.size();
+		i->second.rayGarbage = 0;
+	}
+	return &i->second;
+}
+
+/**
+ * Forgets the cached field of view of a unit, eg. when it is out.
+ * @param unit Pointer to the unit.
+ */
+void VisibilityCache::removeViewer(BattleUnit *unit)
+{
+	_viewers.erase(unit);
+}
+
+/**
+ * Forgets all cached fields of view and logged changes.
+ * Needed whenever things change that aren't tracked, like at the start of a turn.
+ */
+void VisibilityCache::clear()
+{
+	_viewers.clear();
+	_changes.clear();
+}
+
+/**
+ * Logs a change of the terrain, smoke or fire on a tile.
+ * @param pos Position of the tile.
+ */
+void VisibilityCache::tileChanged(const Position &pos)
+{
+	if (_viewers.empty())
+		return;
+	_changes.push_back(pos);
+}
+
+/**
+ * Checks if any of the changes the viewer hasn't handled yet are within range.
+ * @param viewer Pointer to the viewer cache.
+ * @param range Range to check, in tiles.
+ * @return True if the terrain changed close enough to the viewer.
+ */
+bool VisibilityCache::hasChangesInRange(ViewerCache *viewer, int range) const
+{
+	for (size_t i = viewer->changesSeen; i < _changes.size(); ++i)
+	{
+		if (std::abs(_changes[i].x - viewer->position.x) <= range && std::abs(_changes[i].y - viewer->position.y) <= range)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Finds the lines of sight that went through or right next to a tile that
+ * changed since the viewer last handled the changes. Blockage of a line is
+ * also determined by the tiles around it, hence the extra margin.
+ * @param viewer Pointer to the viewer cache.
+ * @param rays Receives the indices of the changed lines.
+ */
+void VisibilityCache::getChangedRays(ViewerCache *viewer, std::vector<int> *rays)
+{
+	if (viewer->changesSeen == _changes.size() || viewer->rayTargets.empty())
+		return;
+
+	_changed.resize(_save->getMapSizeXYZ(), false);
+	std::vector<int> marked;
+	for (size_t i = viewer->changesSeen; i < _changes.size(); ++i)
+	{
+		for (int x = _changes[i].x - 1; x <= _changes[i].x + 1; ++x)
+		{
+			for (int y = _changes[i].y - 1; y <= _changes[i].y + 1; ++y)
+			{
+				for (int z = _changes[i].z - 1; z <= _changes[i].z + 1; ++z)
+				{
+					if (x < 0 || y < 0 || z < 0 || x >= _save->getMapSizeX() || y >= _save->getMapSizeY() || z >= _save->getMapSizeZ())
+						continue;
+					int index = _save->getTileIndex(Position(x, y, z));
+					if (!_changed[index])
+					{
+						_changed[index] = true;
+						marked.push_back(index);
+					}
+				}
+			}
+		}
+	}
+
+	for (size_t ray = 0; ray < viewer->rayStarts.size(); ++ray)
+	{
+		int end = viewer->rayStarts[ray] + viewer->rayLengths[ray];
+		for (int i = viewer->rayStarts[ray]; i < end; ++i)
+		{
+			if (_changed[viewer->rayTiles[i]])
+			{
+				rays->push_back(ray);
+				break;
+			}
+		}
+	}
+
+	for (std::vector<int>::const_iterator i = marked.begin(); i != marked.end(); ++i)
+	{
+		_changed[*i] = false;
+	}
+}
+
+/**
+ * Marks all the logged changes as handled by the viewer.
+ * @param viewer Pointer to the viewer cache.
+ */
+void VisibilityCache::acknowledgeChanges(ViewerCache *viewer)
+{
+	viewer->changesSeen = _changes.size();
+}
+
+/**
+ * Forgets all the lines of sight of the viewer.
+ * @param viewer Pointer to the viewer cache.
+ */
+void VisibilityCache::clearRays(ViewerCache *viewer)
+{
+	viewer->rayTargets.clear();
+	viewer->rayEyes.clear();
+	viewer->rayStarts.clear();
+	viewer->rayLengths.clear();
+	viewer->rayTiles.clear();
+	viewer->rayGarbage = 0;
+	viewer->discovered = false;
+}
+
+/**
+ * Adds a line of sight to the viewer.
+ * @param viewer Pointer to the viewer cache.
+ * @param target Tile index of the target of the line.
+ * @param eye Which eye of a large unit the line starts from.
+ * @param tiles Tile indices of all the tiles the line went through.
+ */
+void VisibilityCache::addRay(ViewerCache *viewer, int target, int eye, const std::vector<int> &tiles)
+{
+	viewer->rayTargets.push_back(target);
+	viewer->rayEyes.push_back(eye);
+	viewer->rayStarts.push_back(viewer->rayTiles.size());
+	viewer->rayLengths.push_back(tiles.size());
+	viewer->rayTiles.insert(viewer->rayTiles.end(), tiles.begin(), tiles.end());
+}
+
+/**
+ * Replaces the tiles of a line of sight that was traced again.
+ * Lines that got longer are moved to the end of the tile list; the list
+ * is compacted once more than half of it is unused.
+ * @param viewer Pointer to the viewer cache.
+ * @param ray Index of the line.
+ * @param tiles Tile indices of all the tiles the line now goes through.
+ */
+void VisibilityCache::replaceRay(ViewerCache *viewer, int ray, const std::vector<int> &tiles)
+{
+	if ((int)tiles.size() <= viewer->rayLengths[ray])
+	{
+		viewer->rayGarbage += viewer->rayLengths[ray] - tiles.size();
+		std::copy(tiles.begin(), tiles.end(), viewer->rayTiles.begin() + viewer->rayStarts[ray]);
+	}
+	else
+	{
+		viewer->rayGarbage += viewer->rayLengths[ray];
+		viewer->rayStarts[ray] = viewer->rayTiles.size();
+		viewer->rayTiles.insert(viewer->rayTiles.end(), tiles.begin(), tiles.end());
+	}
+	viewer->rayLengths[ray] = tiles.size();
+
+	if (viewer->rayGarbage * 2 > viewer->rayTiles.size())
+	{
+		std::vector<int> compacted;
+		compacted.reserve(viewer->rayTiles.size() - viewer->rayGarbage);
+		for (size_t i = 0; i < viewer->rayStarts.size(); ++i)
+		{
+			int start = viewer->rayStarts[i];
+			viewer->rayStarts[i] = compacted.size();
+			compacted.insert(compacted.end(), viewer->rayTiles.begin() + start, viewer->rayTiles.begin() + start + viewer->rayLengths[i]);
+		}
+		viewer->rayTiles.swap(compacted);
+		viewer->rayGarbage = 0;
+	}
+}
+
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_VISIBILITYCACHE_H
+#define OPENXCOM_VISIBILITYCACHE_H
+
+#include <map>
+#include <vector>
+#include "Position.h"
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+class BattleUnit;
+
+/**
+ * The state of a unit near a viewer, as far as line of sight is concerned.
+ * If none of these change, the viewer sees the unit exactly like before.
+ */
+struct Sighting
+{
+	BattleUnit *unit;
+	Position position;
+	int direction, height, status, faction, darkness;
+	bool operator==(const Sighting &other) const
+	{
+		return unit == other.unit && position == other.position && direction == other.direction && height == other.height
+			&& status == other.status && faction == other.faction && darkness == other.darkness;
+	}
+};
+
+/**
+ * The cached field of view of a single unit.
+ * Holds everything the last calculation depended on, and the tiles each
+ * line of sight went through, so only the affected lines need to be traced again.
+ */
+struct ViewerCache
+{
+	bool valid, discovered;
+	Position position, eye;
+	int direction, faction;
+	unsigned int changesSeen, rayGarbage;
+	std::vector<Sighting> sightings;
+	std::vector<int> rayTargets, rayEyes, rayStarts, rayLengths, rayTiles;
+};
+
+/**
+ * Keeps the fields of view of all units in between calculations.
+ * Terrain changes are logged here and checked against the cached lines of sight
+ * the next time a unit's field of view is requested.
+ */
+class VisibilityCache
+{
+private:
+	SavedBattleGame *_save;
+	std::map<BattleUnit*, ViewerCache> _viewers;
+	std::vector<Position> _changes;
+	std::vector<bool> _changed;
+public:
+	/// Creates a new visibility cache.
+	VisibilityCache(SavedBattleGame *save);
+	/// Cleans up the visibility cache.
+	~VisibilityCache();
+	/// Gets the cache of a unit.
+	ViewerCache *getViewer(BattleUnit *unit);
+	/// Forgets the cache of a unit.
+	void removeViewer(BattleUnit *unit);
+	/// Forgets everything.
+	void clear();
+	/// Logs a terrain change.
+	void tileChanged(const Position &pos);
+	/// Checks for terrain changes near a viewer.
+	bool hasChangesInRange(ViewerCache *viewer, int range) const;
+	/// Gets the lines of sight of a viewer that went through changed terrain.
+	void getChangedRays(ViewerCache *viewer, std::vector<int> *rays);
+	/// Marks all logged changes as handled by a viewer.
+	void acknowledgeChanges(ViewerCache *viewer);
+	/// Forgets the lines of sight of a viewer.
+	void clearRays(ViewerCache *viewer);
+	/// Adds a line of sight to a viewer.
+	void addRay(ViewerCache *viewer, int target, int eye, const std::vector<int> &tiles);
+	/// Replaces the tiles of a line of sight of a viewer.
+	void replaceRay(ViewerCache *viewer, int ray, const std::vector<int> &tiles);
+};
+
+}
+
+#endif
@@ -30,6 +30,7 @@
 #include "Logger.h"
 #include "../Interface/Cursor.h"
 #include "../Interface/FpsCounter.h"
+#include "../Interface/ProfilerOverlay.h"
 #include "../Resource/ResourcePack.h"
 #include "../Ruleset/Ruleset.h"
 #include "../Savegame/SavedGame.h"
@@ -39,6 +40,8 @@
 #include "InteractiveSurface.h"
 #include "Options.h"
 #include "CrossPlatform.h"
+#include "Timer.h"
+#include "Profiler.h"
 
 namespace OpenXcom
 {
@@ -48,7 +51,7 @@ namespace OpenXcom
  * creates the display screen and sets up the cursor.
  * @param title Title of the game window.
  */
-Game::Game(const std::string &title) : _screen(0), _cursor(0), _lang(0), _states(), _deleted(), _res(0), _save(0), _rules(0), _quit(false), _init(false), _mouseActive(true)
+Game::Game(const std::string &title) : _screen(0), _cursor(0), _lang(0), _states(), _deleted(), _res(0), _save(0), _rules(0), _quit(false), _init(false), _redraw(true), _mouseActive(true)
 {
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -116,7 +119,10 @@ Game::Game(const std::string &title) : _screen(0), _cursor(0), _lang(0), _states
 	_cursor->setColor(Palette::blockOffset(15)+12);
 
 	// Create fps counter
-	_fpsCounter = new FpsCounter(15, 5, 0, 0);
+	_fpsCounter = new FpsCounter(20, 23, 0, 0);
+
+	// Create profiler overlay
+	_profilerOverlay = new ProfilerOverlay(200, 90, 22, 0);
 
 	// Create blank language
 	_lang = new Language();
@@ -141,6 +147,7 @@ Game::~Game()
 	delete _save;
 	delete _screen;
 	delete _fpsCounter;
+	delete _profilerOverlay;
 
 	Mix_CloseAudio();
 
@@ -151,6 +158,10 @@ Game::~Game()
  * The state machine takes care of passing all the events from SDL to the
  * active state, running any code within and blitting all the states and
  * cursor to the screen. This is run indefinitely until the game quits.
+ * Logic runs on every cycle, but a frame is only rendered when something
+ * changed (input, a timer firing, a new state) and the next frame slot for
+ * the target frame rate has come. In between, the game sleeps until the
+ * earliest timer is due, or for at most a frame so input stays responsive.
  */
 void Game::run()
 {
@@ -160,6 +171,14 @@ void Game::run()
 	int pauseMode = Options::getInt("pauseMode");
 	if (pauseMode > 3)
 		pauseMode = 3;
+	// anything that changes on screen without input or a timer still shows up, just not smoothly
+	const Uint32 idleRefresh = 100;
+	int frameRate = Options::getInt("frameRate");
+	Uint32 frameTime = frameRate > 0 ? 1000 / frameRate : 0;
+	bool skipIdleFrames = Options::getBool("skipIdleFrames");
+	Uint32 lastFrame = SDL_GetTicks() - idleRefresh;
+	// frame timings are in microseconds, SDL_GetTicks() is too coarse for them
+	Uint64 thinkTime = 0;
 	while (!_quit)
 	{
 		// Clean up states
@@ -172,7 +191,9 @@ void Game::run()
 		// Initialize active state
 		if (!_init)
 		{
+			ProfileZone zone("State::init");
 			_init = true;
+			_redraw = true;
 			_states.back()->init();
 
 			// Unpress buttons
@@ -190,45 +211,50 @@ void Game::run()
 		}
 
 		// Process events
-		while (SDL_PollEvent(&_event))
 		{
-			switch (_event.type)
+			ProfileZone zone("Game::events");
+			while (SDL_PollEvent(&_event))
 			{
-				case SDL_QUIT: _quit = true; break;
-				case SDL_ACTIVEEVENT:
-					switch (reinterpret_cast<SDL_ActiveEvent*>(&_event)->state)
-					{
-						case SDL_APPACTIVE:
-							runningState = reinterpret_cast<SDL_ActiveEvent*>(&_event)->gain ? RUNNING : stateRun[pauseMode];
-							break;
-						case SDL_APPMOUSEFOCUS:
-							// We consciously ignore it.
-							break;
-						case SDL_APPINPUTFOCUS:
-							runningState = reinterpret_cast<SDL_ActiveEvent*>(&_event)->gain ? RUNNING : kbFocusRun[pauseMode];
-							break;
-					}
-					break;
-				case SDL_VIDEORESIZE:
-					Options::setInt("displayWidth", _event.resize.w);
-					Options::setInt("displayHeight", _event.resize.h);
-					_screen->setResolution(_event.resize.w, _event.resize.h);
-					break;
-				case SDL_MOUSEMOTION:
-				case SDL_MOUSEBUTTONDOWN:
-				case SDL_MOUSEBUTTONUP:
-					// Skip mouse events if they're disabled
-					if (!_mouseActive) continue;
-					// re-gain focus on mouse-over or keypress.
-					runningState = RUNNING;
-					// Go on, feed the event to others
-				default:
-					Action action = Action(&_event, _screen->getXScale(), _screen->getYScale());
-					_screen->handle(&action);
-					_cursor->handle(&action);
-					_fpsCounter->handle(&action);
-					_states.back()->handle(&action);
-					break;
+				_redraw = true;
+				switch (_event.type)
+				{
+					case SDL_QUIT: _quit = true; break;
+					case SDL_ACTIVEEVENT:
+						switch (reinterpret_cast<SDL_ActiveEvent*>(&_event)->state)
+						{
+							case SDL_APPACTIVE:
+								runningState = reinterpret_cast<SDL_ActiveEvent*>(&_event)->gain ? RUNNING : stateRun[pauseMode];
+								break;
+							case SDL_APPMOUSEFOCUS:
+								// We consciously ignore it.
+								break;
+							case SDL_APPINPUTFOCUS:
+								runningState = reinterpret_cast<SDL_ActiveEvent*>(&_event)->gain ? RUNNING : kbFocusRun[pauseMode];
+								break;
+						}
+						break;
+					case SDL_VIDEORESIZE:
+						Options::setInt("displayWidth", _event.resize.w);
+						Options::setInt("displayHeight", _event.resize.h);
+						_screen->setResolution(_event.resize.w, _event.resize.h);
+						break;
+					case SDL_MOUSEMOTION:
+					case SDL_MOUSEBUTTONDOWN:
+					case SDL_MOUSEBUTTONUP:
+						// Skip mouse events if they're disabled
+						if (!_mouseActive) continue;
+						// re-gain focus on mouse-over or keypress.
+						runningState = RUNNING;
+						// Go on, feed the event to others
+					default:
+						Action action = Action(&_event, _screen->getXScale(), _screen->getYScale());
+						_screen->handle(&action);
+						_cursor->handle(&action);
+						_fpsCounter->handle(&action);
+						_profilerOverlay->handle(&action);
+						_states.back()->handle(&action);
+						break;
+				}
 			}
 		}
 
@@ -236,11 +262,26 @@ void Game::run()
 		if (runningState != PAUSED)
 		{
 			// Process logic
+			Uint64 thinkStart = Profiler::getTime();
+			unsigned int fired = Timer::getFired();
+			Timer::resetDeadline();
 			_fpsCounter->think();
-			_states.back()->think();
+			_profilerOverlay->think();
+			{
+				ProfileZone zone("State::think");
+				_states.back()->think();
+			}
+			if (Timer::getFired() != fired)
+			{
+				_redraw = true;
+			}
+			thinkTime += Profiler::getTime() - thinkStart;
+			Uint32 now = SDL_GetTicks();
 
-			if (_init)
+			bool due = _redraw || !skipIdleFrames || now - lastFrame >= idleRefresh;
+			if (_init && due && now - lastFrame >= frameTime)
 			{
+				Uint64 blitStart = Profiler::getTime();
 				_screen->clear();
 				std::list<State*>::iterator i = _states.end();
 				do
@@ -251,18 +292,48 @@ void Game::run()
 
 				for (; i != _states.end(); ++i)
 				{
+					ProfileZone zone("State::blit");
 					(*i)->blit();
 				}
 				_fpsCounter->blit(_screen->getSurface());
+				_profilerOverlay->blit(_screen->getSurface());
 				_cursor->blit(_screen->getSurface());
+
+				Uint64 flipStart = Profiler::getTime();
+				{
+					ProfileZone zone("Screen::flip");
+					_screen->flip();
+				}
+				Uint64 flipEnd = Profiler::getTime();
+				_fpsCounter->addFrame((Uint32)thinkTime, (Uint32)(flipStart - blitStart), (Uint32)(flipEnd - flipStart));
+				// keep to the frame slots instead of drifting after slow frames
+				lastFrame = (frameTime > 0 && now - lastFrame < frameTime * 2) ? lastFrame + frameTime : now;
+				thinkTime = 0;
+				_redraw = false;
 			}
-			_screen->flip();
 		}
 
 		// Save on CPU
 		switch (runningState)
 		{
-			case RUNNING: SDL_Delay(1); break; //Save CPU from going 100%
+			case RUNNING:
+			{
+				if (frameTime == 0)
+				{
+					SDL_Delay(1); //Save CPU from going 100%
+					break;
+				}
+				// sleep until the next timer is due, but wake up every frame to check for input
+				Uint32 now = SDL_GetTicks();
+				Uint32 slot = lastFrame + frameTime;
+				Uint32 wait = Timer::getTimeToDeadline(frameTime);
+				if (_redraw && (slot <= now || slot - now < wait))
+				{
+					wait = slot <= now ? 0 : slot - now;
+				}
+				SDL_Delay(wait > 0 ? wait : 1);
+				break;
+			}
 			case SLOWED: case PAUSED:
 				SDL_Delay(100); break; //More slowing down.
 		}
@@ -335,6 +406,8 @@ void Game::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 	_cursor->draw();
 
 	_fpsCounter->setPalette(colors, firstcolor, ncolors);
+	_profilerOverlay->setPalette(colors, firstcolor, ncolors);
+	_redraw = true;
 
 	if (_res != 0)
 	{
@@ -431,6 +504,10 @@ ResourcePack *Game::getResourcePack() const
 void Game::setResourcePack(ResourcePack *res)
 {
 	_res = res;
+	if (_res != 0)
+	{
+		_profilerOverlay->setFonts(_res->getFont("Big.fnt"), _res->getFont("Small.fnt"));
+	}
 }
 
 /**
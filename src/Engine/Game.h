@@ -34,6 +34,7 @@ class ResourcePack;
 class SavedGame;
 class Ruleset;
 class FpsCounter;
+class ProfilerOverlay;
 
 /**
  * The core of the game engine, manages the game's entire contents and structure.
@@ -52,8 +53,9 @@ private:
 	ResourcePack *_res;
 	SavedGame *_save;
 	Ruleset *_rules;
-	bool _quit, _init;
+	bool _quit, _init, _redraw;
 	FpsCounter *_fpsCounter;
+	ProfilerOverlay *_profilerOverlay;
 	bool _mouseActive;
 public:
 	/// Creates a new game and initializes SDL.
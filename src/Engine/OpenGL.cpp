@@ -108,7 +108,7 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
   }
 
   bool OpenGL::lock(uint32_t *&data, unsigned &pitch) {
-    pitch = iwidth * ibpp;
+    pitch = buffer_surface ? buffer_surface->getSurface()->pitch : iwidth * (ibpp / 8);
     return (data = buffer);
   }
 
@@ -68,12 +68,16 @@ void createDefault()
 #endif
 	setBool("playIntro", true);
 	setInt("maxFrameSkip", 8);
+	setInt("frameRate", 60); // target frames per second, 0 for no limit
+	setBool("skipIdleFrames", true); // only render a frame when something changed on screen
 	setBool("traceAI", false);
 	setBool("sneakyAI", false);
+	setInt("battleAIThreads", 0); // threads for the AI to survey tiles with, 0 for one per processor core
 	setInt("baseXResolution", 320);
 	setInt("baseYResolution", 200);
 	setBool("useScaleFilter", false);
 	setBool("useHQXFilter", false);
+	setInt("scalerThreads", 0); // threads to split screen scaling over, 0 for one per processor core
 	setBool("useOpenGL", false);
 	setBool("checkOpenGLErrors", false);
 	setString("useOpenGLShader", "Shaders/Openxcom.OpenGL.shader");
@@ -96,11 +100,17 @@ void createDefault()
 	setInt("battleAlienSpeed", 30); // 40, 30, 20, 10, 5, 1
 	setBool("battleInstantGrenade", false); // set to true if you want to play with the alternative grenade handling
 	setInt("battleExplosionHeight", 0); //0, 1, 2, 3
+	setBool("battleExplosionBatch", false); // trace explosion rays in batches, slightly different results
 	setBool("battlePreviewPath", false); // requires double-click to confirm moves
 	setBool("battleRangeBasedAccuracy", false);
+	setBool("battleShadowcastFOV", false); // single sweep tile discovery instead of a line per tile, slightly different results
+	setBool("battleDirtyRedraw", true); // only redraw the parts of the battlescape view that changed
+	setBool("battleTerrainCache", false); // keep pre-drawn images of the battlescape terrain, uses more memory
 	setBool("fpsCounter", false);
+	setBool("profiler", false); // record how long the hot paths take from startup, written to a trace file on exit
 	setBool("craftLaunchAlways", false);
 	setBool("globeSeasons", false);
+	setBool("geoscapeFastForward", true); // skip the event checks on 5-second steps where nothing but movement can happen
 	setBool("globeAllRadarsOnBaseBuild", true);
 	setBool("allowChangeListValuesByMouseWheel", false); // It applies only for lists, not for scientists/engineers screen
 	setInt("changeValueByMouseWheel", 10);
@@ -183,6 +193,7 @@ void createDefault()
 	setInt("keyCancel", SDLK_ESCAPE);
 	setInt("keyScreenshot", SDLK_F12);
 	setInt("keyFps", SDLK_F5);
+	setInt("keyProfiler", SDLK_F6);
 	setInt("keyGeoLeft", SDLK_LEFT);
 	setInt("keyGeoRight", SDLK_RIGHT);
 	setInt("keyGeoUp", SDLK_UP);
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Profiler.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <SDL_thread.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+#include "Options.h"
+#include "Logger.h"
+#include "CrossPlatform.h"
+
+namespace OpenXcom
+{
+
+namespace
+{
+
+// past this the trace would get too big to load anyway, so only totals are kept
+const size_t MAX_EVENTS = 1 << 20;
+
+bool moreTime(const ProfileTotal &a, const ProfileTotal &b)
+{
+	return a.time > b.time;
+}
+
+}
+
+bool Profiler::enabled = false;
+std::vector<Profiler::Event> Profiler::_events;
+std::map<const char*, ProfileTotal, Profiler::NameLess> Profiler::_totals;
+SDL_mutex *Profiler::_mutex = 0;
+Uint64 Profiler::_origin = 0;
+bool Profiler::_full = false;
+
+/**
+ * Clears out anything recorded before and starts recording zones.
+ * Zones already running when it starts are not recorded.
+ */
+void Profiler::start()
+{
+	if (enabled)
+		return;
+	if (_mutex == 0)
+	{
+		_mutex = SDL_CreateMutex();
+	}
+	_events.clear();
+	_totals.clear();
+	_full = false;
+	_origin = getTime();
+	enabled = true;
+	Log(LOG_INFO) << "Profiler started.";
+}
+
+/**
+ * Stops recording zones and writes everything recorded
+ * to a new trace file in the user folder.
+ * @return Filename of the trace file, empty if nothing was recorded.
+ */
+std::string Profiler::stop()
+{
+	if (!enabled)
+		return "";
+	SDL_LockMutex(_mutex);
+	enabled = false;
+	SDL_UnlockMutex(_mutex);
+
+	if (_events.empty())
+		return "";
+	std::stringstream ss;
+	int i = 0;
+	do
+	{
+		ss.str("");
+		ss << Options::getUserFolder() << "trace" << std::setfill('0') << std::setw(3) << i << ".json";
+		i++;
+	}
+	while (CrossPlatform::fileExists(ss.str()));
+	writeTrace(ss.str());
+	std::vector<Event>().swap(_events);
+	return ss.str();
+}
+
+/**
+ * Returns the time from a high resolution clock.
+ * Only useful to compare with other times, never 0.
+ * @return Time in microseconds.
+ */
+Uint64 Profiler::getTime()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = {0};
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (Uint64)(counter.QuadPart / (frequency.QuadPart / 1000000.0));
+#elif defined(CLOCK_MONOTONIC)
+	// unlike the wall clock, this never jumps when the system time is changed
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (Uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	timeval tv;
+	gettimeofday(&tv, 0);
+	return (Uint64)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/**
+ * Records a run of a zone. Can be called from any thread.
+ * @param name Name of the zone.
+ * @param start Time the zone started.
+ * @param end Time the zone ended.
+ */
+void Profiler::record(const char *name, Uint64 start, Uint64 end)
+{
+	SDL_LockMutex(_mutex);
+	if (enabled)
+	{
+		if (_events.size() < MAX_EVENTS)
+		{
+			Event event = { name, start - _origin, end - start, SDL_ThreadID() };
+			_events.push_back(event);
+		}
+		else if (!_full)
+		{
+			_full = true;
+			Log(LOG_WARNING) << "Profiler trace is full, only keeping totals from now on.";
+		}
+		std::map<const char*, ProfileTotal, NameLess>::iterator i = _totals.find(name);
+		if (i == _totals.end())
+		{
+			ProfileTotal total = { name, 0, 0 };
+			i = _totals.insert(std::make_pair(name, total)).first;
+		}
+		i->second.time += end - start;
+		i->second.calls++;
+	}
+	SDL_UnlockMutex(_mutex);
+}
+
+/**
+ * Writes all the recorded zones as complete events in the
+ * Chrome trace-event format, one thread per SDL thread.
+ * @param filename Filename of the JSON file.
+ */
+void Profiler::writeTrace(const std::string &filename)
+{
+	std::ofstream out(filename.c_str());
+	if (!out)
+	{
+		Log(LOG_ERROR) << "Failed to write profiler trace to " << filename;
+		return;
+	}
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (std::vector<Event>::const_iterator i = _events.begin(); i != _events.end(); ++i)
+	{
+		if (i != _events.begin())
+			out << ",";
+		out << "\n{\"name\":\"";
+		for (const char *c = i->name; *c != 0; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\';
+			out << *c;
+		}
+		out << "\",\"cat\":\"openxcom\",\"ph\":\"X\",\"pid\":1,\"tid\":" << i->thread << ",\"ts\":" << i->start << ",\"dur\":" << i->duration << "}";
+	}
+	out << "\n]}\n";
+	Log(LOG_INFO) << "Profiler trace saved to " << filename;
+}
+
+/**
+ * Gets the time spent in every zone since the last call,
+ * from the slowest zone to the fastest, and starts over.
+ * @param totals Receives the totals.
+ */
+void Profiler::takeTotals(std::vector<ProfileTotal> *totals)
+{
+	totals->clear();
+	if (_mutex == 0)
+		return;
+	SDL_LockMutex(_mutex);
+	for (std::map<const char*, ProfileTotal, NameLess>::iterator i = _totals.begin(); i != _totals.end(); ++i)
+	{
+		totals->push_back(i->second);
+	}
+	_totals.clear();
+	SDL_UnlockMutex(_mutex);
+	std::sort(totals->begin(), totals->end(), moreTime);
+}
+
+}
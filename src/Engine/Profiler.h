@@ -0,0 +1,102 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PROFILER_H
+#define OPENXCOM_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+/**
+ * Time spent in a zone of code since the totals were last taken.
+ */
+struct ProfileTotal
+{
+	const char *name;
+	Uint64 time;
+	int calls;
+};
+
+/**
+ * Collects how long the zones of code marked with a ProfileZone take.
+ * Every run of a zone is kept so it can be written out as a Chrome
+ * trace-event file (load it in chrome://tracing), and totals per zone
+ * are kept for the in-game overlay. While it's stopped, zones cost no
+ * more than checking a flag.
+ */
+class Profiler
+{
+public:
+	static bool enabled;
+private:
+	struct Event
+	{
+		const char *name;
+		Uint64 start, duration;
+		Uint32 thread;
+	};
+	struct NameLess
+	{
+		bool operator()(const char *a, const char *b) const { return strcmp(a, b) < 0; }
+	};
+	static std::vector<Event> _events;
+	static std::map<const char*, ProfileTotal, NameLess> _totals;
+	static SDL_mutex *_mutex;
+	static Uint64 _origin;
+	static bool _full;
+public:
+	/// Starts recording zones.
+	static void start();
+	/// Stops recording zones and writes them to a trace file.
+	static std::string stop();
+	/// Gets the current time.
+	static Uint64 getTime();
+	/// Records a run of a zone.
+	static void record(const char *name, Uint64 start, Uint64 end);
+	/// Writes all the recorded zones to a trace file.
+	static void writeTrace(const std::string &filename);
+	/// Gets and clears the time spent in every zone.
+	static void takeTotals(std::vector<ProfileTotal> *totals);
+};
+
+/**
+ * Marks a zone of code for the profiler: the time between creating
+ * and destroying it is recorded under its name. The name must be a
+ * string that stays around, usually a literal.
+ */
+class ProfileZone
+{
+private:
+	const char *_name;
+	Uint64 _start;
+public:
+	/// Starts timing the zone, if the profiler is running.
+	ProfileZone(const char *name) : _name(name), _start(Profiler::enabled ? Profiler::getTime() : 0) {}
+	/// Records the zone, if it was timed.
+	~ProfileZone() { if (_start != 0) Profiler::record(_name, _start, Profiler::getTime()); }
+};
+
+}
+
+#endif
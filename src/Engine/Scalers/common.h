@@ -37,13 +37,26 @@
 #define trU   0x00000700
 #define trV   0x00000006
 
-/* RGB to YUV lookup table */
-extern uint32_t RGBtoYUV[16777216];
+/* RGB to YUV cache, filled as colors are looked up */
+#define YUV_CACHE_SIZE 65536
+extern uint32_t YUVcache[YUV_CACHE_SIZE];
+
+uint32_t rgb_to_yuv_miss(uint32_t c, uint32_t index);
 
 static inline uint32_t rgb_to_yuv(uint32_t c)
 {
     // Mask against MASK_RGB to discard the alpha channel
-    return RGBtoYUV[MASK_RGB & c];
+    c &= MASK_RGB;
+    // The index mixes red into green and blue, so each entry only needs to
+    // hold the red component on top of the YUV value to identify the color.
+    // U is never 0, so empty entries never match.
+    uint32_t r = c >> 16;
+    uint32_t index = (c ^ (c >> 8)) & (YUV_CACHE_SIZE - 1);
+    uint32_t entry = YUVcache[index];
+    if (entry != 0 && (entry >> 24) == r) {
+        return entry & MASK_RGB;
+    }
+    return rgb_to_yuv_miss(c, index);
 }
 
 /* Test if there is difference in color */
@@ -17,22 +17,31 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "hqx.h"
+#include "common.h"
 
-uint32_t   RGBtoYUV[16777216];
+uint32_t   YUVcache[YUV_CACHE_SIZE];
 uint32_t   YUV1, YUV2;
 
+uint32_t rgb_to_yuv_miss(uint32_t c, uint32_t index)
+{
+    /* Convert the color and store it, entries are written in one go
+       so the cache can be shared by scalers running on several threads */
+    uint32_t r, g, b, y, u, v, yuv;
+    r = (c & 0xFF0000) >> 16;
+    g = (c & 0x00FF00) >> 8;
+    b = c & 0x0000FF;
+    y = (uint32_t)(0.299*r + 0.587*g + 0.114*b);
+    u = (uint32_t)((int)(-0.169*r - 0.331*g + 0.5*b) + 128);
+    v = (uint32_t)((int)(0.5*r - 0.419*g - 0.081*b) + 128);
+    yuv = (y << 16) + (u << 8) + v;
+    YUVcache[index] = (r << 24) | yuv;
+    return yuv;
+}
+
 HQX_API void HQX_CALLCONV hqxInit(void)
 {
-    /* Initalize RGB to YUV lookup table */
-    uint32_t c, r, g, b, y, u, v;
-    for (c = 0; c < 16777215; c++) {
-        r = (c & 0xFF0000) >> 16;
-        g = (c & 0x00FF00) >> 8;
-        b = c & 0x0000FF;
-        y = (uint32_t)(0.299*r + 0.587*g + 0.114*b);
-        u = (uint32_t)(-0.169*r - 0.331*g + 0.5*b) + 128;
-        v = (uint32_t)(0.5*r - 0.419*g - 0.081*b) + 128;
-        RGBtoYUV[c] = (y << 16) + (u << 8) + v;
-    }
+    /* Start with an empty cache, it is filled on demand */
+    memset(YUVcache, 0, sizeof(YUVcache));
 }
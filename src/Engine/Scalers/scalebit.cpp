@@ -501,3 +501,72 @@ void scale(unsigned scale, void* void_dst, unsigned dst_slice, const void* void_
 	}
 }
 
+/**
+ * Apply the Scale effect on a range of rows of a bitmap.
+ * The rows around the range are looked at like ::scale() does, so a bitmap
+ * can be split in bands that are scaled separately with identical results.
+ * \param scale Scale factor. 2, 3 or 4.
+ * \param void_dst Pointer at the first pixel of the destination bitmap.
+ * \param dst_slice Size in bytes of a destination bitmap row.
+ * \param void_src Pointer at the first pixel of the source bitmap.
+ * \param src_slice Size in bytes of a source bitmap row.
+ * \param pixel Bytes per pixel of the source and destination bitmap.
+ * \param width Horizontal size in pixels of the source bitmap.
+ * \param height Vertical size in pixels of the source bitmap.
+ * \param first First source row to scale.
+ * \param last Source row after the last one to scale.
+ */
+void scale_rows(unsigned scale, void* void_dst, unsigned dst_slice, const void* void_src, unsigned src_slice, unsigned pixel, unsigned width, unsigned height, unsigned first, unsigned last)
+{
+	unsigned char* dst = (unsigned char*)void_dst;
+	const unsigned char* src = (const unsigned char*)void_src;
+	unsigned row;
+
+	switch (scale) {
+	case 2 :
+		for (row = first; row < last; ++row) {
+			unsigned above = row > 0 ? row - 1 : 0;
+			unsigned below = row + 1 < height ? row + 1 : height - 1;
+			stage_scale2x(SCDST(2*row), SCDST(2*row+1), SCSRC(above), SCSRC(row), SCSRC(below), pixel, width);
+		}
+		break;
+	case 3 :
+		for (row = first; row < last; ++row) {
+			unsigned above = row > 0 ? row - 1 : 0;
+			unsigned below = row + 1 < height ? row + 1 : height - 1;
+			stage_scale3x(SCDST(3*row), SCDST(3*row+1), SCDST(3*row+2), SCSRC(above), SCSRC(row), SCSRC(below), pixel, width);
+		}
+		break;
+	case 4 : {
+		/* scale the source rows next to the range too, Scale4x is Scale2x applied twice */
+		unsigned mid_slice = (2 * pixel * width + 0x7) & ~0x7;
+		unsigned mid_first = first > 0 ? first - 1 : 0;
+		unsigned mid_last = last < height ? last : height - 1;
+		unsigned char* mid = (unsigned char*)malloc(2 * (mid_last - mid_first + 1) * mid_slice);
+
+		if (!mid)
+			return;
+
+		for (row = mid_first; row <= mid_last; ++row) {
+			unsigned above = row > 0 ? row - 1 : 0;
+			unsigned below = row + 1 < height ? row + 1 : height - 1;
+			unsigned char* mid_row = mid + 2 * (row - mid_first) * mid_slice;
+			stage_scale2x(mid_row, mid_row + mid_slice, SCSRC(above), SCSRC(row), SCSRC(below), pixel, width);
+		}
+		for (row = first; row < last; ++row) {
+			unsigned above = row > 0 ? 2 * row - 1 : 0;
+			unsigned below = row + 1 < height ? 2 * row + 2 : 2 * row + 1;
+			stage_scale4x(SCDST(4*row), SCDST(4*row+1), SCDST(4*row+2), SCDST(4*row+3),
+				mid + (above - 2 * mid_first) * mid_slice, mid + (2 * row - 2 * mid_first) * mid_slice,
+				mid + (2 * row + 1 - 2 * mid_first) * mid_slice, mid + (below - 2 * mid_first) * mid_slice, pixel, width);
+		}
+		free(mid);
+		break;
+	}
+	}
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	scale2x_mmx_emms();
+#endif
+}
+
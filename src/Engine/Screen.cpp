@@ -30,6 +30,7 @@
 #include "Zoom.h"
 #include "OpenGL.h"
 #include "Timer.h"
+#include "ThreadPool.h"
 #include <SDL.h>
 
 namespace OpenXcom
@@ -64,7 +65,7 @@ void Screen::makeVideoFlags()
  * @warning Currently the game is designed for 8bpp, so there's no telling what'll
  * happen if you use a different value.
  */
-Screen::Screen(int width, int height, int bpp, bool fullscreen, int windowedModePositionX, int windowedModePositionY) : _bpp(bpp), _scaleX(1.0), _scaleY(1.0), _fullscreen(fullscreen), _numColors(0), _firstColor(0), _surface(0)
+Screen::Screen(int width, int height, int bpp, bool fullscreen, int windowedModePositionX, int windowedModePositionY) : _bpp(bpp), _scaleX(1.0), _scaleY(1.0), _fullscreen(fullscreen), _numColors(0), _firstColor(0), _surface(0), _threadPool(0)
 {
 	char *prev;
 	if (!_fullscreen && (windowedModePositionX != -1 || windowedModePositionY != -1))
@@ -83,6 +84,7 @@ Screen::Screen(int width, int height, int bpp, bool fullscreen, int windowedMode
 		SDL_putenv(const_cast<char*>(ss.str().c_str()));
 	}
 	memset(deferredPalette, 0, 256*sizeof(SDL_Color));
+	_threadPool = new ThreadPool(Options::getInt("scalerThreads"));
 }
 
 /**
@@ -92,6 +94,7 @@ Screen::Screen(int width, int height, int bpp, bool fullscreen, int windowedMode
 Screen::~Screen()
 {
 	delete _surface;
+	delete _threadPool;
 }
 
 /**
@@ -156,7 +159,7 @@ void Screen::flip()
 {
 	if (getWidth() != BASE_WIDTH || getHeight() != BASE_HEIGHT || isOpenGLEnabled())
 	{
-		Zoom::flipWithZoom(_surface->getSurface(), _screen, &glOutput);
+		Zoom::flipWithZoom(_surface->getSurface(), _screen, &glOutput, _threadPool);
 	}
 	else
 	{
@@ -276,13 +279,13 @@ void Screen::setResolution(int width, int height)
 	makeVideoFlags();
 
 	if (!_surface || (_surface && 
-		(_surface->getSurface()->format->BitsPerPixel != _bpp || 
+		(_surface->getSurface()->format->BitsPerPixel != 8 || 
 		_surface->getSurface()->w != BASE_WIDTH ||
 		_surface->getSurface()->h != BASE_HEIGHT))) // don't reallocate _surface if not necessary, it's a waste of CPU cycles
 	{
 		if (_surface) delete _surface;
-		_surface = new Surface((int)BASE_WIDTH, (int)BASE_HEIGHT, 0, 0, Screen::isHQXEnabled() ? 32 : 8); // only HQX needs 32bpp for this surface; the OpenGL class has its own 32bpp buffer
-		if (_surface->getSurface()->format->BitsPerPixel == 8) _surface->setPalette(deferredPalette);
+		_surface = new Surface((int)BASE_WIDTH, (int)BASE_HEIGHT, 0, 0, 8); // HQX and OpenGL expand the palette themselves when flipping
+		_surface->setPalette(deferredPalette);
 	}
 	SDL_SetColorKey(_surface->getSurface(), 0, 0); // turn off color key! 
 
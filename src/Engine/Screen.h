@@ -28,6 +28,7 @@ namespace OpenXcom
 
 class Surface;
 class Action;
+class ThreadPool;
 
 /**
  * A display screen, handles rendering onto the game window.
@@ -56,6 +57,7 @@ private:
 	bool _pushPalette;
 	OpenGL glOutput;
 	Surface *_surface;
+	ThreadPool *_threadPool;
 public:
 	/// Creates a new display screen with the specified resolution.
 	Screen(int width, int height, int bpp, bool fullscreen, int windowedModePositionX, int windowedModePositionY);
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ShadeBlit.h"
+#include <algorithm>
+#include "Logger.h"
+#include "Zoom.h"
+
+#if (_MSC_VER >= 1400) || (defined(__MINGW32__) && defined(__SSE2__))
+#ifndef __SSE2__
+#define __SSE2__ true
+#endif
+#include <intrin.h>
+#endif
+
+#ifdef __GNUC__
+#include <cpuid.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#if (_MSC_VER >= 1800)
+#define SHADEBLIT_AVX2
+#define SHADEBLIT_TARGET_AVX2
+#include <immintrin.h>
+#elif (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && (defined(__x86_64__) || defined(__i386__))
+// the AVX2 kernel is built for AVX2 on its own, the rest of the game isn't
+#define SHADEBLIT_AVX2
+#define SHADEBLIT_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+namespace OpenXcom
+{
+
+namespace ShadeBlit
+{
+
+/**
+ * Shades a row of pixels one at a time, exactly like StandartShade
+ * and ColorReplace do; the other kernels have to match this.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ * @param newColor New base color, or -1 to keep the source color.
+ */
+void shadeScalar(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	for (int i = 0; i < width; ++i)
+	{
+		if (src[i])
+		{
+			const int newShade = (src[i]&15) + shade;
+			if (newShade > 15)
+				// so dark it would flip over to another color - make it black instead
+				dest[i] = 15;
+			else if (newColor < 0)
+				dest[i] = (src[i]&(15<<4)) | newShade;
+			else
+				dest[i] = newColor | newShade;
+		}
+	}
+}
+
+#ifdef __SSE2__
+
+/**
+ * Shades a row of pixels 16 at a time with SSE2.
+ * Shades are added with saturation, so anything over 15 still ends up black.
+ * Transparent pixels are kept by blending with the destination.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ * @param newColor New base color, or -1 to keep the source color.
+ */
+static void shadeSSE2(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_set1_epi8(15);
+	const __m128i add = _mm_set1_epi8((char)std::min(shade, 255));
+	const __m128i keep = _mm_set1_epi8(newColor < 0 ? (char)0xF0 : 0);
+	const __m128i color = _mm_set1_epi8(newColor < 0 ? 0 : (char)newColor);
+	int i = 0;
+	for (; i + 16 <= width; i += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i transparent = _mm_cmpeq_epi8(s, zero);
+		if (_mm_movemask_epi8(transparent) == 0xFFFF)
+			continue;
+		__m128i newShade = _mm_adds_epu8(_mm_and_si128(s, low), add);
+		__m128i fits = _mm_cmpeq_epi8(_mm_subs_epu8(newShade, low), zero);
+		__m128i shaded = _mm_or_si128(_mm_or_si128(_mm_and_si128(s, keep), color), newShade);
+		shaded = _mm_or_si128(_mm_and_si128(fits, shaded), _mm_andnot_si128(fits, low));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+		d = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, shaded));
+		_mm_storeu_si128((__m128i*)(dest + i), d);
+	}
+	shadeScalar(dest + i, src + i, width - i, shade, newColor);
+}
+
+#endif
+
+#ifdef SHADEBLIT_AVX2
+
+/**
+ * Shades a row of pixels 32 at a time with AVX2, the same way as shadeSSE2.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param width Number of pixels.
+ * @param shade Shade to add.
+ * @param newColor New base color, or -1 to keep the source color.
+ */
+SHADEBLIT_TARGET_AVX2 static void shadeAVX2(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i low = _mm256_set1_epi8(15);
+	const __m256i add = _mm256_set1_epi8((char)std::min(shade, 255));
+	const __m256i keep = _mm256_set1_epi8(newColor < 0 ? (char)0xF0 : 0);
+	const __m256i color = _mm256_set1_epi8(newColor < 0 ? 0 : (char)newColor);
+	int i = 0;
+	for (; i + 32 <= width; i += 32)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i transparent = _mm256_cmpeq_epi8(s, zero);
+		if (_mm256_movemask_epi8(transparent) == -1)
+			continue;
+		__m256i newShade = _mm256_adds_epu8(_mm256_and_si256(s, low), add);
+		__m256i fits = _mm256_cmpeq_epi8(_mm256_subs_epu8(newShade, low), zero);
+		__m256i shaded = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(s, keep), color), newShade);
+		shaded = _mm256_blendv_epi8(low, shaded, fits);
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dest + i));
+		d = _mm256_blendv_epi8(shaded, d, transparent);
+		_mm256_storeu_si256((__m256i*)(dest + i), d);
+	}
+	// avoid the penalty for mixing AVX and SSE code
+	_mm256_zeroupper();
+	shadeSSE2(dest + i, src + i, width - i, shade, newColor);
+}
+
+/**
+ * Checks the AVX2 feature bit returned by the CPUID instruction,
+ * and if the operating system saves the AVX registers.
+ * @return True if AVX2 can be used.
+ */
+static bool haveAVX2()
+{
+#ifdef __GNUC__
+	unsigned int CPUInfo[4];
+	if (__get_cpuid_max(0, 0) < 7)
+		return false;
+	__cpuid(1, CPUInfo[0], CPUInfo[1], CPUInfo[2], CPUInfo[3]);
+	if ((CPUInfo[2] & 0x18000000) != 0x18000000) // OSXSAVE and AVX
+		return false;
+	unsigned int xcr0, xcr0High;
+	__asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0High) : "c" (0));
+	if ((xcr0 & 6) != 6)
+		return false;
+	__cpuid_count(7, 0, CPUInfo[0], CPUInfo[1], CPUInfo[2], CPUInfo[3]);
+#else
+	int CPUInfo[4];
+	__cpuid(CPUInfo, 0);
+	if (CPUInfo[0] < 7)
+		return false;
+	__cpuid(CPUInfo, 1);
+	if ((CPUInfo[2] & 0x18000000) != 0x18000000) // OSXSAVE and AVX
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(CPUInfo, 7, 0);
+#endif
+	return (CPUInfo[1] & 0x20) ? true : false;
+}
+
+#endif
+
+/**
+ * Gets the SSE2 kernel.
+ * @return Pointer to the kernel, or 0 if the processor or build doesn't support it.
+ */
+Kernel getSSE2()
+{
+#ifdef __SSE2__
+	if (Zoom::haveSSE2())
+		return &shadeSSE2;
+#endif
+	return 0;
+}
+
+/**
+ * Gets the AVX2 kernel.
+ * @return Pointer to the kernel, or 0 if the processor or build doesn't support it.
+ */
+Kernel getAVX2()
+{
+#ifdef SHADEBLIT_AVX2
+	if (getSSE2() && haveAVX2())
+		return &shadeAVX2;
+#endif
+	return 0;
+}
+
+/**
+ * Gets the fastest kernel the processor supports. Checked only once.
+ * @return Pointer to the kernel.
+ */
+Kernel getKernel()
+{
+	static Kernel kernel = 0;
+	if (kernel == 0)
+	{
+		if ((kernel = getAVX2()) != 0)
+		{
+			Log(LOG_INFO) << "Using AVX2 shading routine.";
+		}
+		else if ((kernel = getSSE2()) != 0)
+		{
+			Log(LOG_INFO) << "Using SSE2 shading routine.";
+		}
+		else
+		{
+			kernel = &shadeScalar;
+		}
+	}
+	return kernel;
+}
+
+}
+
+}
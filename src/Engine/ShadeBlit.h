@@ -0,0 +1,56 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SHADEBLIT_H
+#define OPENXCOM_SHADEBLIT_H
+
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+/**
+ * Row kernels for Surface::blitNShade, doing the work of StandartShade
+ * and ColorReplace on whole rows of palette pixels at once.
+ * Vectorized versions are picked at runtime, depending on the processor.
+ */
+namespace ShadeBlit
+{
+	/**
+	 * Shades a row of pixels onto another row, skipping transparent pixels.
+	 * @param dest Destination pixels.
+	 * @param src Source pixels.
+	 * @param width Number of pixels.
+	 * @param shade Shade to add, 0 or more.
+	 * @param newColor New base color (0-240), or -1 to keep the source color.
+	 */
+	typedef void (*Kernel)(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor);
+
+	/// Shades a row one pixel at a time.
+	void shadeScalar(Uint8 *dest, const Uint8 *src, int width, int shade, int newColor);
+	/// Shades a row 16 pixels at a time, or returns 0 if unavailable.
+	Kernel getSSE2();
+	/// Shades a row 32 pixels at a time, or returns 0 if unavailable.
+	Kernel getAVX2();
+	/// Gets the fastest kernel for this processor.
+	Kernel getKernel();
+}
+
+}
+
+#endif
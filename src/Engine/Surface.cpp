@@ -18,12 +18,14 @@
  */
 #include "Surface.h"
 #include "ShaderDraw.h"
+#include <algorithm>
 #include <fstream>
 #include <SDL_gfxPrimitives.h>
 #include <SDL_image.h>
 #include "Palette.h"
 #include "Exception.h"
 #include "ShaderMove.h"
+#include "ShadeBlit.h"
 #include <stdlib.h>
 #ifdef _WIN32
 #include <malloc.h>
@@ -854,6 +856,7 @@ struct StandartShade
 
 /**
  * Specific blit function to blit battlescape terrain data in different shades in a fast way.
+ * Only the part inside the target's clipping rectangle is drawn.
  * Notice there is no surface locking here - you have to make sure you lock the surface yourself
  * at the start of blitting and unlock it when done.
  * @param surface to blit to
@@ -865,6 +868,34 @@ struct StandartShade
  */
 void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int newBaseColor)
 {
+	if (off >= 0 && newBaseColor >= 0 && newBaseColor <= 16)
+	{
+		// the common case goes through the row kernels, a row at a time
+		const SDL_Rect &clip = surface->getSurface()->clip_rect;
+		int dx = x - surface->getX(), dy = y - surface->getY();
+		int left = std::max(dx + (half ? getWidth() / 2 : 0), (int)clip.x);
+		int right = std::min(dx + getWidth(), clip.x + clip.w);
+		int top = std::max(dy, (int)clip.y);
+		int bottom = std::min(dy + getHeight(), clip.y + clip.h);
+		if (left >= right || top >= bottom)
+			return;
+
+		static ShadeBlit::Kernel kernel = ShadeBlit::getKernel();
+		int color = newBaseColor ? (newBaseColor - 1) << 4 : -1;
+		Uint8 *destRow = (Uint8*)surface->getSurface()->pixels + top * surface->getSurface()->pitch + left;
+		const Uint8 *srcRow = (Uint8*)_surface->pixels + (top - dy) * _surface->pitch + (left - dx);
+		for (int row = top; row < bottom; ++row)
+		{
+			kernel(destRow, srcRow, right - left, off, color);
+			destRow += surface->getSurface()->pitch;
+			srcRow += _surface->pitch;
+		}
+		return;
+	}
+
+	ShaderMove<Uint8> dest(surface);
+	const SDL_Rect &clip = surface->getSurface()->clip_rect;
+	dest.setDomain(GraphSubset(std::make_pair(clip.x, clip.x + clip.w), std::make_pair(clip.y, clip.y + clip.h)));
 	ShaderMove<Uint8> src(this, x, y);
 	if(half)
 	{
@@ -876,10 +907,10 @@ void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int
 	{
 		--newBaseColor;
 		newBaseColor <<= 4;
-		ShaderDraw<ColorReplace>(ShaderSurface(surface), src, ShaderScalar(off), ShaderScalar(newBaseColor));
+		ShaderDraw<ColorReplace>(dest, src, ShaderScalar(off), ShaderScalar(newBaseColor));
 	}
 	else
-		ShaderDraw<StandartShade>(ShaderSurface(surface), src, ShaderScalar(off));
+		ShaderDraw<StandartShade>(dest, src, ShaderScalar(off));
 		
 }
 
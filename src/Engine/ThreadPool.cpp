@@ -0,0 +1,185 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ThreadPool.h"
+#include <SDL_thread.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace OpenXcom
+{
+
+/**
+ * Starts up the worker threads. The thread calling run() does
+ * its share of the jobs too, so it counts as one of the threads.
+ * @param threads Number of threads, 0 for one per processor core.
+ */
+ThreadPool::ThreadPool(int threads) : _job(0), _context(0), _count(0), _next(0), _pending(0), _quit(false)
+{
+	if (threads <= 0)
+	{
+		threads = getCoreCount();
+	}
+	_mutex = SDL_CreateMutex();
+	_wake = SDL_CreateCond();
+	_done = SDL_CreateCond();
+	for (int i = 1; i < threads; ++i)
+	{
+		SDL_Thread *thread = SDL_CreateThread(work, this);
+		if (thread == 0)
+			break;
+		_workers.push_back(thread);
+	}
+}
+
+/**
+ * Tells all the threads to stop and waits for them.
+ */
+ThreadPool::~ThreadPool()
+{
+	SDL_LockMutex(_mutex);
+	_quit = true;
+	SDL_CondBroadcast(_wake);
+	SDL_UnlockMutex(_mutex);
+	for (std::vector<SDL_Thread*>::iterator i = _workers.begin(); i != _workers.end(); ++i)
+	{
+		SDL_WaitThread(*i, 0);
+	}
+	SDL_DestroyCond(_done);
+	SDL_DestroyCond(_wake);
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Gets the number of threads jobs are spread over,
+ * including the one calling run().
+ * @return Number of threads.
+ */
+int ThreadPool::getThreads() const
+{
+	return _workers.size() + 1;
+}
+
+/**
+ * Takes the next job waiting and runs it.
+ * Must be called with the mutex locked, and returns with it locked.
+ * @return False if there were no jobs left.
+ */
+bool ThreadPool::runNext()
+{
+	if (_next >= _count)
+		return false;
+	int index = _next++;
+	Job job = _job;
+	void *context = _context;
+	SDL_UnlockMutex(_mutex);
+
+	job(context, index);
+
+	SDL_LockMutex(_mutex);
+	if (--_pending == 0)
+	{
+		SDL_CondBroadcast(_done);
+	}
+	return true;
+}
+
+/**
+ * Main loop of the worker threads: keep running jobs
+ * as long as there are any, and sleep otherwise.
+ * @param pool Pointer to the thread pool.
+ * @return Thread exit code.
+ */
+int ThreadPool::work(void *pool)
+{
+	ThreadPool *self = (ThreadPool*)pool;
+	SDL_LockMutex(self->_mutex);
+	while (!self->_quit)
+	{
+		if (!self->runNext())
+		{
+			SDL_CondWait(self->_wake, self->_mutex);
+		}
+	}
+	SDL_UnlockMutex(self->_mutex);
+	return 0;
+}
+
+/**
+ * Runs the job once for every index from 0 to count-1, spread over
+ * all the threads, and waits until every one of them is finished.
+ * @param job Function to run.
+ * @param context Data passed along to the job.
+ * @param count Number of times to run the job.
+ */
+void ThreadPool::run(Job job, void *context, int count)
+{
+	if (count <= 0)
+		return;
+	if (_workers.empty() || count == 1)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			job(context, i);
+		}
+		return;
+	}
+
+	SDL_LockMutex(_mutex);
+	_job = job;
+	_context = context;
+	_count = count;
+	_next = 0;
+	_pending = count;
+	SDL_CondBroadcast(_wake);
+	while (runNext())
+	{
+	}
+	while (_pending > 0)
+	{
+		SDL_CondWait(_done, _mutex);
+	}
+	_job = 0;
+	_context = 0;
+	_count = 0;
+	_next = 0;
+	SDL_UnlockMutex(_mutex);
+}
+
+/**
+ * Gets the number of processor cores available to the game.
+ * @return Number of cores, at least 1.
+ */
+int ThreadPool::getCoreCount()
+{
+	int cores = 1;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	cores = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return cores < 1 ? 1 : cores;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_THREADPOOL_H
+#define OPENXCOM_THREADPOOL_H
+
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+/**
+ * A fixed set of worker threads for splitting up work that can be done
+ * in parallel. Work is handed out as a number of independent jobs, which
+ * should each only write to their own results so the outcome doesn't
+ * depend on which thread ran them or in which order.
+ */
+class ThreadPool
+{
+public:
+	typedef void (*Job)(void *context, int index);
+private:
+	std::vector<SDL_Thread*> _workers;
+	SDL_mutex *_mutex;
+	SDL_cond *_wake, *_done;
+	Job _job;
+	void *_context;
+	int _count, _next, _pending;
+	bool _quit;
+	static int work(void *pool);
+	bool runNext();
+public:
+	/// Creates a pool with a number of threads.
+	ThreadPool(int threads);
+	/// Stops all the threads.
+	~ThreadPool();
+	/// Gets the number of threads working on jobs.
+	int getThreads() const;
+	/// Runs a number of jobs and waits for them to finish.
+	void run(Job job, void *context, int count);
+	/// Gets the number of processor cores.
+	static int getCoreCount();
+};
+
+}
+
+#endif
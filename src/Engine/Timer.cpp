@@ -42,6 +42,9 @@ Uint32 slowTick()
 
 Uint32 Timer::gameSlowSpeed = 1;
 int Timer::maxFrameSkip = 8; // this is a pretty good default at 60FPS. 
+Uint32 Timer::_deadline = 0;
+bool Timer::_hasDeadline = false;
+unsigned int Timer::_fired = 0;
 
 
 /**
@@ -133,6 +136,16 @@ void Timer::think(State* state, Surface* surface)
 			}
 			_start = slowTick();
 			if (_start > _frameSkipStart) _frameSkipStart = _start; // don't play animations in ffwd to catch up :P
+			_fired++;
+		}
+		if (_running)
+		{
+			Uint32 next = _frameSkipStart + _interval;
+			if (!_hasDeadline || next < _deadline)
+			{
+				_deadline = next;
+				_hasDeadline = true;
+			}
 		}
 	}
 }
@@ -171,4 +184,44 @@ void Timer::setFrameSkipping(bool skip)
 	_frameSkipping = skip;
 }
 
+/**
+ * Forgets the earliest deadline seen so far. Every running timer
+ * that thinks afterwards records when it's due next.
+ */
+void Timer::resetDeadline()
+{
+	_hasDeadline = false;
+}
+
+/**
+ * Returns how long until the earliest deadline recorded by the
+ * timers that thought since the last reset, in real time.
+ * @param limit Time to return if no timer is due sooner.
+ * @return Time in milliseconds.
+ */
+Uint32 Timer::getTimeToDeadline(Uint32 limit)
+{
+	if (!_hasDeadline)
+	{
+		return limit;
+	}
+	Uint32 now = slowTick();
+	if (_deadline <= now)
+	{
+		return 0;
+	}
+	Uint32 left = (_deadline - now) * gameSlowSpeed;
+	return left < limit ? left : limit;
+}
+
+/**
+ * Returns how many times any timer has fired, so callers
+ * can tell if anything happened in between two calls.
+ * @return Running count of intervals.
+ */
+unsigned int Timer::getFired()
+{
+	return _fired;
+}
+
 }
@@ -41,6 +41,9 @@ public:
 	static Uint32 gameSlowSpeed;
 	
 private:
+	static Uint32 _deadline;
+	static bool _hasDeadline;
+	static unsigned int _fired;
 	Uint32 _start;
 	Uint32 _frameSkipStart;
 	int _interval;
@@ -71,6 +74,12 @@ public:
 	void onTimer(SurfaceHandler handler);
 	/// Turns frame skipping on or off
 	void setFrameSkipping(bool skip);
+	/// Forgets the earliest deadline of the running timers.
+	static void resetDeadline();
+	/// Gets the time left until the earliest deadline.
+	static Uint32 getTimeToDeadline(Uint32 limit);
+	/// Gets how many times the timers have fired so far.
+	static unsigned int getFired();
 };
 
 }
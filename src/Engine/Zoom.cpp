@@ -26,8 +26,11 @@
 #include "Logger.h"
 #include "Options.h"
 #include "Screen.h"
+#include "ThreadPool.h"
 
 #include "OpenGL.h"
+#include <algorithm>
+#include <vector>
 
 // Scale2X
 #include "Scalers/scalebit.h"
@@ -597,21 +600,197 @@ bool Zoom::haveSSE2()
 
 #endif
 
+/// Source rows in each band of a zoom split over threads; a multiple of 4 keeps SSE2 rows aligned.
+static const int BAND_ROWS = 8;
+
+/**
+ * A zoom split into bands of source rows. Zooms either go through a
+ * function that can do a range of rows while looking at the rows around
+ * it, or through a plain zoomer that is handed each band as a surface.
+ * 8 bit sources can be expanded through a palette on the way, either
+ * straight into the destination or into the input of a row function.
+ */
+struct ZoomJob
+{
+	SDL_Surface *src, *dst;
+	int factor;
+	void (*rows)(SDL_Surface *src, SDL_Surface *dst, int first, int last);
+	int (*zoom)(SDL_Surface *src, SDL_Surface *dst);
+	const Uint32 *palette;
+};
+
+/**
+ * Maps the palette of an 8 bit surface to the pixel values of another format.
+ * @param src The 8 bit surface.
+ * @param format Format to map the colors to.
+ * @param palette Receives the 256 pixel values.
+ */
+static void mapPalette(SDL_Surface *src, SDL_PixelFormat *format, Uint32 *palette)
+{
+	SDL_Palette *colors = src->format->palette;
+	for (int i = 0; i < 256; ++i)
+	{
+		if (colors && i < colors->ncolors)
+			palette[i] = SDL_MapRGB(format, colors->colors[i].r, colors->colors[i].g, colors->colors[i].b);
+		else
+			palette[i] = SDL_MapRGB(format, 0, 0, 0);
+	}
+}
+
+/**
+ * Expands rows of an 8 bit surface to 32 bit pixels.
+ * @param src The 8 bit surface.
+ * @param palette Pixel values of the 256 colors.
+ * @param dest Where to put the first row.
+ * @param pitch Bytes between destination rows.
+ * @param first First row to expand.
+ * @param last Row after the last one to expand.
+ */
+static void expandRows(SDL_Surface *src, const Uint32 *palette, Uint8 *dest, int pitch, int first, int last)
+{
+	for (int y = first; y < last; ++y, dest += pitch)
+	{
+		const Uint8 *in = (const Uint8*)src->pixels + y * src->pitch;
+		Uint32 *out = (Uint32*)dest;
+		for (int x = 0; x < src->w; ++x)
+		{
+			out[x] = palette[in[x]];
+		}
+	}
+}
+
+static void hq2xRows(SDL_Surface *src, SDL_Surface *dst, int first, int last)
+{
+	hq2x_32_rb_rows((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h, first, last);
+}
+
+static void hq3xRows(SDL_Surface *src, SDL_Surface *dst, int first, int last)
+{
+	hq3x_32_rb_rows((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h, first, last);
+}
+
+static void hq4xRows(SDL_Surface *src, SDL_Surface *dst, int first, int last)
+{
+	hq4x_32_rb_rows((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h, first, last);
+}
+
+static void scaleRows(SDL_Surface *src, SDL_Surface *dst, int first, int last)
+{
+	scale_rows(dst->w / src->w, dst->pixels, dst->pitch, src->pixels, src->pitch, src->format->BytesPerPixel, src->w, src->h, first, last);
+}
+
+/**
+ * Zooms one band of a zoom job.
+ * @param context Pointer to the zoom job.
+ * @param index Index of the band.
+ */
+static void zoomBand(void *context, int index)
+{
+	ZoomJob *job = (ZoomJob*)context;
+	int first = index * BAND_ROWS;
+	int last = std::min(first + BAND_ROWS, job->src->h);
+	if (job->palette && !job->rows)
+	{
+		expandRows(job->src, job->palette, (Uint8*)job->dst->pixels + first * job->dst->pitch, job->dst->pitch, first, last);
+	}
+	else if (job->palette)
+	{
+		// expand the band and the rows right next to it, which is
+		// all the row function looks at, while it's still in the cache
+		int above = std::max(first - 1, 0);
+		int below = std::min(last + 1, job->src->h);
+		std::vector<Uint32> buffer(job->src->w * (below - above));
+		expandRows(job->src, job->palette, (Uint8*)&buffer[0], job->src->w * sizeof(Uint32), above, below);
+		SDL_Surface src = *job->src, dst = *job->dst;
+		src.format = job->dst->format;
+		src.pixels = &buffer[0];
+		src.pitch = src.w * sizeof(Uint32);
+		src.h = below - above;
+		dst.pixels = (Uint8*)dst.pixels + above * job->factor * dst.pitch;
+		dst.h = (below - above) * job->factor;
+		job->rows(&src, &dst, first - above, last - above);
+	}
+	else if (job->rows)
+	{
+		job->rows(job->src, job->dst, first, last);
+	}
+	else
+	{
+		SDL_Surface src = *job->src, dst = *job->dst;
+		src.pixels = (Uint8*)src.pixels + first * src.pitch;
+		src.h = last - first;
+		dst.pixels = (Uint8*)dst.pixels + first * job->factor * dst.pitch;
+		dst.h = (last - first) * job->factor;
+		job->zoom(&src, &dst);
+	}
+}
+
+/**
+ * Zooms a surface in bands of rows, spread over the threads of the pool.
+ * Every band writes its own rows of the destination, so the result
+ * is the same as zooming the whole surface at once.
+ * @param pool Pointer to the thread pool, or 0 to zoom on this thread.
+ * @param src The surface to zoom.
+ * @param dst The zoomed surface.
+ * @param rows Function zooming a range of rows, or 0.
+ * @param zoom Function zooming a whole surface, used if there is no row function.
+ * @param palette Pixel values to expand an 8 bit source with, or 0.
+ * @return 0 for success.
+ */
+static int zoomInBands(ThreadPool *pool, SDL_Surface *src, SDL_Surface *dst, void (*rows)(SDL_Surface*, SDL_Surface*, int, int), int (*zoom)(SDL_Surface*, SDL_Surface*) = 0, const Uint32 *palette = 0)
+{
+	ZoomJob job;
+	job.src = src;
+	job.dst = dst;
+	job.factor = dst->h / src->h;
+	job.rows = rows;
+	job.zoom = zoom;
+	job.palette = palette;
+	int bands = (src->h + BAND_ROWS - 1) / BAND_ROWS;
+	if (pool)
+	{
+		pool->run(zoomBand, &job, bands);
+	}
+	else
+	{
+		for (int i = 0; i < bands; ++i)
+		{
+			zoomBand(&job, i);
+		}
+	}
+	return 0;
+}
+
 /**
  * Wrapper around various software and OpenGL screen buffer pushing functions which zoom.
  * Basically called just from Screen::flip()
  */
-void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, OpenGL *glOut)
+void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, OpenGL *glOut, ThreadPool *pool)
 {
 	if (Screen::isOpenGLEnabled() && glOut->buffer_surface)
 	{
-		SDL_BlitSurface(src, 0, glOut->buffer_surface->getSurface(), 0); // TODO; this is less than ideal...
+		Uint32 *data;
+		unsigned pitch;
+		if (src->format->BytesPerPixel == 1 && glOut->lock(data, pitch))
+		{
+			// expand the palette straight into the texture buffer
+			Uint32 palette[256];
+			SDL_Surface buffer = *glOut->buffer_surface->getSurface();
+			buffer.pixels = data;
+			buffer.pitch = pitch;
+			mapPalette(src, buffer.format, palette);
+			zoomInBands(pool, src, &buffer, 0, 0, palette);
+		}
+		else
+		{
+			SDL_BlitSurface(src, 0, glOut->buffer_surface->getSurface(), 0);
+		}
 
 		glOut->refresh(glOut->linear, glOut->iwidth, glOut->iheight, dst->w, dst->h);
 		SDL_GL_SwapBuffers();
 	} else
 	{
-		_zoomSurfaceY(src, dst, 0, 0);
+		_zoomSurfaceY(src, dst, 0, 0, pool);
 	}
 }
 
@@ -628,9 +807,10 @@ void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, OpenGL *glOut)
  * @param dst The zoomed surface (output).
  * @param flipx Flag indicating if the image should be horizontally flipped.
  * @param flipy Flag indicating if the image should be vertically flipped.
+ * @param pool Thread pool to split the work over, if any.
  * @return 0 for success or -1 for error.
  */
-int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy)
+int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy, ThreadPool *pool)
 {
 	int x, y;
 	static Uint32 *sax, *say;
@@ -640,7 +820,7 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 	int dgap;
 	static bool proclaimed = false;
 
-	if (Options::getBool("useHQXFilter"))
+	if (Options::getBool("useHQXFilter") && dst->format->BytesPerPixel == 4)
 	{
 		static bool initDone = false;
 
@@ -650,48 +830,60 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 			initDone = true;
 		}
 
-		// HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
+		// 8 bit screens are expanded through the palette as the scaler reads them
+		Uint32 palette[256];
+		const Uint32 *expand = 0;
+		if (src->format->BytesPerPixel == 1)
+		{
+			mapPalette(src, dst->format, palette);
+			expand = palette;
+		}
 
 		if (dst->w == src->w * 2 && dst->h == src->h * 2)
 		{
-			hq2x_32_rb((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, hq2xRows, 0, expand);
 		}
 
 		if (dst->w == src->w * 3 && dst->h == src->h * 3)
 		{
-			hq3x_32_rb((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, hq3xRows, 0, expand);
 		}
 
 		if (dst->w == src->w * 4 && dst->h == src->h * 4)
 		{
-			hq4x_32_rb((uint32_t*) src->pixels, src->pitch, (uint32_t*) dst->pixels, dst->pitch, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, hq4xRows, 0, expand);
 		}
 
 	}
 
+	if (src->format->BytesPerPixel != dst->format->BytesPerPixel)
+	{
+		// the zoomers below need the same format on both sides
+		SDL_Surface *converted = SDL_ConvertSurface(src, dst->format, SDL_SWSURFACE);
+		if (converted == 0)
+			return -1;
+		int result = _zoomSurfaceY(converted, dst, flipx, flipy, pool);
+		SDL_FreeSurface(converted);
+		return result;
+	}
+
 	if (Options::getBool("useScaleFilter"))
 	{
 		// check the resolution to see which of scale2x, scale3x, etc. we need
 
 		if (dst->w == src->w * 2 && dst->h == src->h *2 && !scale_precondition(2, src->format->BytesPerPixel, src->w, src->h))
 		{
-			scale(2, dst->pixels, dst->pitch, src->pixels, src->pitch, src->format->BytesPerPixel, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, scaleRows);
 		}
 
 		if (dst->w == src->w * 3 && dst->h == src->h *3 && !scale_precondition(3, src->format->BytesPerPixel, src->w, src->h))
 		{
-			scale(3, dst->pixels, dst->pitch, src->pixels, src->pitch, src->format->BytesPerPixel, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, scaleRows);
 		}
 
 		if (dst->w == src->w * 4 && dst->h == src->h *4 && !scale_precondition(4, src->format->BytesPerPixel, src->w, src->h))
 		{
-			scale(4, dst->pixels, dst->pitch, src->pixels, src->pitch, src->format->BytesPerPixel, src->w, src->h);
-			return 0;
+			return zoomInBands(pool, src, dst, scaleRows);
 		}
 
 	}
@@ -708,8 +900,8 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 			!((ptrdiff_t)src->pixels % 16) && 
 			!((ptrdiff_t)dst->pixels % 16)) // alignment check
 		{
-			if (dst->w == src->w * 2 && dst->h == src->h * 2) return  zoomSurface2X_SSE2(src, dst);
-			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return  zoomSurface4X_SSE2(src, dst);
+			if (dst->w == src->w * 2 && dst->h == src->h * 2) return zoomInBands(pool, src, dst, 0, zoomSurface2X_SSE2);
+			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return zoomInBands(pool, src, dst, 0, zoomSurface4X_SSE2);
 		} else
 		{
 			static bool complained = false;
@@ -723,18 +915,18 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 
 // __WORDSIZE is defined on Linux, SIZE_MAX on Windows
 #if defined(__WORDSIZE) && (__WORDSIZE == 64) || defined(SIZE_MAX) && (SIZE_MAX > 0xFFFFFFFF)
-		if (dst->w == src->w * 2 && dst->h == src->h * 2) return  zoomSurface2X_64bit(src, dst);
-		else if (dst->w == src->w * 4 && dst->h == src->h * 4) return  zoomSurface4X_64bit(src, dst);
+		if (dst->w == src->w * 2 && dst->h == src->h * 2) return zoomInBands(pool, src, dst, 0, zoomSurface2X_64bit);
+		else if (dst->w == src->w * 4 && dst->h == src->h * 4) return zoomInBands(pool, src, dst, 0, zoomSurface4X_64bit);
 #else
 		if (sizeof(void *) == 8)
 		{
-			if (dst->w == src->w * 2 && dst->h == src->h * 2) return  zoomSurface2X_64bit(src, dst);
-			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return  zoomSurface4X_64bit(src, dst);
+			if (dst->w == src->w * 2 && dst->h == src->h * 2) return zoomInBands(pool, src, dst, 0, zoomSurface2X_64bit);
+			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return zoomInBands(pool, src, dst, 0, zoomSurface4X_64bit);
 		}
 		else
 		{
-			if (dst->w == src->w * 2 && dst->h == src->h * 2) return  zoomSurface2X_32bit(src, dst);
-			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return  zoomSurface4X_32bit(src, dst);
+			if (dst->w == src->w * 2 && dst->h == src->h * 2) return zoomInBands(pool, src, dst, 0, zoomSurface2X_32bit);
+			else if (dst->w == src->w * 4 && dst->h == src->h * 4) return zoomInBands(pool, src, dst, 0, zoomSurface4X_32bit);
 		}
 #endif
 
@@ -8,15 +8,16 @@
 namespace OpenXcom
 {
 
+class ThreadPool;
 
 class Zoom
 {
 
 	public:
 	/// Flip screen given src and dst; might use software or OpenGL.
-	static void flipWithZoom(SDL_Surface *src, SDL_Surface *dst, OpenGL *glOut);
+	static void flipWithZoom(SDL_Surface *src, SDL_Surface *dst, OpenGL *glOut, ThreadPool *pool = 0);
 	/// Copy src to dst, resizing as needed. Please don't use flipx or flipy as the optimized functions ignore these parameters.
-	static int _zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy);
+	static int _zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy, ThreadPool *pool = 0);
 	/// Check for SSE2 instructions using CPUID.
 	static bool haveSSE2(); 
 
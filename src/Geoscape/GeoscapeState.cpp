@@ -38,6 +38,7 @@
 #include "../Engine/Timer.h"
 #include "../Savegame/GameTime.h"
 #include "../Engine/Music.h"
+#include "../Engine/Profiler.h"
 #include "../Savegame/SavedGame.h"
 #include "../Ruleset/Ruleset.h"
 #include "../Savegame/Base.h"
@@ -97,6 +98,7 @@
 #include "DefeatState.h"
 #include <ctime>
 #include <algorithm>
+#include <climits>
 #include <functional>
 
 #include <assert.h>
@@ -537,6 +539,7 @@ void GeoscapeState::timeDisplay()
  */
 void GeoscapeState::timeAdvance()
 {
+	ProfileZone zone("GeoscapeState::timeAdvance");
 	int timeSpan = 0;
 	if (_timeSpeed == _btn5Secs)
 	{
@@ -563,10 +566,19 @@ void GeoscapeState::timeAdvance()
 		timeSpan = 12 * 5 * 6 * 2 * 24;
 	}
 
+	bool fastForward = Options::getBool("geoscapeFastForward") && timeSpan > 1;
+	int quietTicks = 0;
 	for (int i = 0; i < timeSpan && !_pause; ++i)
 	{
 		TimeTrigger trigger;
 		trigger = _game->getSavedGame()->getTime()->advance();
+		// nothing can happen before the next event but movement, so skip the checks
+		if (trigger == TIME_5SEC && quietTicks > 0)
+		{
+			moveTargets();
+			--quietTicks;
+			continue;
+		}
 		switch (trigger)
 		{
 		case TIME_1MONTH:
@@ -582,6 +594,10 @@ void GeoscapeState::timeAdvance()
 		case TIME_5SEC:
 			time5Seconds();
 		}
+		if (fastForward)
+		{
+			quietTicks = getQuietTicks();
+		}
 	}
 
 	_pause = false;
@@ -596,6 +612,7 @@ void GeoscapeState::timeAdvance()
  */
 void GeoscapeState::time5Seconds()
 {
+	ProfileZone zone("GeoscapeState::time5Seconds");
 	// Game over if there are no more bases.
 	if (_game->getSavedGame()->getBases()->size() == 0)
 	{
@@ -712,21 +729,13 @@ void GeoscapeState::time5Seconds()
 		{
 			if ((*j)->isDestroyed())
 			{
-				for(std::vector<Country*>::iterator country = _game->getSavedGame()->getCountries()->begin(); country != _game->getSavedGame()->getCountries()->end(); ++country)
+				if (Country *country = _game->getSavedGame()->locateCountry(**j))
 				{
-					if((*country)->getRules()->insideCountry((*j)->getLongitude(), (*j)->getLatitude()))
-					{
-						(*country)->addActivityXcom(-(*j)->getRules()->getScore());
-						break;
-					}
+					country->addActivityXcom(-(*j)->getRules()->getScore());
 				}
-				for(std::vector<Region*>::iterator region = _game->getSavedGame()->getRegions()->begin(); region != _game->getSavedGame()->getRegions()->end(); ++region)
+				if (Region *region = _game->getSavedGame()->locateRegion(**j))
 				{
-					if((*region)->getRules()->insideRegion((*j)->getLongitude(), (*j)->getLatitude()))
-					{
-						(*region)->addActivityXcom(-(*j)->getRules()->getScore());
-						break;
-					}
+					region->addActivityXcom(-(*j)->getRules()->getScore());
 				}
 
 				delete *j;
@@ -906,6 +915,118 @@ void GeoscapeState::time5Seconds()
 	}
 }
 
+/**
+ * Gets the number of 5-second steps a moving target can surely
+ * take without reaching its destination. Both ends are assumed
+ * to be heading straight at each other at full speed, with some
+ * margin for the rounding of the movement.
+ * @param target Pointer to the moving target.
+ * @return Number of steps, or -1 if it has to be checked right away.
+ */
+static int getStepsToDestination(const MovingTarget *target)
+{
+	const double poleLimit = 1.5;
+	Target *dest = target->getDestination();
+	if (dest == 0)
+	{
+		return INT_MAX;
+	}
+	if (target->reachedDestination() || std::abs(target->getLatitude()) > poleLimit || std::abs(dest->getLatitude()) > poleLimit)
+	{
+		return -1;
+	}
+	const double toRadian = (1 / 60.0) * (M_PI / 180) / 720.0;
+	double step = target->getSpeed() * toRadian;
+	if (const MovingTarget *moving = dynamic_cast<const MovingTarget*>(dest))
+	{
+		step += moving->getSpeed() * toRadian;
+	}
+	double distance = target->getDistance(dest);
+	if (step <= 0.0)
+	{
+		return distance > 0.0 ? INT_MAX : -1;
+	}
+	double steps = (distance - step) / (2 * step) - 1;
+	if (steps >= INT_MAX)
+	{
+		return INT_MAX;
+	}
+	return (int)std::floor(steps);
+}
+
+/**
+ * Works out how many 5-second steps will pass before anything but
+ * movement happens on the Geoscape, ie. no UFO or craft reaches its
+ * destination, no landed UFO lifts off and no crashed UFO expires.
+ * Those steps don't need the full time5Seconds() checks.
+ * @return Number of quiet steps, 0 if the next one needs checking.
+ */
+int GeoscapeState::getQuietTicks()
+{
+	SavedGame *save = _game->getSavedGame();
+	if (save->getBases()->empty() || _zoomInEffectTimer->isRunning() || _zoomOutEffectTimer->isRunning() || !_dogfights.empty() || !_dogfightsToBeStarted.empty())
+	{
+		return 0;
+	}
+
+	int ticks = INT_MAX;
+	for (std::vector<Ufo*>::iterator i = save->getUfos()->begin(); i != save->getUfos()->end(); ++i)
+	{
+		switch ((*i)->getStatus())
+		{
+		case Ufo::FLYING:
+			ticks = std::min(ticks, getStepsToDestination(*i));
+			break;
+		case Ufo::LANDED:
+			ticks = std::min(ticks, (*i)->getSecondsRemaining() / 5 - 1);
+			break;
+		case Ufo::CRASHED:
+			if ((*i)->getSecondsRemaining() == 0)
+				return 0;
+			break;
+		case Ufo::DESTROYED:
+			return 0;
+		}
+	}
+	for (std::vector<Base*>::iterator i = save->getBases()->begin(); i != save->getBases()->end(); ++i)
+	{
+		for (std::vector<Craft*>::iterator j = (*i)->getCrafts()->begin(); j != (*i)->getCrafts()->end(); ++j)
+		{
+			if ((*j)->isDestroyed() || (*j)->isInDogfight())
+				return 0;
+			Ufo *u = dynamic_cast<Ufo*>((*j)->getDestination());
+			if (u != 0 && (!u->getDetected() || u->getStatus() == Ufo::DESTROYED))
+				return 0;
+			ticks = std::min(ticks, getStepsToDestination(*j));
+		}
+	}
+	for (std::vector<Waypoint*>::iterator i = save->getWaypoints()->begin(); i != save->getWaypoints()->end(); ++i)
+	{
+		if ((*i)->getFollowers()->empty())
+			return 0;
+	}
+	return std::max(ticks, 0);
+}
+
+/**
+ * Runs a 5-second step where nothing but movement happens,
+ * in the same order as time5Seconds() would.
+ */
+void GeoscapeState::moveTargets()
+{
+	for (std::vector<Ufo*>::iterator i = _game->getSavedGame()->getUfos()->begin(); i != _game->getSavedGame()->getUfos()->end(); ++i)
+	{
+		(*i)->think();
+	}
+	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
+	{
+		for (std::vector<Craft*>::iterator j = (*i)->getCrafts()->begin(); j != (*i)->getCrafts()->end(); ++j)
+		{
+			(*j)->think();
+		}
+	}
+}
+
 /**
  * Functor that attempt to detect an XCOM base.
  */
@@ -961,6 +1082,7 @@ struct SetRetaliationTarget: public std::unary_function<std::map<const Region *,
  */
 void GeoscapeState::time10Minutes()
 {
+	ProfileZone zone("GeoscapeState::time10Minutes");
 	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
 	{
 		// Fuel consumption for XCOM craft.
@@ -1066,13 +1188,9 @@ bool GeoscapeState::processTerrorSite(TerrorSite *ts) const
 		region->addActivityAlien(1000);
 		//kids, tell your folks... don't ignore terror sites.
 	}
-	for (std::vector<Country*>::iterator k = _game->getSavedGame()->getCountries()->begin(); k != _game->getSavedGame()->getCountries()->end(); ++k)
+	if (Country *country = _game->getSavedGame()->locateCountry(*ts))
 	{
-		if ((*k)->getRules()->insideCountry(ts->getLongitude(), ts->getLatitude()))
-		{
-			(*k)->addActivityAlien(1000);
-			break;
-		}
+		country->addActivityAlien(1000);
 	}
 	delete ts;
 	return true;
@@ -1105,6 +1223,7 @@ struct expireCrashedUfo: public std::unary_function<Ufo*, void>
  */
 void GeoscapeState::time30Minutes()
 {
+	ProfileZone zone("GeoscapeState::time30Minutes");
 	// Decrease mission countdowns
 	std::for_each(_game->getSavedGame()->getAlienMissions().begin(),
 		      _game->getSavedGame()->getAlienMissions().end(),
@@ -1177,24 +1296,16 @@ void GeoscapeState::time30Minutes()
 		case Ufo::FLYING:
 			points++;
 			// Get area
-			for (std::vector<Region*>::iterator k = _game->getSavedGame()->getRegions()->begin(); k != _game->getSavedGame()->getRegions()->end(); ++k)
+			if (Region *region = _game->getSavedGame()->locateRegion(**u))
 			{
-				if ((*k)->getRules()->insideRegion((*u)->getLongitude(), (*u)->getLatitude()))
-				{
-					//one point per UFO in-flight per half hour
-					(*k)->addActivityAlien(points);
-					break;
-				}
+				//one point per UFO in-flight per half hour
+				region->addActivityAlien(points);
 			}
 			// Get country
-			for (std::vector<Country*>::iterator k = _game->getSavedGame()->getCountries()->begin(); k != _game->getSavedGame()->getCountries()->end(); ++k)
+			if (Country *country = _game->getSavedGame()->locateCountry(**u))
 			{
-				if ((*k)->getRules()->insideCountry((*u)->getLongitude(), (*u)->getLatitude()))
-				{
-					//one point per UFO in-flight per half hour
-					(*k)->addActivityAlien(points);
-					break;
-				}
+				//one point per UFO in-flight per half hour
+				country->addActivityAlien(points);
 			}
 			if (!(*u)->getDetected())
 			{
@@ -1277,6 +1388,7 @@ void GeoscapeState::time30Minutes()
  */
 void GeoscapeState::time1Hour()
 {
+	ProfileZone zone("GeoscapeState::time1Hour");
 	// Handle craft maintenance
 	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
 	{
@@ -1384,6 +1496,7 @@ void GenerateSupplyMission::operator()(const AlienBase *base) const
  */
 void GeoscapeState::time1Day()
 {
+	ProfileZone zone("GeoscapeState::time1Day");
 	for (std::vector<Base*>::iterator i = _game->getSavedGame()->getBases()->begin(); i != _game->getSavedGame()->getBases()->end(); ++i)
 	{
 		// Handle facility construction
@@ -1492,21 +1605,13 @@ void GeoscapeState::time1Day()
 	// handle regional and country points for alien bases
 	for(std::vector<AlienBase*>::const_iterator b = _game->getSavedGame()->getAlienBases()->begin(); b != _game->getSavedGame()->getAlienBases()->end(); ++b)
 	{
-		for (std::vector<Region*>::iterator k = _game->getSavedGame()->getRegions()->begin(); k != _game->getSavedGame()->getRegions()->end(); ++k)
+		if (Region *region = _game->getSavedGame()->locateRegion(**b))
 		{
-			if ((*k)->getRules()->insideRegion((*b)->getLongitude(), (*b)->getLatitude()))
-			{
-				(*k)->addActivityAlien(5);
-				break;
-			}
+			region->addActivityAlien(5);
 		}
-		for (std::vector<Country*>::iterator k = _game->getSavedGame()->getCountries()->begin(); k != _game->getSavedGame()->getCountries()->end(); ++k)
+		if (Country *country = _game->getSavedGame()->locateCountry(**b))
 		{
-			if ((*k)->getRules()->insideCountry((*b)->getLongitude(), (*b)->getLatitude()))
-			{
-				(*k)->addActivityAlien(5);
-				break;
-			}
+			country->addActivityAlien(5);
 		}
 	}
 
@@ -1521,6 +1626,7 @@ void GeoscapeState::time1Day()
  */
 void GeoscapeState::time1Month()
 {
+	ProfileZone zone("GeoscapeState::time1Month");
 	_game->getSavedGame()->addMonth();
 
 	int monthsPassed = _game->getSavedGame()->getMonthsPassed();
@@ -154,6 +154,10 @@ public:
 private:
 	/// Handle alien mission generation.
 	void determineAlienMissions(bool atGameStart = false);
+	/// Gets the number of upcoming steps with nothing but movement.
+	int getQuietTicks();
+	/// Moves the UFOs and craft for a step with nothing but movement.
+	void moveTargets();
 };
 
 }
@@ -18,6 +18,7 @@
  */
 #define _USE_MATH_DEFINES
 #include "Globe.h"
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include "../aresame.h"
@@ -46,17 +47,29 @@
 #include "../Savegame/Ufo.h"
 #include "../Savegame/Craft.h"
 #include "../Savegame/Waypoint.h"
+#include "../Savegame/AreaGrid.h"
 #include "../Engine/ShaderMove.h"
-#include "../Engine/ShaderRepeat.h"
 #include "../Engine/Options.h"
 #include "../Savegame/TerrorSite.h"
 #include "../Savegame/AlienBase.h"
 #include "../Engine/LocalizedText.h"
+#include "../Engine/Profiler.h"
 #include "../Savegame/BaseFacility.h"
 #include "../Ruleset/RuleBaseFacility.h"
 #include "../Ruleset/RuleCraft.h"
 #include "../Ruleset/Ruleset.h"
 
+#if (_MSC_VER >= 1400) || (defined(__MINGW32__) && defined(__SSE2__))
+#ifndef __SSE2__
+#define __SSE2__ true
+#endif
+#include <intrin.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace OpenXcom
 {
 
@@ -64,6 +77,8 @@ const double Globe::QUAD_LONGITUDE = 0.05;
 const double Globe::QUAD_LATITUDE = 0.2;
 const double Globe::ROTATE_LONGITUDE = 0.25;
 const double Globe::ROTATE_LATITUDE = 0.15;
+// the shade gradient is indexed by 250 times the cosine of the angle to the sun
+const double Globe::SHADE_STEP = 1 / 250.0;
 
 namespace
 {
@@ -231,12 +246,87 @@ struct CreateShadow
 		}
 	}
 	
-	static inline void func(Uint8& dest, const Cord& earth, const Cord& sun, const Sint16& noise, const int&)
+	/**
+	 * Gets how dark a point of the globe is, the part of
+	 * getShadowValue() that doesn't depend on the pixel color.
+	 * @param earth Normal of the point.
+	 * @param sun Direction of the sun.
+	 * @param noise Noise to subtract.
+	 * @return Shade from 0 (lit) to 31.
+	 */
+	static inline int getShade(const Cord& earth, const Cord& sun, const Sint16& noise)
 	{
-		if(dest && earth.z)
-			dest = getShadowValue(dest, earth, sun, noise);
+		double dx = earth.x - sun.x, dy = earth.y - sun.y, dz = earth.z - sun.z;
+		double t = (dx * dx + (dz * dz + dy * dy) - 2) * 125.;
+		if (t < -110)
+			t = -31;
+		else if (t > 120)
+			t = 50;
 		else
-			dest = 0;
+			t = static_data.shade_gradient[(Sint16)t + 120];
+		t -= noise;
+		if (t > 0.)
+			return (t > 31)? 31 : (Sint16)t;
+		return 0;
+	}
+
+	/**
+	 * Works out the cached shadow of a globe pixel for shadeRow().
+	 * @param earth Normal of the point, or 0 off the globe.
+	 * @param sun Direction of the sun.
+	 * @param noise Noise to subtract.
+	 * @param ocean Receives the ocean color of the pixel.
+	 * @param land Receives the shade to add to the land of the pixel.
+	 */
+	static inline void cachePixel(const Cord& earth, const Cord& sun, const Sint16& noise, Uint8 *ocean, Uint8 *land)
+	{
+		int shade = 0;
+		if (earth.z)
+			shade = getShade(earth, sun, noise);
+		*ocean = Palette::blockOffset(12) + shade;
+		*land = shade / 3;
+	}
+
+	/**
+	 * Shades a row of globe pixels with the cached shadow,
+	 * same as getShadowValue() for the pixels with a color.
+	 * @param dest Pixels to shade.
+	 * @param ocean Ocean color of each pixel.
+	 * @param land Shade to add to the land of each pixel.
+	 * @param width Number of pixels.
+	 */
+	static void shadeRow(Uint8 *dest, const Uint8 *ocean, const Uint8 *land, int width)
+	{
+		int i = 0;
+#ifdef __SSE2__
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i group = _mm_set1_epi8((char)helper::ColorGroup);
+		const __m128i shade = _mm_set1_epi8(helper::ColorShade);
+		const __m128i ocean1 = _mm_set1_epi8((char)Palette::blockOffset(12));
+		const __m128i ocean2 = _mm_set1_epi8((char)Palette::blockOffset(13));
+		for (; i + 16 <= width; i += 16)
+		{
+			__m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+			__m128i g = _mm_and_si128(d, group);
+			__m128i isOcean = _mm_or_si128(_mm_cmpeq_epi8(g, ocean1), _mm_cmpeq_epi8(g, ocean2));
+			// land gets darker up to the last shade of its color
+			__m128i l = _mm_min_epu8(_mm_adds_epu8(d, _mm_loadu_si128((const __m128i*)(land + i))), _mm_or_si128(g, shade));
+			__m128i o = _mm_loadu_si128((const __m128i*)(ocean + i));
+			__m128i r = _mm_or_si128(_mm_and_si128(isOcean, o), _mm_andnot_si128(isOcean, l));
+			r = _mm_andnot_si128(_mm_cmpeq_epi8(d, zero), r);
+			_mm_storeu_si128((__m128i*)(dest + i), r);
+		}
+#endif
+		for (; i < width; ++i)
+		{
+			const int d = dest[i] & helper::ColorGroup;
+			if (dest[i] == 0)
+				continue;
+			if (d == Palette::blockOffset(12) || d == Palette::blockOffset(13))
+				dest[i] = ocean[i];
+			else
+				dest[i] = std::min(dest[i] + land[i], d + helper::ColorShade);
+		}
 	}
 };
 
@@ -257,7 +347,7 @@ Globe::Globe(Game *game, int cenX, int cenY, int width, int height, int x, int y
 	InteractiveSurface(width, height, x, y),
 	_rotLon(0.0), _rotLat(0.0),
 	_cenX(cenX), _cenY(cenY), _game(game),
-	_blink(true), _hover(false), _cacheLand()
+	_blink(true), _hover(false), _detailCached(false), _shadowCached(false)
 {
 	_texture = new SurfaceSet(*_game->getResourcePack()->getSurfaceSet("TEXTURE.DAT"));
 
@@ -392,6 +482,8 @@ Globe::Globe(Game *game, int cenX, int cenY, int width, int height, int x, int y
 	for(unsigned int i=0; i<_randomNoiseData.size(); ++i)
 		_randomNoiseData[i] = rand()%4;
 
+	indexPolygons();
+	loadGeometry();
 	cachePolygons();
 }
 
@@ -417,11 +509,7 @@ Globe::~Globe()
 	delete _mkAlienSite;
 	delete _radars;
 	delete _clipper;
-
-	for (std::list<Polygon*>::iterator i = _cacheLand.begin(); i != _cacheLand.end(); ++i)
-	{
-		delete *i;
-	}
+	delete _landGrid;
 }
 
 /**
@@ -547,6 +635,254 @@ bool Globe::insidePolygon(double lon, double lat, Polygon *poly) const
 	return odd;
 }
 
+/**
+ * Puts all the land polygons on a lon/lat grid, so finding the
+ * polygon under a point only has to check the few nearby ones.
+ * Each polygon is filed under the box around its edges, with some
+ * margin since the edges are great circles that bulge towards the poles.
+ * Polygons around a pole get the whole band up to that pole.
+ */
+void Globe::indexPolygons()
+{
+	const int samples = 8;
+	const double margin = 0.5 * M_PI / 180, poleLimit = 85 * M_PI / 180;
+	_landGrid = new AreaGrid();
+	_landPolygons.assign(_game->getResourcePack()->getPolygons()->begin(), _game->getResourcePack()->getPolygons()->end());
+	for (std::vector<Polygon*>::iterator i = _landPolygons.begin(); i != _landPolygons.end(); ++i)
+	{
+		std::vector<double> lons;
+		double latMin = M_PI, latMax = -M_PI, latSum = 0;
+		for (int j = 0; j < (*i)->getPoints(); ++j)
+		{
+			int k = (j + 1) % (*i)->getPoints();
+			double x1 = cos((*i)->getLatitude(j)) * cos((*i)->getLongitude(j));
+			double y1 = cos((*i)->getLatitude(j)) * sin((*i)->getLongitude(j));
+			double z1 = sin((*i)->getLatitude(j));
+			double x2 = cos((*i)->getLatitude(k)) * cos((*i)->getLongitude(k));
+			double y2 = cos((*i)->getLatitude(k)) * sin((*i)->getLongitude(k));
+			double z2 = sin((*i)->getLatitude(k));
+			for (int s = 0; s < samples; ++s)
+			{
+				// points along the chord project back onto the great circle edge
+				double t = (double)s / samples;
+				double x = x1 + (x2 - x1) * t, y = y1 + (y2 - y1) * t, z = z1 + (z2 - z1) * t;
+				double lon = atan2(y, x), lat = atan2(z, sqrt(x * x + y * y));
+				lons.push_back(lon < 0 ? lon + 2 * M_PI : lon);
+				latMin = std::min(latMin, lat);
+				latMax = std::max(latMax, lat);
+				latSum += lat;
+			}
+		}
+		if (lons.empty())
+			continue;
+
+		// the edges either stay on one side of longitude 0 or cross it
+		double lonMin = *std::min_element(lons.begin(), lons.end()), lonMax = *std::max_element(lons.begin(), lons.end());
+		double wrapMin = 2 * M_PI, wrapMax = 0;
+		for (std::vector<double>::iterator j = lons.begin(); j != lons.end(); ++j)
+		{
+			if (*j > M_PI)
+				wrapMin = std::min(wrapMin, *j);
+			else
+				wrapMax = std::max(wrapMax, *j);
+		}
+		if (wrapMax + 2 * M_PI - wrapMin < lonMax - lonMin)
+		{
+			lonMin = wrapMin;
+			lonMax = wrapMax;
+		}
+		double span = lonMax - lonMin;
+		if (span < 0)
+			span += 2 * M_PI;
+
+		latMin -= margin;
+		latMax += margin;
+		double lonMargin = margin / cos(std::min(std::max(-latMin, latMax), poleLimit));
+		if (span > M_PI || latMin < -poleLimit || latMax > poleLimit || span + 2 * lonMargin >= 2 * M_PI)
+		{
+			lonMin = 0;
+			lonMax = 2 * M_PI;
+			if (span > M_PI)
+			{
+				// goes all the way around, so it has to contain a pole
+				if (latSum < 0)
+					latMin = -M_PI / 2;
+				else
+					latMax = M_PI / 2;
+			}
+		}
+		else
+		{
+			lonMin -= lonMargin;
+			lonMax += lonMargin;
+			if (lonMin < 0)
+				lonMin += 2 * M_PI;
+			if (lonMax >= 2 * M_PI)
+				lonMax -= 2 * M_PI;
+		}
+		_landGrid->add(std::vector<double>(1, lonMin), std::vector<double>(1, lonMax), std::vector<double>(1, latMin), std::vector<double>(1, latMax));
+	}
+}
+
+/**
+ * Adds a polar point to the set, converted to unit sphere coordinates.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ */
+void GlobePoints::add(double lon, double lat)
+{
+	this->lon.push_back(lon);
+	this->lat.push_back(lat);
+	x.push_back(cos(lat) * cos(lon));
+	y.push_back(cos(lat) * sin(lon));
+	z.push_back(sin(lat));
+}
+
+/**
+ * Loads the points of the land polygons, country borders, country
+ * labels and cities into flat arrays, so each view of the globe
+ * can project them all in one go without any trigonometry.
+ */
+void Globe::loadGeometry()
+{
+	for (std::vector<Polygon*>::iterator i = _landPolygons.begin(); i != _landPolygons.end(); ++i)
+	{
+		_landStarts.push_back(_landPoints.x.size());
+		for (int j = 0; j < (*i)->getPoints(); ++j)
+		{
+			_landPoints.add((*i)->getLongitude(j), (*i)->getLatitude(j));
+		}
+	}
+	_landStarts.push_back(_landPoints.x.size());
+
+	for (std::list<Polyline*>::iterator i = _game->getResourcePack()->getPolylines()->begin(); i != _game->getResourcePack()->getPolylines()->end(); ++i)
+	{
+		_borderStarts.push_back(_borderPoints.x.size());
+		for (int j = 0; j < (*i)->getPoints(); ++j)
+		{
+			_borderPoints.add((*i)->getLongitude(j), (*i)->getLatitude(j));
+		}
+	}
+	_borderStarts.push_back(_borderPoints.x.size());
+
+	for (std::vector<Country*>::iterator i = _game->getSavedGame()->getCountries()->begin(); i != _game->getSavedGame()->getCountries()->end(); ++i)
+	{
+		_labelCountries.push_back(*i);
+		_labelPoints.add((*i)->getRules()->getLabelLongitude(), (*i)->getRules()->getLabelLatitude());
+	}
+
+	for (std::vector<Region*>::iterator i = _game->getSavedGame()->getRegions()->begin(); i != _game->getSavedGame()->getRegions()->end(); ++i)
+	{
+		for (std::vector<City*>::iterator j = (*i)->getRules()->getCities()->begin(); j != (*i)->getRules()->getCities()->end(); ++j)
+		{
+			_cities.push_back(*j);
+			_cityPoints.add((*j)->getLongitude(), (*j)->getLatitude());
+		}
+	}
+}
+
+/**
+ * Projects a set of points onto the screen for the current view,
+ * same as polarToCart() and pointBack() but in a single pass of
+ * plain arithmetic. The few points that land right on a pixel edge
+ * or the horizon are redone with their formulas, so the results
+ * always match.
+ * @param points Pointer to the set of points.
+ */
+void Globe::projectPoints(GlobePoints *points) const
+{
+	size_t n = points->x.size();
+	points->screenX.resize(n);
+	points->screenY.resize(n);
+	points->front.resize(n);
+	if (n == 0)
+		return;
+
+	const double EDGE = 1e-9;
+	const double radius = _radius[_zoom];
+	const double cosLon = cos(_cenLon), sinLon = sin(_cenLon), cosLat = cos(_cenLat), sinLat = sin(_cenLat);
+	const double *x = &points->x[0], *y = &points->y[0], *z = &points->z[0];
+	Sint16 *screenX = &points->screenX[0], *screenY = &points->screenY[0];
+	Uint8 *front = &points->front[0];
+	for (size_t i = 0; i < n; ++i)
+	{
+		// rotate the point so the center of the view is straight ahead
+		double east = y[i] * cosLon - x[i] * sinLon;
+		double ahead = x[i] * cosLon + y[i] * sinLon;
+		double north = cosLat * z[i] - sinLat * ahead;
+		double side = cosLat * ahead + sinLat * z[i];
+		double projX = radius * east, projY = radius * north;
+		double pixelX = floor(projX), pixelY = floor(projY);
+		screenX[i] = _cenX + (Sint16)pixelX;
+		screenY[i] = _cenY + (Sint16)pixelY;
+		front[i] = (side >= 0);
+		// the rotation rounds differently from polarToCart() and pointBack(),
+		// so points right on a pixel edge or the horizon use their formulas
+		if (projX - pixelX < EDGE || pixelX + 1 - projX < EDGE || projY - pixelY < EDGE || pixelY + 1 - projY < EDGE || fabs(side) < EDGE)
+		{
+			polarToCart(points->lon[i], points->lat[i], &screenX[i], &screenY[i]);
+			front[i] = !pointBack(points->lon[i], points->lat[i]);
+		}
+	}
+}
+
+/**
+ * Finds the first land polygon that contains a polar point,
+ * only checking the polygons filed near it.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ * @return Pointer to the polygon, or 0 if it's in the ocean.
+ */
+Polygon *Globe::locatePolygon(double lon, double lat) const
+{
+	Polygon *found = 0;
+	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
+	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
+	double oldLon = _cenLon, oldLat = _cenLat;
+	globe->_cenLon = lon;
+	globe->_cenLat = lat;
+	double gridLon = lon - floor(lon / (2 * M_PI)) * 2 * M_PI;
+	const std::vector<int> &candidates = _landGrid->getCandidates(gridLon, lat);
+	for (std::vector<int>::const_iterator i = candidates.begin(); i != candidates.end() && found == 0; ++i)
+	{
+		if (insidePolygon(lon, lat, _landPolygons[*i]))
+		{
+			found = _landPolygons[*i];
+		}
+	}
+	globe->_cenLon = oldLon;
+	globe->_cenLat = oldLat;
+	return found;
+}
+
+/**
+ * Finds the first land polygon that contains a polar point
+ * by checking every one of them, which is what locatePolygon()
+ * has to agree with.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ * @return Pointer to the polygon, or 0 if it's in the ocean.
+ */
+Polygon *Globe::scanPolygons(double lon, double lat) const
+{
+	Polygon *found = 0;
+	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
+	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
+	double oldLon = _cenLon, oldLat = _cenLat;
+	globe->_cenLon = lon;
+	globe->_cenLat = lat;
+	for (std::vector<Polygon*>::const_iterator i = _landPolygons.begin(); i != _landPolygons.end() && found == 0; ++i)
+	{
+		if (insidePolygon(lon, lat, *i))
+		{
+			found = *i;
+		}
+	}
+	globe->_cenLon = oldLon;
+	globe->_cenLat = oldLat;
+	return found;
+}
+
 /**
  * Loads a series of map polar coordinates in X-Com format,
  * converts them and stores them in a set of polygons.
@@ -717,19 +1053,7 @@ void Globe::center(double lon, double lat)
  */
 bool Globe::insideLand(double lon, double lat) const
 {
-	bool inside = false;
-	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
-	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
-	double oldLon = _cenLon, oldLat = _cenLat;
-	globe->_cenLon = lon;
-	globe->_cenLat = lat;
-	for (std::list<Polygon*>::iterator i = _game->getResourcePack()->getPolygons()->begin(); i != _game->getResourcePack()->getPolygons()->end() && !inside; ++i)
-	{
-		inside = insidePolygon(lon, lat, *i);
-	}
-	globe->_cenLon = oldLon;
-	globe->_cenLat = oldLat;
-	return inside;
+	return locatePolygon(lon, lat) != 0;
 }
 
 /**
@@ -739,6 +1063,7 @@ bool Globe::insideLand(double lon, double lat) const
 void Globe::toggleDetail()
 {
 	_game->getSavedGame()->toggleDetail();
+	_detailCached = false;
 	drawDetail();
 }
 
@@ -836,55 +1161,33 @@ std::vector<Target*> Globe::getTargets(int x, int y, bool craft) const
 }
 
 /**
- * Takes care of pre-calculating all the polygons currently visible
- * on the globe and caching them so they only need to be recalculated
- * when the globe is actually moved.
+ * Takes care of pre-calculating the screen positions of everything
+ * on the globe and which polygons are visible, so they only need
+ * to be recalculated when the globe is actually moved.
  */
 void Globe::cachePolygons()
 {
-	cache(_game->getResourcePack()->getPolygons(), &_cacheLand);
-	_redraw = true;
-}
+	projectPoints(&_landPoints);
+	projectPoints(&_borderPoints);
+	projectPoints(&_labelPoints);
+	projectPoints(&_cityPoints);
 
-/**
- * Caches a set of polygons.
- * @param polygons Pointer to list of polygons.
- * @param cache Pointer to cache.
- */
-void Globe::cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache)
-{
-	// Clear existing cache
-	for (std::list<Polygon*>::iterator i = cache->begin(); i != cache->end(); ++i)
-	{
-		delete *i;
-	}
-	cache->clear();
-
-	// Pre-calculate values to cache
-	for (std::list<Polygon*>::iterator i = polygons->begin(); i != polygons->end(); ++i)
+	_visibleLand.clear();
+	for (size_t i = 0; i + 1 < _landStarts.size(); ++i)
 	{
 		// Is quad on the back face?
-		bool backFace = true;
-		for (int j = 0; j < (*i)->getPoints(); ++j)
-		{
-			backFace = backFace && pointBack((*i)->getLongitude(j), (*i)->getLatitude(j));
-		}
-		if (backFace)
-			continue;
-
-		Polygon* p = new Polygon(**i);
-
-		// Convert coordinates
-		for (int j = 0; j < p->getPoints(); ++j)
+		for (int j = _landStarts[i]; j < _landStarts[i + 1]; ++j)
 		{
-			Sint16 x, y;
-			polarToCart(p->getLongitude(j), p->getLatitude(j), &x, &y);
-			p->setX(j, x);
-			p->setY(j, y);
+			if (_landPoints.front[j])
+			{
+				_visibleLand.push_back(i);
+				break;
+			}
 		}
-
-		cache->push_back(p);
 	}
+	_detailCached = false;
+	_shadowCached = false;
+	_redraw = true;
 }
 
 /**
@@ -966,6 +1269,7 @@ void Globe::rotate()
  */
 void Globe::draw()
 {
+	ProfileZone zone("Globe::draw");
 	Surface::draw();
 	drawOcean();
 	drawLand();
@@ -998,18 +1302,19 @@ void Globe::drawLand()
 {
 	Sint16 x[4], y[4];
 
-	for (std::list<Polygon*>::iterator i = _cacheLand.begin(); i != _cacheLand.end(); ++i)
+	for (std::vector<int>::iterator i = _visibleLand.begin(); i != _visibleLand.end(); ++i)
 	{
 		// Convert coordinates
-		for (int j = 0; j < (*i)->getPoints(); ++j)
+		int start = _landStarts[*i], points = _landStarts[*i + 1] - start;
+		for (int j = 0; j < points; ++j)
 		{
-			x[j] = (*i)->getX(j);
-			y[j] = (*i)->getY(j);
+			x[j] = _landPoints.screenX[start + j];
+			y[j] = _landPoints.screenY[start + j];
 		}
 
 		// Apply textures according to zoom and shade
 		int zoom = (2 - (int)floor(_zoom / 2.0)) * NUM_TEXTURES;
-		drawTexturedPolygon(x, y, (*i)->getPoints(), _texture->getFrame((*i)->getTexture() + zoom), 0, 0);
+		drawTexturedPolygon(x, y, points, _texture->getFrame(_landPolygons[*i]->getTexture() + zoom), 0, 0);
 	}
 }
 
@@ -1068,18 +1373,122 @@ Cord Globe::getSunDirection(double lon, double lat) const
 	return sun_direction;
 }
 
+/**
+ * Shades a globe pixel directly, the way drawShadow() did before the
+ * shadow was cached. Used to check the cache against.
+ * @param dest Color of the pixel.
+ * @param earth Normal of the point, or 0 off the globe.
+ * @param sun Direction of the sun.
+ * @param noise Noise to subtract.
+ * @return Shaded color.
+ */
+Uint8 Globe::getShadowPixel(Uint8 dest, const Cord &earth, const Cord &sun, Sint16 noise)
+{
+	if (dest && earth.z)
+		return CreateShadow::getShadowValue(dest, earth, sun, noise);
+	return 0;
+}
+
+/**
+ * Works out the cached shadow of a globe pixel, like cacheShadow() does.
+ * @param earth Normal of the point, or 0 off the globe.
+ * @param sun Direction of the sun.
+ * @param noise Noise to subtract.
+ * @param ocean Receives the ocean color of the pixel.
+ * @param land Receives the shade to add to the land of the pixel.
+ */
+void Globe::cacheShadowPixel(const Cord &earth, const Cord &sun, Sint16 noise, Uint8 *ocean, Uint8 *land)
+{
+	CreateShadow::cachePixel(earth, sun, noise, ocean, land);
+}
+
+/**
+ * Shades a row of globe pixels with their cached shadow,
+ * like drawShadow() does.
+ * @param dest Pixels to shade.
+ * @param ocean Ocean color of each pixel.
+ * @param land Shade to add to the land of each pixel.
+ * @param width Number of pixels.
+ */
+void Globe::shadeShadowRow(Uint8 *dest, const Uint8 *ocean, const Uint8 *land, int width)
+{
+	CreateShadow::shadeRow(dest, ocean, land, width);
+}
 
 void Globe::drawShadow()
 {
-	ShaderMove<Cord> earth = ShaderMove<Cord>(_earthData[_zoom], getWidth(), getHeight());
-	ShaderRepeat<Sint16> noise = ShaderRepeat<Sint16>(_randomNoiseData, static_data.random_surf_size, static_data.random_surf_size);
-	
-	earth.setMove(_cenX-getWidth()/2, _cenY-getHeight()/2);
-	
+	Cord sun = getSunDirection(_cenLon, _cenLat);
+	Cord moved = sun;
+	moved -= _shadowSun;
+	if (!_shadowCached || moved.x * moved.x + moved.y * moved.y + moved.z * moved.z > SHADE_STEP * SHADE_STEP)
+	{
+		cacheShadow(sun);
+	}
+
 	lock();
-	ShaderDraw<CreateShadow>(ShaderSurface(this), earth, ShaderScalar(getSunDirection(_cenLon, _cenLat)), noise);
+	for (int y = 0; y < getHeight(); ++y)
+	{
+		const int *span = &_shadowSpans[y * 4];
+		Uint8 *row = (Uint8*)_surface->pixels + y * _surface->pitch;
+		// off the globe there's no shadow, just nothing
+		std::fill(row + span[0], row + span[2], 0);
+		CreateShadow::shadeRow(row + span[2], &_shadowOcean[y * getWidth() + span[2]], &_shadowLand[y * getWidth() + span[2]], span[3] - span[2]);
+		std::fill(row + span[3], row + span[1], 0);
+	}
 	unlock();
-		
+}
+
+/**
+ * Calculates the shadow of every pixel of the globe for the current
+ * zoom and sun direction, so it only has to be applied on each redraw
+ * until the sun moves by more than a shade step. Works out the same
+ * as the CreateShadow shader, covering only the part of each row
+ * that is actually on the globe.
+ * @param sun Direction of the sun.
+ */
+void Globe::cacheShadow(const Cord &sun)
+{
+	const int width = getWidth(), height = getHeight();
+	const int noiseSize = static_data.random_surf_size;
+	// offset of the earth data, _cenX and _cenY are relative to the surface
+	const int moveX = _cenX - width / 2, moveY = _cenY - height / 2;
+	const std::vector<Cord> &earth = _earthData[_zoom];
+
+	_shadowOcean.assign(width * height, Palette::blockOffset(12));
+	_shadowLand.assign(width * height, 0);
+	_shadowSpans.assign(height * 4, 0);
+	for (int y = 0; y < height; ++y)
+	{
+		int *span = &_shadowSpans[y * 4];
+		int ey = y - moveY;
+		if (ey < 0 || ey >= height)
+			continue;
+		// columns covered by the earth data, and by the globe itself
+		span[0] = std::max(0, moveX);
+		span[1] = std::min(width, width + moveX);
+		span[2] = span[1];
+		span[3] = span[1];
+		const int earthRow = ey * width - moveX;
+		for (int x = span[0]; x < span[1]; ++x)
+		{
+			if (earth[earthRow + x].z)
+			{
+				if (span[2] == span[1])
+					span[2] = x;
+				span[3] = x + 1;
+			}
+		}
+		if (span[2] == span[1])
+			span[2] = span[3] = span[0];
+
+		const Sint16 *noiseRow = &_randomNoiseData[(y % noiseSize) * noiseSize];
+		for (int x = span[2]; x < span[3]; ++x)
+		{
+			CreateShadow::cachePixel(earth[earthRow + x], sun, noiseRow[x % noiseSize], &_shadowOcean[y * width + x], &_shadowLand[y * width + x]);
+		}
+	}
+	_shadowSun = sun;
+	_shadowCached = true;
 }
 
 
@@ -1335,6 +1744,10 @@ void Globe::drawVHLine(double lon1, double lat1, double lon2, double lat2, int c
  */
 void Globe::drawDetail()
 {
+	// Nothing to redraw until the view changes, the debug overlay is redrawn every time
+	if (_detailCached && !_game->getSavedGame()->getDebugMode())
+		return;
+
 	_countries->clear();
 
 	if (!_game->getSavedGame()->getDetail())
@@ -1346,20 +1759,15 @@ void Globe::drawDetail()
 		// Lock the surface
 		_countries->lock();
 
-		for (std::list<Polyline*>::iterator i = _game->getResourcePack()->getPolylines()->begin(); i != _game->getResourcePack()->getPolylines()->end(); ++i)
+		for (size_t i = 0; i + 1 < _borderStarts.size(); ++i)
 		{
-			Sint16 x[2], y[2];
-			for (int j = 0; j < (*i)->getPoints() - 1; ++j)
+			for (int j = _borderStarts[i]; j < _borderStarts[i + 1] - 1; ++j)
 			{
 				// Don't draw if polyline is facing back
-				if (pointBack((*i)->getLongitude(j), (*i)->getLatitude(j)) || pointBack((*i)->getLongitude(j + 1), (*i)->getLatitude(j + 1)))
+				if (!_borderPoints.front[j] || !_borderPoints.front[j + 1])
 					continue;
 
-				// Convert coordinates
-				polarToCart((*i)->getLongitude(j), (*i)->getLatitude(j), &x[0], &y[0]);
-				polarToCart((*i)->getLongitude(j + 1), (*i)->getLatitude(j + 1), &x[1], &y[1]);
-
-				_countries->drawLine(x[0], y[0], x[1], y[1], Palette::blockOffset(10)+2);
+				_countries->drawLine(_borderPoints.screenX[j], _borderPoints.screenY[j], _borderPoints.screenX[j + 1], _borderPoints.screenY[j + 1], Palette::blockOffset(10)+2);
 			}
 		}
 
@@ -1376,19 +1784,15 @@ void Globe::drawDetail()
 		label->setAlign(ALIGN_CENTER);
 		label->setColor(Palette::blockOffset(15)-1);
 
-		Sint16 x, y;
-		for (std::vector<Country*>::iterator i = _game->getSavedGame()->getCountries()->begin(); i != _game->getSavedGame()->getCountries()->end(); ++i)
+		for (size_t i = 0; i < _labelCountries.size(); ++i)
 		{
 			// Don't draw if label is facing back
-			if (pointBack((*i)->getRules()->getLabelLongitude(), (*i)->getRules()->getLabelLatitude()))
+			if (!_labelPoints.front[i])
 				continue;
 
-			// Convert coordinates
-			polarToCart((*i)->getRules()->getLabelLongitude(), (*i)->getRules()->getLabelLatitude(), &x, &y);
-
-			label->setX(x - 40);
-			label->setY(y);
-			label->setText(_game->getLanguage()->getString((*i)->getRules()->getType()));
+			label->setX(_labelPoints.screenX[i] - 40);
+			label->setY(_labelPoints.screenY[i]);
+			label->setText(_game->getLanguage()->getString(_labelCountries[i]->getRules()->getType()));
 			label->blit(_countries);
 		}
 
@@ -1404,28 +1808,22 @@ void Globe::drawDetail()
 		label->setAlign(ALIGN_CENTER);
 		label->setColor(Palette::blockOffset(8)+10);
 
-		Sint16 x, y;
-		for (std::vector<Region*>::iterator i = _game->getSavedGame()->getRegions()->begin(); i != _game->getSavedGame()->getRegions()->end(); ++i)
+		for (size_t i = 0; i < _cities.size(); ++i)
 		{
-			for (std::vector<City*>::iterator j = (*i)->getRules()->getCities()->begin(); j != (*i)->getRules()->getCities()->end(); ++j)
-			{
-				// Don't draw if city is facing back
-				if (pointBack((*j)->getLongitude(), (*j)->getLatitude()))
-					continue;
-
-				// Convert coordinates
-				polarToCart((*j)->getLongitude(), (*j)->getLatitude(), &x, &y);
+			// Don't draw if city is facing back
+			if (!_cityPoints.front[i])
+				continue;
 
-				_mkCity->setX(x - 1);
-				_mkCity->setY(y - 1);
-				_mkCity->setPalette(getPalette());
-				_mkCity->blit(_countries);
+			Sint16 x = _cityPoints.screenX[i], y = _cityPoints.screenY[i];
+			_mkCity->setX(x - 1);
+			_mkCity->setY(y - 1);
+			_mkCity->setPalette(getPalette());
+			_mkCity->blit(_countries);
 
-				label->setX(x - 40);
-				label->setY(y + 2);
-				label->setText(_game->getLanguage()->getString((*j)->getName()));
-				label->blit(_countries);
-			}
+			label->setX(x - 40);
+			label->setY(y + 2);
+			label->setText(_game->getLanguage()->getString(_cities[i]->getName()));
+			label->blit(_countries);
 		}
 
 		delete label;
@@ -1487,6 +1885,8 @@ void Globe::drawDetail()
 			canSwitchDebugType = false;
 		}
 	}
+	// The debug overlay has to be redrawn every time to pick up the switch
+	_detailCached = !_game->getSavedGame()->getDebugMode();
 }
 
 /**
@@ -1711,21 +2111,10 @@ void Globe::getPolygonTextureAndShade(double lon, double lat, int *texture, int
 	*texture = -1;
 	*shade = worldshades[ CreateShadow::getShadowValue(0, Cord(0.,0.,1.), getSunDirection(lon, lat), 0) ];
 
-	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
-	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
-	double oldLon = _cenLon, oldLat = _cenLat;
-	globe->_cenLon = lon;
-	globe->_cenLat = lat;
-	for (std::list<Polygon*>::iterator i = _game->getResourcePack()->getPolygons()->begin(); i != _game->getResourcePack()->getPolygons()->end(); ++i)
+	if (Polygon *poly = locatePolygon(lon, lat))
 	{
-		if (insidePolygon(lon, lat, *i))
-		{
-			*texture = (*i)->getTexture();
-			break;
-		}
+		*texture = poly->getTexture();
 	}
-	globe->_cenLon = oldLon;
-	globe->_cenLat = oldLat;
 }
 
 /**
@@ -34,6 +34,23 @@ class SurfaceSet;
 class Timer;
 class Target;
 class LocalizedText;
+class AreaGrid;
+class Country;
+class City;
+
+/**
+ * Points on the world map kept as flat arrays of polar coordinates
+ * and coordinates on the unit sphere, along with where they end up
+ * on the screen for the current view of the globe.
+ */
+struct GlobePoints
+{
+	std::vector<double> lon, lat, x, y, z;
+	std::vector<Sint16> screenX, screenY;
+	std::vector<Uint8> front;
+	/// Adds a polar point.
+	void add(double lon, double lat);
+};
 
 /**
  * Interactive globe view of the world.
@@ -52,6 +69,7 @@ private:
 	static const double QUAD_LATITUDE;
 	static const double ROTATE_LONGITUDE;
 	static const double ROTATE_LATITUDE;
+	static const double SHADE_STEP;
 
 	double _cenLon, _cenLat, _rotLon, _rotLat, _hoverLon, _hoverLat;
 	Sint16 _cenX, _cenY;
@@ -61,7 +79,18 @@ private:
 	Surface *_markers, *_countries, *_radars;
 	bool _blink, _hover;
 	Timer *_blinkTimer, *_rotTimer;
-	std::list<Polygon*> _cacheLand;
+	AreaGrid *_landGrid;
+	std::vector<Polygon*> _landPolygons;
+	GlobePoints _landPoints, _borderPoints, _labelPoints, _cityPoints;
+	std::vector<int> _landStarts, _borderStarts, _visibleLand;
+	std::vector<Country*> _labelCountries;
+	std::vector<City*> _cities;
+	bool _detailCached;
+	///cached shadow of each pixel, as ocean colors and land shades, and which columns of each row are on the globe
+	std::vector<Uint8> _shadowOcean, _shadowLand;
+	std::vector<int> _shadowSpans;
+	Cord _shadowSun;
+	bool _shadowCached;
 	Surface *_mkXcomBase, *_mkAlienBase, *_mkCraft, *_mkWaypoint, *_mkCity;
 	Surface *_mkFlyingUfo, *_mkLandedUfo, *_mkCrashedUfo, *_mkAlienSite;
 	FastLineClip *_clipper;
@@ -73,18 +102,20 @@ private:
 	std::vector<double> _radius;
 
 
-	/// Checks if a point is behind the globe.
-	bool pointBack(double lon, double lat) const;
 	/// Return latitude of last visible to player point on given longitude.
 	double lastVisibleLat(double lon) const;
 	/// Checks if a point is inside a polygon.
 	bool insidePolygon(double lon, double lat, Polygon *poly) const;
+	/// Puts the land polygons on a grid.
+	void indexPolygons();
+	/// Loads the world geometry into flat arrays.
+	void loadGeometry();
 	/// Checks if a target is near a point.
 	bool targetNear(Target* target, int x, int y) const;
-	/// Caches a set of polygons.
-	void cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache);
 	/// Get position of sun relative to given position in polar cords and date.
 	Cord getSunDirection(double lon, double lat) const;
+	/// Calculates the shadow of every pixel on the globe.
+	void cacheShadow(const Cord &sun);
 public:
 	/// Creates a new globe at the specified position and size.
 	Globe(Game *game, int cenX, int cenY, int width, int height, int x = 0, int y = 0);
@@ -92,11 +123,25 @@ public:
 	~Globe();
 	/// Loads a set of polygons from a DAT file.
 	static void loadDat(const std::string &filename, std::list<Polygon*> *polygons);
+	/// Shades a globe pixel without the shadow cache.
+	static Uint8 getShadowPixel(Uint8 dest, const Cord &earth, const Cord &sun, Sint16 noise);
+	/// Works out the cached shadow of a globe pixel.
+	static void cacheShadowPixel(const Cord &earth, const Cord &sun, Sint16 noise, Uint8 *ocean, Uint8 *land);
+	/// Shades a row of globe pixels with their cached shadow.
+	static void shadeShadowRow(Uint8 *dest, const Uint8 *ocean, const Uint8 *land, int width);
 	/// Converts polar coordinates to cartesian coordinates.
 	void polarToCart(double lon, double lat, Sint16 *x, Sint16 *y) const;
 	void polarToCart(double lon, double lat, double *x, double *y) const;
 	/// Converts cartesian coordinates to polar coordinates.
 	void cartToPolar(Sint16 x, Sint16 y, double *lon, double *lat) const;
+	/// Checks if a point is behind the globe.
+	bool pointBack(double lon, double lat) const;
+	/// Projects a set of points onto the screen.
+	void projectPoints(GlobePoints *points) const;
+	/// Finds the land polygon containing a point.
+	Polygon *locatePolygon(double lon, double lat) const;
+	/// Finds the land polygon containing a point by checking them all.
+	Polygon *scanPolygons(double lon, double lat) const;
 	/// Sets the texture set for the globe's polygons.
 	void setTexture(SurfaceSet *texture);
 	/// Starts rotating the globe left.
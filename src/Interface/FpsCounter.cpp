@@ -30,12 +30,14 @@ namespace OpenXcom
 
 /**
  * Creates a FPS counter of the specified size.
+ * The frame rate is shown on the first row and the
+ * think, blit and flip times (in microseconds) below it.
  * @param width Width in pixels.
  * @param height Height in pixels.
  * @param x X position in pixels.
  * @param y Y position in pixels.
  */
-FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, height, x, y), _frames(0)
+FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, height, x, y), _frames(0), _thinkTime(0), _blitTime(0), _flipTime(0)
 {
 	_visible = Options::getBool("fpsCounter");
 
@@ -43,7 +45,10 @@ FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, hei
 	_timer->onTimer((SurfaceHandler)&FpsCounter::update);
 	_timer->start();
 
-	_text = new NumberText(width, height, x, y);
+	_text = new NumberText(width, 5, 0, 0);
+	_think = new NumberText(width, 5, 0, 6);
+	_blit = new NumberText(width, 5, 0, 12);
+	_flip = new NumberText(width, 5, 0, 18);
 	setColor(Palette::blockOffset(15)+12);
 }
 
@@ -53,6 +58,9 @@ FpsCounter::FpsCounter(int width, int height, int x, int y) : Surface(width, hei
 FpsCounter::~FpsCounter()
 {
 	delete _text;
+	delete _think;
+	delete _blit;
+	delete _flip;
 	delete _timer;
 }
 
@@ -66,6 +74,9 @@ void FpsCounter::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
 	Surface::setPalette(colors, firstcolor, ncolors);
 	_text->setPalette(colors, firstcolor, ncolors);
+	_think->setPalette(colors, firstcolor, ncolors);
+	_blit->setPalette(colors, firstcolor, ncolors);
+	_flip->setPalette(colors, firstcolor, ncolors);
 }
 
 /**
@@ -75,6 +86,9 @@ void FpsCounter::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 void FpsCounter::setColor(Uint8 color)
 {
 	_text->setColor(color);
+	_think->setColor(color);
+	_blit->setColor(color);
+	_flip->setColor(color);
 }
 
 /**
@@ -91,22 +105,44 @@ void FpsCounter::handle(Action *action)
 }
 
 /**
- * Advances frame counter.
+ * Advances frame counter timer.
  */
 void FpsCounter::think()
 {
-	_frames++;
 	_timer->think(0, this);
 }
 
 /**
- * Updates the amount of Frames per Second.
+ * Counts a frame that was actually rendered, and the time it took.
+ * The think time covers all the logic since the previous frame.
+ * @param think Time spent thinking in microseconds.
+ * @param blit Time spent blitting in microseconds.
+ * @param flip Time spent flipping in microseconds.
+ */
+void FpsCounter::addFrame(Uint32 think, Uint32 blit, Uint32 flip)
+{
+	_frames++;
+	_thinkTime += think;
+	_blitTime += blit;
+	_flipTime += flip;
+}
+
+/**
+ * Updates the amount of Frames per Second
+ * and the average frame timings.
  */
 void FpsCounter::update()
 {
 	int fps = (int)floor((double)_frames / _timer->getTime() * 1000);
 	_text->setValue(fps);
+	if (_frames > 0)
+	{
+		_think->setValue(_thinkTime / _frames);
+		_blit->setValue(_blitTime / _frames);
+		_flip->setValue(_flipTime / _frames);
+	}
 	_frames = 0;
+	_thinkTime = _blitTime = _flipTime = 0;
 	_redraw = true;
 }
 
@@ -117,6 +153,9 @@ void FpsCounter::draw()
 {
 	Surface::draw();
 	_text->blit(this);
+	_think->blit(this);
+	_blit->blit(this);
+	_flip->blit(this);
 }
 
 }
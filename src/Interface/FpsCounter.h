@@ -31,14 +31,17 @@ class Action;
 
 /**
  * Counts the amount of frames each second
- * and displays them in a NumberText surface.
+ * and displays them in a NumberText surface,
+ * along with the average time spent thinking,
+ * blitting and flipping each frame.
  */
 class FpsCounter : public Surface
 {
 private:
-	NumberText *_text;
+	NumberText *_text, *_think, *_blit, *_flip;
 	Timer *_timer;
 	int _frames;
+	Uint32 _thinkTime, _blitTime, _flipTime;
 public:
 	/// Creates a new FPS counter linked to a game.
 	FpsCounter(int width, int height, int x, int y);
@@ -50,8 +53,10 @@ public:
 	void setColor(Uint8 color);
 	/// Handles keyboard events.
 	void handle(Action *action);
-	/// Advances frame counter.
+	/// Advances frame counter timer.
 	void think();
+	/// Counts a rendered frame.
+	void addFrame(Uint32 think, Uint32 blit, Uint32 flip);
 	// Updates FPS counter.
 	void update();
 	/// Draws the FPS counter.
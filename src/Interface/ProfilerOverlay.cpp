@@ -0,0 +1,171 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ProfilerOverlay.h"
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include "../Engine/Palette.h"
+#include "../Engine/Action.h"
+#include "../Engine/Timer.h"
+#include "../Engine/Options.h"
+#include "../Engine/Profiler.h"
+#include "Text.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Creates a profiler overlay of the specified size.
+ * Starts the profiler right away if the option is set.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @param x X position in pixels.
+ * @param y Y position in pixels.
+ */
+ProfilerOverlay::ProfilerOverlay(int width, int height, int x, int y) : Surface(width, height, x, y), _fonts(false)
+{
+	if (Options::getBool("profiler"))
+	{
+		Profiler::start();
+	}
+	_visible = Profiler::enabled;
+
+	_timer = new Timer(1000);
+	_timer->onTimer((SurfaceHandler)&ProfilerOverlay::update);
+	_timer->start();
+
+	_text = new Text(width, height, 0, 0);
+	setColor(Palette::blockOffset(15)+12);
+}
+
+/**
+ * Stops the profiler and deletes the overlay content.
+ */
+ProfilerOverlay::~ProfilerOverlay()
+{
+	Profiler::stop();
+	delete _text;
+	delete _timer;
+}
+
+/**
+ * Replaces a certain amount of colors in the profiler overlay palette.
+ * @param colors Pointer to the set of colors.
+ * @param firstcolor Offset of the first color to replace.
+ * @param ncolors Amount of colors to replace.
+ */
+void ProfilerOverlay::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
+{
+	Surface::setPalette(colors, firstcolor, ncolors);
+	_text->setPalette(colors, firstcolor, ncolors);
+}
+
+/**
+ * Changes the fonts of the overlay. Nothing is shown
+ * until they're set, since they come with the resources.
+ * @param big Pointer to large-size font.
+ * @param small Pointer to small-size font.
+ */
+void ProfilerOverlay::setFonts(Font *big, Font *small)
+{
+	_text->setFonts(big, small);
+	_text->setSmall();
+	_fonts = true;
+}
+
+/**
+ * Sets the text color of the overlay.
+ * @param color The color to set.
+ */
+void ProfilerOverlay::setColor(Uint8 color)
+{
+	_text->setColor(color);
+}
+
+/**
+ * Starts / stops the profiler, which also shows / hides the overlay.
+ * Stopping it writes the trace file.
+ * @param action Pointer to an action.
+ */
+void ProfilerOverlay::handle(Action *action)
+{
+	if (action->getDetails()->type == SDL_KEYDOWN && action->getDetails()->key.keysym.sym == Options::getInt("keyProfiler"))
+	{
+		if (Profiler::enabled)
+		{
+			Profiler::stop();
+		}
+		else
+		{
+			Profiler::start();
+		}
+		_visible = Profiler::enabled;
+		_text->setText(L"");
+		_redraw = true;
+	}
+}
+
+/**
+ * Advances the overlay timer.
+ */
+void ProfilerOverlay::think()
+{
+	_timer->think(0, this);
+}
+
+/**
+ * Lists the slowest zones of the last second, with the time
+ * spent in them in milliseconds and how many times they ran.
+ */
+void ProfilerOverlay::update()
+{
+	std::vector<ProfileTotal> totals;
+	Profiler::takeTotals(&totals);
+	if (!Profiler::enabled || !_fonts)
+		return;
+
+	double seconds = _timer->getTime() / 1000.0;
+	std::wstringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	int lines = getHeight() / 9;
+	for (std::vector<ProfileTotal>::const_iterator i = totals.begin(); i != totals.end() && lines > 0; ++i, --lines)
+	{
+		for (const char *c = i->name; *c != 0; ++c)
+		{
+			ss << (wchar_t)*c;
+		}
+		ss << L" " << i->time / 1000.0 / seconds << L"ms x" << (int)(i->calls / seconds + 0.5) << L"\n";
+	}
+	_text->setText(ss.str());
+	_redraw = true;
+}
+
+/**
+ * Draws the profiler overlay.
+ */
+void ProfilerOverlay::draw()
+{
+	Surface::draw();
+	if (_fonts)
+	{
+		_text->blit(this);
+	}
+}
+
+}
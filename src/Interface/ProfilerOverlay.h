@@ -0,0 +1,66 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PROFILEROVERLAY_H
+#define OPENXCOM_PROFILEROVERLAY_H
+
+#include "../Engine/Surface.h"
+
+namespace OpenXcom
+{
+
+class Text;
+class Timer;
+class Action;
+class Font;
+
+/**
+ * Shows the zones the profiler spent the most time in
+ * over the last second, next to the FPS counter.
+ * Also starts and stops the profiler.
+ */
+class ProfilerOverlay : public Surface
+{
+private:
+	Text *_text;
+	Timer *_timer;
+	bool _fonts;
+public:
+	/// Creates a new profiler overlay.
+	ProfilerOverlay(int width, int height, int x, int y);
+	/// Cleans up the profiler overlay.
+	~ProfilerOverlay();
+	/// Sets the profiler overlay's palette.
+	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256);
+	/// Sets the profiler overlay's fonts.
+	void setFonts(Font *big, Font *small);
+	/// Sets the profiler overlay's color.
+	void setColor(Uint8 color);
+	/// Handles keyboard events.
+	void handle(Action *action);
+	/// Advances the overlay timer.
+	void think();
+	/// Updates the profiler overlay.
+	void update();
+	/// Draws the profiler overlay.
+	void draw();
+};
+
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _USE_MATH_DEFINES
+#include "AreaGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace OpenXcom
+{
+
+/**
+ * Creates an empty grid covering the whole globe.
+ */
+AreaGrid::AreaGrid() : _cells(COLUMNS * ROWS)
+{
+}
+
+/**
+ *
+ */
+AreaGrid::~AreaGrid()
+{
+}
+
+/**
+ * Gets the column of the grid a longitude falls in.
+ * @param lon Longitude in radians.
+ * @return Column, or outside [0, COLUMNS) if the longitude is outside [0, 2*PI).
+ */
+int AreaGrid::getColumn(double lon)
+{
+	return (int)std::floor(lon * 180 / M_PI / CELL_SIZE);
+}
+
+/**
+ * Gets the row of the grid a latitude falls in.
+ * @param lat Latitude in radians.
+ * @return Row, or outside [0, ROWS) if the latitude is outside [-PI/2, PI/2).
+ */
+int AreaGrid::getRow(double lat)
+{
+	return (int)std::floor((lat * 180 / M_PI + 90) / CELL_SIZE);
+}
+
+/**
+ * Adds an item to all the cells in a range, clamped to the grid.
+ * @param id Item ID.
+ * @param colMin First column.
+ * @param colMax Last column.
+ * @param rowMin First row.
+ * @param rowMax Last row.
+ */
+void AreaGrid::addCells(int id, int colMin, int colMax, int rowMin, int rowMax)
+{
+	colMin = std::max(colMin, 0);
+	colMax = std::min(colMax, COLUMNS - 1);
+	rowMin = std::max(rowMin, 0);
+	rowMax = std::min(rowMax, ROWS - 1);
+	for (int col = colMin; col <= colMax; ++col)
+	{
+		for (int row = rowMin; row <= rowMax; ++row)
+		{
+			std::vector<int> &cell = _cells[row * COLUMNS + col];
+			// items are added in order, so it can only be a duplicate of the last one
+			if (cell.empty() || cell.back() != id)
+			{
+				cell.push_back(id);
+			}
+		}
+	}
+}
+
+/**
+ * Removes all the items from the grid.
+ */
+void AreaGrid::clear()
+{
+	for (std::vector<std::vector<int> >::iterator i = _cells.begin(); i != _cells.end(); ++i)
+	{
+		i->clear();
+	}
+	_all.clear();
+}
+
+/**
+ * Adds an item to all the cells its areas overlap. The item
+ * gets the next ID, so candidates keep the order items were added in.
+ * Areas follow the same rules as RuleRegion::insideRegion(), so
+ * an area with lonMin > lonMax wraps around longitude 0.
+ * @param lonMin Minimum longitude of each area, in radians.
+ * @param lonMax Maximum longitude of each area, in radians.
+ * @param latMin Minimum latitude of each area, in radians.
+ * @param latMax Maximum latitude of each area, in radians.
+ */
+void AreaGrid::add(const std::vector<double> &lonMin, const std::vector<double> &lonMax, const std::vector<double> &latMin, const std::vector<double> &latMax)
+{
+	int id = _all.size();
+	_all.push_back(id);
+	for (size_t i = 0; i < lonMin.size(); ++i)
+	{
+		int rowMin = getRow(latMin[i]), rowMax = getRow(latMax[i]);
+		if (lonMin[i] <= lonMax[i])
+		{
+			addCells(id, getColumn(lonMin[i]), getColumn(lonMax[i]), rowMin, rowMax);
+		}
+		else
+		{
+			addCells(id, getColumn(lonMin[i]), COLUMNS - 1, rowMin, rowMax);
+			addCells(id, 0, getColumn(lonMax[i]), rowMin, rowMax);
+		}
+	}
+}
+
+/**
+ * Gets the number of items added to the grid.
+ * @return Number of items.
+ */
+size_t AreaGrid::size() const
+{
+	return _all.size();
+}
+
+/**
+ * Gets the IDs of the items whose areas might contain a point,
+ * in the order they were added. The caller still has to check
+ * each candidate, since cells are only partly covered by areas.
+ * @param lon Longitude in radians.
+ * @param lat Latitude in radians.
+ * @return List of item IDs.
+ */
+const std::vector<int> &AreaGrid::getCandidates(double lon, double lat) const
+{
+	int col = getColumn(lon), row = getRow(lat);
+	if (col < 0 || col >= COLUMNS || row < 0 || row >= ROWS)
+	{
+		// off the grid, anything goes
+		return _all;
+	}
+	return _cells[row * COLUMNS + col];
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2010-2013 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_AREAGRID_H
+#define OPENXCOM_AREAGRID_H
+
+#include <cstddef>
+#include <vector>
+
+namespace OpenXcom
+{
+
+/**
+ * Grid over the globe that maps each cell of longitude and latitude to
+ * the items (eg. regions or countries) whose areas overlap it.
+ * Finding what contains a point then only needs to check the few
+ * candidates of its cell instead of every area of every item.
+ */
+class AreaGrid
+{
+private:
+	static const int CELL_SIZE = 4;
+	static const int COLUMNS = 360 / CELL_SIZE, ROWS = 180 / CELL_SIZE;
+	std::vector<std::vector<int> > _cells;
+	std::vector<int> _all;
+	/// Gets the column of a longitude.
+	static int getColumn(double lon);
+	/// Gets the row of a latitude.
+	static int getRow(double lat);
+	/// Adds an item to a range of cells.
+	void addCells(int id, int colMin, int colMax, int rowMin, int rowMax);
+public:
+	/// Creates an empty grid.
+	AreaGrid();
+	/// Cleans up the grid.
+	~AreaGrid();
+	/// Removes all items.
+	void clear();
+	/// Adds an item with its areas.
+	void add(const std::vector<double> &lonMin, const std::vector<double> &lonMax, const std::vector<double> &latMin, const std::vector<double> &latMax);
+	/// Gets the number of items.
+	size_t size() const;
+	/// Gets the items that might contain a point.
+	const std::vector<int> &getCandidates(double lon, double lat) const;
+};
+
+}
+
+#endif
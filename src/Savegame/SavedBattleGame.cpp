@@ -21,6 +21,7 @@
 #include <vector>
 #include <deque>
 #include <queue>
+#include <new>
 
 #include "SavedBattleGame.h"
 #include "SavedGame.h"
@@ -52,7 +53,7 @@ namespace OpenXcom
 /**
  * Initializes a brand new battlescape saved game.
  */
-SavedBattleGame::SavedBattleGame() : _battleState(0), _mapsize_x(0), _mapsize_y(0), _mapsize_z(0), _tiles(), _selectedUnit(0), _lastSelectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _globalShade(0), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0), _objectiveDestroyed(false), _fallingUnits(), _unitsFalling(false), _strafeEnabled(false), _sneaky(false), _traceAI(false)
+SavedBattleGame::SavedBattleGame() : _battleState(0), _mapsize_x(0), _mapsize_y(0), _mapsize_z(0), _tiles(), _tileStore(0), _selectedUnit(0), _lastSelectedUnit(0), _nodes(), _units(), _items(), _pathfinding(0), _tileEngine(0), _missionType(""), _globalShade(0), _side(FACTION_PLAYER), _turn(1), _debugMode(false), _aborted(false), _itemId(0), _objectiveDestroyed(false), _fallingUnits(), _unitsFalling(false), _strafeEnabled(false), _sneaky(false), _traceAI(false)
 {
 	_dragButton = Options::getInt("battleScrollDragButton");
 	_dragInvert = Options::getBool("battleScrollDragInvert");
@@ -68,11 +69,7 @@ SavedBattleGame::SavedBattleGame() : _battleState(0), _mapsize_x(0), _mapsize_y(
  */
 SavedBattleGame::~SavedBattleGame()
 {
-	for (int i = 0; i < _mapsize_z * _mapsize_y * _mapsize_x; ++i)
-	{
-		delete _tiles[i];
-	}
-	delete[] _tiles;
+	deleteTiles();
 
 	for (std::vector<Node*>::iterator i = _nodes.begin(); i != _nodes.end(); ++i)
 	{
@@ -299,17 +296,28 @@ void SavedBattleGame::load(const YAML::Node &node, Ruleset *rule, SavedGame* sav
 
 /**
  * Loads the resources required by the map in the battle save.
- * @param res Pointer to resource pack.
+ * @param game Pointer to the game.
  */
 void SavedBattleGame::loadMapResources(Game *game)
 {
-	ResourcePack *res = game->getResourcePack();
+	loadMapResources(game->getResourcePack(), game->getRuleset());
+}
+
+/**
+ * Loads the resources required by the map in the battle save.
+ * Only needs the voxel data out of the resource pack, so it
+ * can be used without a game, eg. for benchmarks.
+ * @param res Pointer to resource pack.
+ * @param rule Pointer to the ruleset.
+ */
+void SavedBattleGame::loadMapResources(ResourcePack *res, Ruleset *rule)
+{
 	for (std::vector<MapDataSet*>::const_iterator i = _mapDataSets.begin(); i != _mapDataSets.end(); ++i)
 	{
 		(*i)->loadData();
-		if (game->getRuleset()->getMCDPatch((*i)->getName()))
+		if (rule->getMCDPatch((*i)->getName()))
 		{
-			game->getRuleset()->getMCDPatch((*i)->getName())->modifyData(*i);
+			rule->getMCDPatch((*i)->getName())->modifyData(*i);
 		}
 	}
 
@@ -450,11 +458,7 @@ void SavedBattleGame::initMap(int mapsize_x, int mapsize_y, int mapsize_z)
 {
 	if (!_nodes.empty())
 	{
-		for (int i = 0; i < _mapsize_z * _mapsize_y * _mapsize_x; ++i)
-		{
-			delete _tiles[i];
-		}
-		delete[] _tiles;
+		deleteTiles();
 
 		for (std::vector<Node*>::iterator i = _nodes.begin(); i != _nodes.end(); ++i)
 		{
@@ -464,20 +468,46 @@ void SavedBattleGame::initMap(int mapsize_x, int mapsize_y, int mapsize_z)
 		_nodes.clear();
 		_mapDataSets.clear();
 	}
+	if (_pathfinding)
+	{
+		// the cached step costs belong to the old map
+		_pathfinding->invalidateCache();
+	}
+	if (_tileEngine)
+	{
+		_tileEngine->invalidateVoxels();
+		_tileEngine->invalidateLighting();
+	}
 	_mapsize_x = mapsize_x;
 	_mapsize_y = mapsize_y;
 	_mapsize_z = mapsize_z;
 	_tiles = new Tile*[_mapsize_z * _mapsize_y * _mapsize_x];
-	/* create tile objects */
+	/* create tile objects, all in one block so full map sweeps don't jump all over the heap */
+	_tileStore = static_cast<Tile*>(::operator new(_mapsize_z * _mapsize_y * _mapsize_x * sizeof(Tile)));
 	for (int i = 0; i < _mapsize_z * _mapsize_y * _mapsize_x; ++i)
 	{
 		Position pos;
 		getTileCoords(i, &pos.x, &pos.y, &pos.z);
-		_tiles[i] = new Tile(pos);
+		_tiles[i] = new (&_tileStore[i]) Tile(pos);
 	}
 
 }
 
+/**
+ * Deletes the tile objects of the map.
+ */
+void SavedBattleGame::deleteTiles()
+{
+	for (int i = 0; i < _mapsize_z * _mapsize_y * _mapsize_x; ++i)
+	{
+		_tiles[i]->~Tile();
+	}
+	::operator delete(_tileStore);
+	delete[] _tiles;
+	_tileStore = 0;
+	_tiles = 0;
+}
+
 /**
  * Initializes the map utilities.
  * @param res Pointer to resource pack.
@@ -871,6 +901,8 @@ void SavedBattleGame::endTurn()
 	}
 	
 	// re-run calculateFOV() *after* all aliens have been set not-visible
+	_tileEngine->invalidateFOV();
+	_pathfinding->clearReachable();
 	for (std::vector<BattleUnit*>::iterator i = _units.begin(), end = _units.end(); i != end; ++i)
 	{
 		_tileEngine->calculateFOV(*i);
@@ -1160,17 +1192,18 @@ void SavedBattleGame::prepareNewTurn()
 {
 	std::vector<Tile*> tilesOnFire;
 	std::vector<Tile*> tilesOnSmoke;
+	std::vector<Position> tilesBurnt;
 
 	// prepare a list of tiles on fire/smoke
 	for (int i = 0; i < _mapsize_x * _mapsize_y * _mapsize_z; ++i)
 	{
-		if (getTiles()[i]->getFire() > 0)
+		if (getTile(i)->getFire() > 0)
 		{
-			tilesOnFire.push_back(getTiles()[i]);
+			tilesOnFire.push_back(getTile(i));
 		}
-		if (getTiles()[i]->getSmoke() > 0)
+		if (getTile(i)->getSmoke() > 0)
 		{
-			tilesOnSmoke.push_back(getTiles()[i]);
+			tilesOnSmoke.push_back(getTile(i));
 		}
 	}
 
@@ -1207,7 +1240,12 @@ void SavedBattleGame::prepareNewTurn()
 			t->addSmoke((*i)->getSmoke()/2);
 		}
 
-		(*i)->prepareNewTurn();
+		bool burnt;
+		(*i)->prepareNewTurn(&burnt);
+		if (burnt)
+		{
+			tilesBurnt.push_back((*i)->getPosition());
+		}
 	}
 
 	for (std::vector<Tile*>::iterator i = tilesOnFire.begin(); i != tilesOnFire.end(); ++i)
@@ -1252,8 +1290,19 @@ void SavedBattleGame::prepareNewTurn()
 				}
 			}
 		}
+		bool burnt = false;
 		if (!_objectiveDestroyed)
-			_objectiveDestroyed = (*i)->prepareNewTurn();
+			_objectiveDestroyed = (*i)->prepareNewTurn(&burnt);
+		if (burnt)
+		{
+			tilesBurnt.push_back((*i)->getPosition());
+		}
+	}
+
+	// objects that burned away no longer block paths or lines of sight
+	for (std::vector<Position>::iterator i = tilesBurnt.begin(); i != tilesBurnt.end(); ++i)
+	{
+		getTileEngine()->tileChanged(*i);
 	}
 
 	if (!tilesOnFire.empty())
@@ -58,7 +58,8 @@ private:
 	BattlescapeState *_battleState;
 	int _mapsize_x, _mapsize_y, _mapsize_z;
 	std::vector<MapDataSet*> _mapDataSets;
-	Tile **_tiles;
+	Tile **_tiles, *_tileStore;
+	void deleteTiles();
 	BattleUnit *_selectedUnit, *_lastSelectedUnit;
 	std::vector<Node*> _nodes;
 	std::vector<BattleUnit*> _units;
@@ -155,6 +156,17 @@ public:
 
 		return _tiles[getTileIndex(pos)];
 	}
+	/**
+	 * Gets the Tile with a given index. All tiles are stored in one
+	 * block in index order, so sweeping the whole map by index walks
+	 * through memory in sequence.
+	 * @param index Tile index, see getTileIndex().
+	 * @return Pointer to tile.
+	 */
+	inline Tile *getTile(int index) const
+	{
+		return _tiles[index];
+	}
 	/// get the currently selected unit
 	BattleUnit *getSelectedUnit() const;
 	/// set the currently selected unit
@@ -183,6 +195,8 @@ public:
 	bool getDebugMode() const;
 	/// load map resources
 	void loadMapResources(Game *game);
+	/// load map resources without a game.
+	void loadMapResources(ResourcePack *res, Ruleset *rule);
 	/// resets tiles units are standing on
 	void resetUnitTiles();
 	/// Removes an item from the game.
@@ -31,6 +31,7 @@
 #include "../Engine/Exception.h"
 #include "../Engine/Options.h"
 #include "../Engine/CrossPlatform.h"
+#include "../Engine/Profiler.h"
 #include "SavedBattleGame.h"
 #include "GameTime.h"
 #include "Country.h"
@@ -48,8 +49,10 @@
 #include "TerrorSite.h"
 #include "AlienBase.h"
 #include "AlienStrategy.h"
+#include "AreaGrid.h"
 #include "AlienMission.h"
 #include "../Ruleset/RuleRegion.h"
+#include "../Ruleset/RuleCountry.h"
 
 namespace OpenXcom
 {
@@ -95,6 +98,8 @@ SavedGame::SavedGame() : _difficulty(DIFF_BEGINNER), _globeLon(0.0), _globeLat(0
 	RNG::init();
 	_time = new GameTime(6, 1, 1, 1999, 12, 0, 0);
 	_alienStrategy = new AlienStrategy();
+	_regionGrid = new AreaGrid();
+	_countryGrid = new AreaGrid();
 	_funds.push_back(0);
 	_maintenance.push_back(0);
 	_researchScores.push_back(0);
@@ -106,6 +111,8 @@ SavedGame::SavedGame() : _difficulty(DIFF_BEGINNER), _globeLon(0.0), _globeLat(0
 SavedGame::~SavedGame()
 {
 	delete _time;
+	delete _regionGrid;
+	delete _countryGrid;
 	for (std::vector<Country*>::iterator i = _countries.begin(); i != _countries.end(); ++i)
 	{
 		delete *i;
@@ -206,6 +213,7 @@ void SavedGame::getList(TextList *list, Language *lang)
  */
 void SavedGame::load(const std::string &filename, Ruleset *rule)
 {
+	ProfileZone zone("SavedGame::load");
 	std::string s = Options::getUserFolder() + filename + ".sav";
 	std::ifstream fin(s.c_str());
 	if (!fin)
@@ -361,6 +369,7 @@ void SavedGame::load(const std::string &filename, Ruleset *rule)
  */
 void SavedGame::save(const std::string &filename) const
 {
+	ProfileZone zone("SavedGame::save");
 	std::string s = Options::getUserFolder() + filename + ".sav";
 	std::ofstream sav(s.c_str());
 	if (!sav)
@@ -1307,32 +1316,32 @@ void SavedGame::setWarned(bool warned)
 	_warned = warned;
 }
 
-/** @brief Check if a point is contained in a region.
- * This function object checks if a point is contained inside a region.
- */
-class ContainsPoint: public std::unary_function<const Region *, bool>
-{
-public:
-	/// Remember the coordinates.
-	ContainsPoint(double lon, double lat) : _lon(lon), _lat(lat) { /* Empty by design. */ }
-	/// Check is the region contains the stored point.
-	bool operator()(const Region *region) const { return region->getRules()->insideRegion(_lon, _lat); }
-private:
-	double _lon, _lat;
-};
-
 /**
  * Find the region containing this location.
+ * The regions are put on a grid the first time, so only
+ * the ones near the location need to be checked.
  * @param lon The longtitude.
  * @param lat The latitude.
  * @return Pointer to the region, or 0.
  */
 Region *SavedGame::locateRegion(double lon, double lat) const
 {
-	std::vector<Region *>::const_iterator found = std::find_if(_regions.begin(), _regions.end(), ContainsPoint(lon, lat));
-	if (found != _regions.end())
+	if (_regionGrid->size() != _regions.size())
 	{
-		return *found;
+		_regionGrid->clear();
+		for (std::vector<Region*>::const_iterator i = _regions.begin(); i != _regions.end(); ++i)
+		{
+			const RuleRegion *rule = (*i)->getRules();
+			_regionGrid->add(rule->getLonMin(), rule->getLonMax(), rule->getLatMin(), rule->getLatMax());
+		}
+	}
+	const std::vector<int> &candidates = _regionGrid->getCandidates(lon, lat);
+	for (std::vector<int>::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+	{
+		if (_regions[*i]->getRules()->insideRegion(lon, lat))
+		{
+			return _regions[*i];
+		}
 	}
 	return 0;
 }
@@ -1347,6 +1356,46 @@ Region *SavedGame::locateRegion(const Target &target) const
 	return locateRegion(target.getLongitude(), target.getLatitude());
 }
 
+/**
+ * Find the country containing this location.
+ * The countries are put on a grid the first time, so only
+ * the ones near the location need to be checked.
+ * @param lon The longtitude.
+ * @param lat The latitude.
+ * @return Pointer to the country, or 0.
+ */
+Country *SavedGame::locateCountry(double lon, double lat) const
+{
+	if (_countryGrid->size() != _countries.size())
+	{
+		_countryGrid->clear();
+		for (std::vector<Country*>::const_iterator i = _countries.begin(); i != _countries.end(); ++i)
+		{
+			const RuleCountry *rule = (*i)->getRules();
+			_countryGrid->add(rule->getLonMin(), rule->getLonMax(), rule->getLatMin(), rule->getLatMax());
+		}
+	}
+	const std::vector<int> &candidates = _countryGrid->getCandidates(lon, lat);
+	for (std::vector<int>::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+	{
+		if (_countries[*i]->getRules()->insideCountry(lon, lat))
+		{
+			return _countries[*i];
+		}
+	}
+	return 0;
+}
+
+/**
+ * Find the country containing this target.
+ * @param target The target to locate.
+ * @return Pointer to the country, or 0.
+ */
+Country *SavedGame::locateCountry(const Target &target) const
+{
+	return locateCountry(target.getLongitude(), target.getLatitude());
+}
+
 /*
  * @return the month counter.
  */
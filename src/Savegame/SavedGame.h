@@ -45,6 +45,7 @@ class AlienBase;
 class AlienStrategy;
 class AlienMission;
 class Target;
+class AreaGrid;
 
 /**
  * Enumerator containing all the possible game difficulties.
@@ -73,6 +74,7 @@ private:
 	std::vector<TerrorSite*> _terrorSites;
 	std::vector<AlienBase*> _alienBases;
 	AlienStrategy *_alienStrategy;
+	AreaGrid *_regionGrid, *_countryGrid;
 	SavedBattleGame *_battleGame;
 	std::vector<const RuleResearch *> _discovered;
 	std::vector<AlienMission*> _activeMissions;
@@ -201,6 +203,10 @@ public:
 	Region *locateRegion(double lon, double lat) const;
 	/// Locate a region containing a Target.
 	Region *locateRegion(const Target &target) const;
+	/// Locate a country containing a position.
+	Country *locateCountry(double lon, double lat) const;
+	/// Locate a country containing a Target.
+	Country *locateCountry(const Target &target) const;
 	/// Return the month counter.
 	int getMonthsPassed() const;
 	/// Return the GraphRegionToggles.
@@ -665,6 +665,32 @@ void Tile::animate()
 	}
 }
 
+/**
+ * Checks if any of the tile parts changes its looks when the tile is animated.
+ * Ufo doors only do so while they are opening.
+ * @return True if the tile is animated.
+ */
+bool Tile::isAnimated() const
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		if (!_objects[i])
+			continue;
+		if (_objects[i]->isUFODoor())
+		{
+			if (_currentFrame[i] != 0 && _currentFrame[i] != 7)
+				return true;
+			continue;
+		}
+		for (int frame = 1; frame < 8; ++frame)
+		{
+			if (_objects[i]->getSprite(frame) != _objects[i]->getSprite(0))
+				return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Get the sprite of a certain part of the tile.
  * @param part
@@ -799,11 +825,13 @@ int Tile::getTopItemSprite()
 
 /**
  * New turn preparations. Decrease smoke and fire timers.
+ * @param burnt Set to true if any objects burned away.
  * @return bool Return true objective was destroyed
  */
-bool Tile::prepareNewTurn()
+bool Tile::prepareNewTurn(bool *burnt)
 {
 	bool objective = false;
+	*burnt = false;
 
 	_smoke--;
 	if (_smoke < 0) _smoke = 0;
@@ -819,6 +847,7 @@ bool Tile::prepareNewTurn()
 				if (_objects[i]->getFlammable() < 255)
 				{
 					objective = destroy(i);
+					*burnt = true;
 				}
 			}
 		}
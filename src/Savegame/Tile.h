@@ -55,16 +55,6 @@ public:
 		Uint32 totalBytes; // per structure, including any data not mentioned here and accounting for all array members!
 	} serializationKey;
 
-    // scratch variables for AI, regarding how many soldiers are visible from a square and how close is the closest one:
-	int closestSoldierDSqr;
-	Position closestSoldierPos;
-	int meanSoldierDSqr;
-	int soldiersVisible;
-	int closestAlienDSqr;
-	int totalExposure;
-
-	static const int NOT_CALCULATED = -1;
-
 protected:
 	static const int LIGHTLAYERS = 3;
 	MapData *_objects[4];
@@ -143,6 +133,8 @@ public:
 	bool detonate();
 	/// Animated the tile parts.
 	void animate();
+	/// Checks if the tile parts look different every animation frame.
+	bool isAnimated() const;
 	/// Get object sprites.
 	Surface *getSprite(int part) const;
 	/// Set a unit on this tile.
@@ -170,7 +162,7 @@ public:
 	/// Get top-most item
 	int getTopItemSprite();
 	/// Decrease fire and smoke timers.
-	bool prepareNewTurn();
+	bool prepareNewTurn(bool *burnt);
 	/// Get inventory on this tile.
 	std::vector<BattleItem *> *getInventory();
 	/// Set the tile marker color.